@@ -16,6 +16,8 @@
 #include <algorithm>
 #include <assert.h>
 #include <unordered_map>
+#include <fstream>
+#include <unistd.h>
 
 #include "cmdline.hpp"
 #include "atomic.hpp"
@@ -262,6 +264,39 @@ thunk_t scenario_fifo() {
 }
 
 
+/* Pushes `block` items at a time, and after each block takes a
+ * snapshot (copy) of the sequence, which stays alive until the next
+ * snapshot is taken, as a reader would; reports separately the time
+ * spent taking the snapshots.
+ */
+template <class Datastruct>
+thunk_t scenario_snapshot() {
+  typedef typename Datastruct::value_type value_type;
+  size_t nb_total = (size_t) cmdline::parse_or_default_int64("n", 100000000);
+  size_t repeat = (size_t) cmdline::parse_or_default_int64("r", 1000);
+  size_t block = nb_total / repeat;
+  return [=] {
+    printf("length %lld\n",block);
+    uint64_t start_time = microtime::now();
+    double snapshot_time = 0.0;
+    Datastruct d;
+    Datastruct* snapshot = nullptr;
+    res = 0;
+    for (size_t j = 0; j < repeat; j++) {
+      for (size_t i = 0; i < block; i++)
+        d.push_back(value_type(i));
+      uint64_t snapshot_start = microtime::now();
+      delete snapshot;
+      snapshot = new Datastruct(d);
+      snapshot_time += microtime::seconds_since(snapshot_start);
+      res += snapshot->size();
+    }
+    exec_time = microtime::seconds_since(start_time);
+    delete snapshot;
+    printf("snapshot_time %.3lf\n", snapshot_time);
+  };
+}
+
 // p should be 2 or more
 template <class Datastruct, bool should_push, bool should_pop>
 void _scenario_split_merge(Datastruct* ds, size_t n, size_t p, size_t r, size_t h) {
@@ -533,6 +568,7 @@ void dispatch_by_scenario() {
   c.add("lifo", scenario_lifo<Sequence>());
   c.add("fill_back", scenario_fill_back<Sequence>());
   c.add("split_merge", scenario_split_merge<Sequence>());
+  c.add("snapshot", scenario_snapshot<Sequence>());
   c.add("filter", scenario_filter<Sequence>());
   cmdline::dispatch_by_argmap(c, "scenario");
 }
@@ -583,6 +619,27 @@ template<class Chunk_item, int Cap, class Item_alloc2=std::allocator<Item>> clas
 class Item_alloc=std::allocator<Item> >
 using mybag = chunkedseq::bootstrapped::bagopt<Item, Chunk_capacity, Cache>;
 
+template <class Item,
+int Chunk_capacity=512,
+class Cache=data::cachedmeasure::trivial<Item, size_t>,
+template<class Chunk_item, int Cap, class Item_alloc2=std::allocator<Item>> class Chunk_struct=data::fixedcapacity::heap_allocated::ringbuffer_ptr,
+class Item_alloc=std::allocator<Item> >
+using mypooldeque = chunkedseq::bootstrapped::deque<Item, Chunk_capacity, Cache, Chunk_struct, data::chunkpool::recycling_allocator<Item>>;
+
+template <class Item,
+int Chunk_capacity=512,
+class Cache=data::cachedmeasure::trivial<Item, size_t>,
+template<class Chunk_item, int Cap, class Item_alloc2=std::allocator<Item>> class Chunk_struct=data::fixedcapacity::heap_allocated::ringbuffer_ptr,
+class Item_alloc=std::allocator<Item> >
+using mypoolstack = chunkedseq::bootstrapped::stack<Item, Chunk_capacity, Cache, data::chunkpool::recycling_allocator<Item>>;
+
+template <class Item,
+int Chunk_capacity=512,
+class Cache=data::cachedmeasure::trivial<Item, size_t>,
+template<class Chunk_item, int Cap, class Item_alloc2=std::allocator<Item>> class Chunk_struct=data::fixedcapacity::heap_allocated::ringbuffer_ptr,
+class Item_alloc=std::allocator<Item> >
+using mypersistentstack = chunkedseq::persistent::stack<Item, Chunk_capacity, Cache>;
+
 
 template <class Item,
 int Chunk_capacity=512,
@@ -619,6 +676,12 @@ void dispatch_by_sequence() {
     c.add("chunkedseq", [] {
       dispatch_for_chunkedseq<chunkedseq::bootstrapped::deque, Item, data::fixedcapacity::heap_allocated::ringbuffer_ptr>();
     });
+    c.add("chunkedseq_pool", [] {
+      dispatch_for_chunkedseq<mypooldeque, Item, data::fixedcapacity::heap_allocated::ringbuffer_ptr>();
+    });
+    c.add("chunkedseq_persistent", [] {
+      dispatch_for_chunkedseq<chunkedseq::persistent::deque, Item, data::fixedcapacity::heap_allocated::ringbuffer_ptr>();
+    });
   #endif
   #ifndef SKIP_CHUNKEDSEQ_OPT
     c.add("chunkedseq_stack", [] {
@@ -627,6 +690,12 @@ void dispatch_by_sequence() {
      c.add("chunkedseq_bag", [] {
        dispatch_for_chunkedseq<mybag, Item, data::fixedcapacity::heap_allocated::stack>();
     });
+    c.add("chunkedseq_stack_pool", [] {
+      dispatch_for_chunkedseq<mypoolstack, Item, data::fixedcapacity::heap_allocated::stack>();
+    });
+    c.add("chunkedseq_persistent_stack", [] {
+      dispatch_for_chunkedseq<mypersistentstack, Item, data::fixedcapacity::heap_allocated::stack>();
+    });
  #endif
   
 #ifndef SKIP_FTREE
@@ -659,6 +728,71 @@ void dispatch_by_itemsize() {
   util::cmdline::dispatch_by_argmap(c, "itemsize", std::to_string(default_itemsize));
 }
 
+/*---------------------------------------------------------------------*/
+// dispatch load
+
+/* Writes `n` items to a file, then loads them back in a fresh sequence
+ * and sums them; `load_mode` selects how the file is written and read:
+ *   - `push`: items written one by one, then read one by one and added
+ *     by `push_back`
+ *   - `copy`: `save`, then `load`, which copies the blocks of the file
+ *   - `mapped`: `save`, then `load`, which serves the chunks from a
+ *     mapping of the file
+ * The reported time covers the load and the sum, which takes the page
+ * faults of the mapped mode; `load_time` covers only the load. The file
+ * is written and flushed right before, and thus likely to be in the
+ * page cache.
+ */
+template <class Datastruct>
+thunk_t scenario_load() {
+  typedef typename Datastruct::value_type value_type;
+  size_t n = (size_t) cmdline::parse_or_default_int64("n", 100000000);
+  std::string path = cmdline::parse_or_default_string("path", "chunkedseq_load.bin");
+  std::string mode = cmdline::parse_or_default_string("load_mode", "mapped");
+  if (mode != "push" && mode != "copy" && mode != "mapped")
+    failwith("bogus load_mode " + mode);
+  return [=] {
+    {
+      Datastruct d;
+      for (size_t i = 0; i < n; i++)
+        d.push_back(value_type(i));
+      if (mode == "push") {
+        std::ofstream out(path, std::ofstream::binary);
+        d.for_each([&] (const value_type& x) {
+          out.write((const char*)&x, sizeof(value_type));
+        });
+      } else {
+        d.save(path);
+      }
+    }
+    sync();
+    uint64_t start_time = microtime::now();
+    Datastruct d;
+    if (mode == "push") {
+      std::ifstream in(path, std::ifstream::binary);
+      value_type x;
+      while (in.read((char*)&x, sizeof(value_type)))
+        d.push_back(x);
+    } else {
+      d.load(path, mode == "mapped");
+    }
+    double load_time = microtime::seconds_since(start_time);
+    res = 0;
+    d.for_each_segment([&] (const value_type* lo, const value_type* hi) {
+      for (const value_type* p = lo; p < hi; p++)
+        res += p->get();
+    });
+    exec_time = microtime::seconds_since(start_time);
+    printf("load_time %.3lf\n", load_time);
+    remove(path.c_str());
+  };
+}
+
+void dispatch_by_load() {
+  using seq_type = chunkedseq::bootstrapped::deque<bytes_8>;
+  scenario_load<seq_type>()();
+}
+
 /*---------------------------------------------------------------------*/
 // dispatch maps
 
@@ -692,6 +826,7 @@ void dispatch_by_benchmark_mode() {
   cmdline::argmap_dispatch c;
   c.add("sequence", [] { dispatch_by_itemsize(); });
   c.add("map",      [] { dispatch_by_map(); });
+  c.add("load",     [] { dispatch_by_load(); });
   cmdline::dispatch_by_argmap(c, "mode", "sequence");
 }
 
@@ -950,6 +950,16 @@ private:
       }
     }
 
+    // recursively deallocate the top items stored in the layer
+    void rec_deep_free(int depth) {
+      chunk_deep_free(depth, front_outer);
+      chunk_deep_free(depth, front_inner);
+      chunk_deep_free(depth, back_inner);
+      chunk_deep_free(depth, back_outer);
+      if (! is_shallow())
+        middle->rec_deep_free(depth+1);
+    }
+
     template <class Body>
     void rec_for_each(int depth, const Body& f) const {
       if (is_shallow()) {
@@ -1175,9 +1185,15 @@ public:
 
   using value_type = top_item_type;
 
+  //! The destructor deallocates the items by `Top_item_deleter`
+  static constexpr bool frees_items_when_destroyed = Top_item_deleter::should_use;
+
   cdeque() {}
 
-  ~cdeque() {}
+  ~cdeque() {
+    if (Top_item_deleter::should_use)
+      top_layer.rec_deep_free(depth0);
+  }
 
   cdeque(const self_type& other) {
     top_layer.rec_copy(depth0, other.top_layer);
@@ -10,6 +10,8 @@
  *
  */
 
+#include <memory>
+
 #include "itemsearch.hpp"
 #include "annotation.hpp"
 
@@ -127,6 +129,9 @@ public:
   
   //! capacity in number of items
   static constexpr int capacity = queue_type::capacity;
+
+  //! whether the destructor frees the items, when used as a middle sequence
+  static constexpr bool frees_items_when_destroyed = Pointer_deleter1::should_use;
   
   //! queue structure to contain the items of the chunk
   queue_type items;
@@ -359,6 +364,16 @@ public:
   }
   */
 
+  /* Takes, as storage for the items of the empty chunk, the cells at
+   * `xs`, whose first `nb` cells hold the new items (see
+   * `fixedcapacity::base::ringbuffer_idx::adopt`)
+   */
+  void adopt(const measure_type& meas, value_type* xs, size_type nb, std::shared_ptr<void> owner) {
+    assert(empty());
+    items.adopt(xs, (int)nb, owner);
+    cached = measure(meas);
+  }
+  
   void pushn_front(const measure_type& meas, const value_type* xs, size_type nb) {
     items.pushn_front(xs, (int)nb);
     incr_frontn(meas, nb);
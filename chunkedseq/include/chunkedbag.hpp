@@ -15,6 +15,7 @@
 
 #include "fixedcapacity.hpp"
 #include "chunk.hpp"
+#include "chunkpool.hpp"
 #include "cachedmeasure.hpp"
 #include "bootchunkedseq.hpp"
 #include "ftree.hpp"
@@ -55,6 +56,7 @@ protected:
   using chunk_algebra_type = typename chunk_cache_type::algebra_type;
   using chunk_measure_type = typename chunk_cache_type::measure_type;
   using chunk_pointer = chunk_type*;
+  using chunk_allocator_type = typename Configuration::chunk_allocator_type;
   
   using middle_type = typename Configuration::middle_type;
   using middle_cache_type = typename Configuration::middle_cache_type;
@@ -118,13 +120,13 @@ protected:
   /*---------------------------------------------------------------------*/
 
   static inline chunk_pointer chunk_alloc() {
-    return new chunk_type();
+    return chunk_allocator_type::alloc();
   } 
 
   // only to free empty chunks
   static inline void chunk_free(chunk_pointer c) {
     assert(c->empty());
-    delete c;
+    chunk_allocator_type::free(c);
   }
   
   template <class Pred>
@@ -852,6 +854,7 @@ public:
 
 //  using annotation_type = annotation::annotation_builder<annotation::with_measured<middle_measured_type>>;
   using chunk_type = chunk<item_queue_type, chunk_cache_type, annotation_type>;
+  using chunk_allocator_type = typename chunkpool::policy_of<chunk_type, item_allocator_type>::type;
   
   class middle_cache_type {
   public:
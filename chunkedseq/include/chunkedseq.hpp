@@ -14,10 +14,12 @@
 
 #include "fixedcapacity.hpp"
 #include "chunk.hpp"
+#include "chunkpool.hpp"
 #include "cachedmeasure.hpp"
 #include "chunkedseqbase.hpp"
 #include "bootchunkedseq.hpp"
 #include "ftree.hpp"
+#include "persistentchunkedseq.hpp"
 
 #ifndef _PASL_DATA_CHUNKEDSEQ_H_
 #define _PASL_DATA_CHUNKEDSEQ_H_
@@ -96,6 +98,7 @@ public:
 #endif
   using annotation_type = annotation::annotation_builder<cached_prefix_type, parent_pointer_type>;
   using chunk_type = chunk<item_queue_type, chunk_cache_type, annotation_type>;
+  using chunk_allocator_type = typename chunkpool::policy_of<chunk_type, item_allocator_type>::type;
 
   class middle_cache_type {
   public:
@@ -239,6 +242,176 @@ using stack = deque<Item, Chunk_capacity, Cache, fixedcapacity::heap_allocated::
 
 } // end namespace bootstrapped
 
+/*---------------------------------------------------------------------*/
+/* Instantiations for the persistent chunked sequence
+ *
+ * Copies take constant time, and share the middle sequence and its
+ * chunks with the original, until either is modified; see
+ * `persistentchunkedseq::pdeque`.
+ */
+
+namespace persistent {
+
+/*!
+ * \class deque
+ * \brief Chunked sequence with constant-time copies
+ *
+ * The chunks of the middle sequence may be shared with copies of the
+ * container, and only the chunks that are popped are unshared. For
+ * this reason, this container grants read-only access to its items:
+ * it provides neither iterators nor the mutable forms of `operator[]`,
+ * `for_each` and `for_each_segment`. Items are updated by pops and
+ * pushes, and containers are cut and joined by `split` and `concat`.
+ */
+
+template <
+  class Item,
+  int Chunk_capacity=512,
+  class Cache = cachedmeasure::trivial<Item, size_t>,
+  template <
+    class Chunk_item,
+    int Capacity,
+    class Chunk_item_alloc = std::allocator<Item>
+  >
+  class Chunk_struct = fixedcapacity::heap_allocated::ringbuffer_ptrx,
+  class Item_alloc = std::allocator<Item>
+>
+class deque
+  : private chunkedseqbase<basic_deque_configuration<Item, Chunk_capacity, Cache, Chunk_struct, persistentchunkedseq::pdeque, Item_alloc>> {
+private:
+
+  using base_type = chunkedseqbase<basic_deque_configuration<Item, Chunk_capacity, Cache, Chunk_struct, persistentchunkedseq::pdeque, Item_alloc>>;
+
+public:
+
+  using self_type = deque<Item, Chunk_capacity, Cache, Chunk_struct, Item_alloc>;
+  using config_type = typename base_type::config_type;
+  using size_type = typename base_type::size_type;
+  using difference_type = typename base_type::difference_type;
+  using allocator_type = typename base_type::allocator_type;
+  using value_type = typename base_type::value_type;
+  using reference = typename base_type::reference;
+  using const_reference = typename base_type::const_reference;
+  using pointer = typename base_type::pointer;
+  using const_pointer = typename base_type::const_pointer;
+  using cache_type = typename base_type::cache_type;
+  using measured_type = typename base_type::measured_type;
+  using algebra_type = typename base_type::algebra_type;
+  using measure_type = typename base_type::measure_type;
+
+  using base_type::chunk_capacity;
+  using base_type::releases_adopted_blocks;
+
+  deque() { }
+
+  deque(size_type n, const value_type& val)
+  : base_type(n, val) { }
+
+  deque(std::initializer_list<value_type> l)
+  : base_type(l) { }
+
+  //! Constant time
+  deque(const self_type& other)
+  : base_type(other) { }
+
+  using base_type::empty;
+  using base_type::size;
+
+  using base_type::front;
+  using base_type::back;
+  using base_type::frontn;
+  using base_type::backn;
+  using base_type::stream_frontn;
+  using base_type::stream_backn;
+
+  value_type operator[](size_type n) const {
+    return base_type::operator[](n);
+  }
+
+  using base_type::push_front;
+  using base_type::push_back;
+  using base_type::pop_front;
+  using base_type::pop_back;
+  using base_type::pushn_front;
+  using base_type::pushn_back;
+  using base_type::popn_front;
+  using base_type::popn_back;
+  using base_type::stream_pushn_front;
+  using base_type::stream_pushn_back;
+  using base_type::stream_popn_front;
+  using base_type::stream_popn_back;
+  using base_type::chunkwise_pushn_back;
+  using base_type::tabulate_pushn_back;
+  using base_type::adopt_pushn_back;
+  using base_type::save;
+  using base_type::load;
+  using base_type::clear;
+
+  void concat(self_type& other) {
+    base_type::concat(other);
+  }
+
+  template <class Pred>
+  bool split(const Pred& p, reference middle_item, self_type& other) {
+    return base_type::split(p, middle_item, other);
+  }
+
+  template <class Pred>
+  void split(const Pred& p, self_type& other) {
+    base_type::split(p, other);
+  }
+
+  void split(size_type i, self_type& other) {
+    base_type::split(i, other);
+  }
+
+  void split_approximate(self_type& other) {
+    base_type::split_approximate(other);
+  }
+
+  void swap(self_type& other) {
+    base_type::swap(other);
+  }
+
+  //! Applies `f` to a constant reference to each item, from left to right
+  template <class Body>
+  void for_each(const Body& f) const {
+    base_type::for_each([&] (const value_type& x) {
+      f(x);
+    });
+  }
+
+  //! Applies `f` to the bounds of each segment, as constant pointers
+  template <class Body>
+  void for_each_segment(const Body& f) const {
+    base_type::for_each_segment([&] (const_pointer lo, const_pointer hi) {
+      f(lo, hi);
+    });
+  }
+
+  using base_type::get_cached;
+  using base_type::get_measure;
+  using base_type::set_measure;
+
+  void copy_measure_to(self_type& other) {
+    base_type::copy_measure_to(other);
+  }
+
+  using base_type::check;
+  using base_type::print;
+
+};
+
+template <
+  class Item,
+  int Chunk_capacity = 512,
+  class Cache = cachedmeasure::trivial<Item, size_t>,
+  class Item_alloc = std::allocator<Item>
+>
+using stack = deque<Item, Chunk_capacity, Cache, fixedcapacity::heap_allocated::stack, Item_alloc>;
+
+} // end namespace persistent
+
 /*---------------------------------------------------------------------*/
 /* Instantiations for the finger tree */
 
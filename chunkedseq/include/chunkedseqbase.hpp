@@ -17,7 +17,9 @@
 #include <initializer_list>
 
 #include "iterator.hpp"
+#include "fixedcapacitybase.hpp"
 #include "chunkedseqextras.hpp"
+#include "chunkedseqio.hpp"
 
 #ifndef _PASL_DATA_CHUNKEDSEQBASE_H_
 #define _PASL_DATA_CHUNKEDSEQBASE_H_
@@ -66,6 +68,7 @@ protected:
   using chunk_algebra_type = typename chunk_cache_type::algebra_type;
   using chunk_measure_type = typename chunk_cache_type::measure_type;
   using chunk_pointer = chunk_type*;
+  using chunk_allocator_type = typename Configuration::chunk_allocator_type;
 
   using middle_type = typename Configuration::middle_type;
   using middle_cache_type = typename Configuration::middle_cache_type;
@@ -76,9 +79,14 @@ protected:
 
   using const_self_pointer_type = const chunkedseqbase<Configuration>*;
 
+public:
+
+  //! Maximum number of items in a chunk
   static constexpr int chunk_capacity = Configuration::chunk_capacity;
 
-public:
+  //! Whether the owners of the blocks adopted by `adopt_pushn_back`
+  //! are released with the chunks of the container
+  static constexpr bool releases_adopted_blocks = middle_type::frees_items_when_destroyed;
 
   /*---------------------------------------------------------------------*/
   /** @name Container-configuration types
@@ -132,13 +140,13 @@ private:
   /*---------------------------------------------------------------------*/
 
   static inline chunk_pointer chunk_alloc() {
-    return new chunk_type();
+    return chunk_allocator_type::alloc();
   }
 
   // only to free empty chunks
   static inline void chunk_free(chunk_pointer c) {
     assert(c->empty());
-    delete c;
+    chunk_allocator_type::free(c);
   }
 
   template <class Pred>
@@ -435,7 +443,7 @@ private:
       if (bsize + csize > chunk_capacity) {
         push_buffer_back_force(c);
       } else {
-        middle->pop_back(middle_meas);
+        b = middle->pop_back(middle_meas);
         c.transfer_from_front_to_back(chunk_meas, *b, csize);
         middle->push_back(middle_meas, b);
       }
@@ -455,13 +463,42 @@ private:
       if (bsize + csize > chunk_capacity) {
         push_buffer_front_force(c);
       } else {
-        middle->pop_front(middle_meas);
+        b = middle->pop_front(middle_meas);
         c.transfer_from_back_to_front(chunk_meas, *b, csize);
         middle->push_front(middle_meas, b);
       }
     }
   }
 
+  /* adds `nb` items at the back, in fresh chunks: the call
+   * `fill_chunk(c, lo, m)` stores in the empty chunk `c` the `m` new
+   * items at positions `[lo, lo + m)`, for each chunk, via `loop`
+   * (see `chunkwise_pushn_back`)
+   */
+  template <class Fill_chunk, class Loop>
+  void chunkwise_fill_back(size_type nb, const Fill_chunk& fill_chunk, const Loop& loop) {
+    if (nb == 0)
+      return;
+    size_type sz_orig = size();
+    ensure_empty_inner();
+    push_buffer_back(back_outer);
+    size_type cap = (size_type)chunk_capacity;
+    size_type nb_chunks = (nb + cap - 1) / cap;
+    std::vector<chunk_pointer> chunks(nb_chunks);
+    auto fill = [&] (size_type k) {
+      size_type lo = k * cap;
+      size_type m = std::min(cap, nb - lo);
+      chunks[k] = chunk_alloc();
+      fill_chunk(*chunks[k], lo, m);
+    };
+    loop(nb_chunks, fill);
+    for (size_type k = 0; k < nb_chunks; k++)
+      middle->push_back(middle_meas, chunks[k]);
+    restore_back_outer_empty_other_empty();
+    restore_both_outer_empty_middle_empty();
+    assert(sz_orig + nb == size());
+  }
+
   void init() {
     middle.reset(new middle_type());
   }
@@ -1070,6 +1107,126 @@ public:
     assert(sz_orig + nb == size());
   }
 
+  /*!
+   * \brief Adds items at the end, by whole chunks
+   *
+   * Adds `nb` new items to the back of the container, after its
+   * current last item.
+   *
+   * The new items are written in place into fresh chunks, all full but
+   * the last one: chunk `k` receives the new items at positions
+   * `[k * chunk_capacity, (k + 1) * chunk_capacity)`, which are written,
+   * in order, by the loop body `make_body(k * chunk_capacity)`. This
+   * body implements the interface \ref foreach_loop_body.
+   *
+   * The chunks are filled by the call `loop(nb_chunks, fill)`, which
+   * must call `fill(k)` once for each `k` in `[0, nb_chunks)`; the calls
+   * of `fill` write to distinct chunks, and thus may run in parallel.
+   * The chunks, whose cached measures are then up to date, are finally
+   * pushed on the middle sequence, in order, without further copying
+   * of items.
+   *
+   * \param nb Number of items to be inserted.
+   * \param make_body function to create the loop body of a chunk
+   * \param loop function to iterate over the chunks
+   *
+   * #### Complexity ####
+   * Linear in the number of inserted items, for the filling of the
+   * chunks, plus amortized constant time for each new chunk, for the
+   * pushes on the middle sequence.
+   *
+   */
+  template <class Make_body, class Loop>
+  void chunkwise_pushn_back(size_type nb, const Make_body& make_body, const Loop& loop) {
+    chunkwise_fill_back(nb, [&] (chunk_type& c, size_type lo, size_type m) {
+      c.pushn_back(chunk_meas, make_body(lo), m);
+    }, loop);
+  }
+
+  /*!
+   * \brief Adds items at the end, by whole chunks
+   *
+   * Same as `chunkwise_pushn_back`, where the item at position `i`
+   * among the new ones is `body(i)`.
+   *
+   */
+  template <class Body, class Loop>
+  void tabulate_pushn_back(size_type nb, const Body& body, const Loop& loop) {
+    using tabulate_type = fixedcapacity::base::tabulate_foreach_body<allocator_type, Body>;
+    chunkwise_pushn_back(nb, [&] (size_type lo) {
+      return tabulate_type(body, lo);
+    }, loop);
+  }
+
+  class sequential_chunk_loop {
+  public:
+    template <class Fill>
+    void operator()(size_type nb_chunks, const Fill& fill) const {
+      for (size_type k = 0; k < nb_chunks; k++)
+        fill(k);
+    }
+  };
+
+  //! Same as above, with the chunks filled one after the other
+  template <class Body>
+  void tabulate_pushn_back(size_type nb, const Body& body) {
+    tabulate_pushn_back(nb, body, sequential_chunk_loop());
+  }
+
+  /*!
+   * \brief Adds items at the end, by adopting blocks of memory as chunks
+   *
+   * Adds `nb` new items to the back of the container, after its
+   * current last item, without copying them: the new items at positions
+   * `[k * chunk_capacity, (k + 1) * chunk_capacity)` are already stored
+   * in the first cells of the block at address
+   * `first_block + k * block_szb`, which becomes the array of a new
+   * chunk. Each block must have room for all the cells of a chunk
+   * array, and `chunk_capacity + 1` items are enough for all the
+   * heap-allocated chunk structures.
+   *
+   * The blocks belong to `owner`, e.g., a file mapping, which is kept
+   * alive by the chunks; the blocks are never freed by the container.
+   * A middle sequence that does not free its chunks when it is
+   * destroyed (see `releases_adopted_blocks`) never releases `owner`
+   * either.
+   *
+   * #### Complexity ####
+   * Amortized constant time for each new chunk, plus the time to
+   * compute the cached measures of the chunks.
+   *
+   */
+  void adopt_pushn_back(size_type nb, char* first_block, size_t block_szb, std::shared_ptr<void> owner) {
+    chunkwise_fill_back(nb, [&] (chunk_type& c, size_type lo, size_type m) {
+      char* block = first_block + (lo / chunk_capacity) * block_szb;
+      c.adopt(chunk_meas, (value_type*)block, m, owner);
+    }, sequential_chunk_loop());
+  }
+  
+  /*!
+   * \brief Writes the items to a file
+   *
+   * See `io::save` for the requirements on the items and for the
+   * format of the file.
+   *
+   */
+  void save(const std::string& path) const {
+    io::save(*this, path);
+  }
+  
+  /*!
+   * \brief Appends the items read from a file
+   *
+   * Adds to the back of the container the items of a file written by
+   * `save`. If `mapped` is set, the file is mapped in memory and the
+   * chunks of the container are served directly from the mapping; see
+   * `io::load`.
+   *
+   */
+  void load(const std::string& path, bool mapped = false) {
+    io::load(*this, path, mapped);
+  }
+
   /*!
    * \brief Adds items at the beginning
    *
@@ -1226,8 +1383,8 @@ public:
       size_type nb1 = c1->size();
       size_type nb2 = c2->size();
       if (nb1 + nb2 <= chunk_capacity) {
-        middle->pop_back(middle_meas);
-        other.middle->pop_front(middle_meas);
+        c1 = middle->pop_back(middle_meas);
+        c2 = other.middle->pop_front(middle_meas);
         c2->transfer_from_front_to_back(chunk_meas, *c1, nb2);
         chunk_free(c2);
         middle->push_back(middle_meas, c1);
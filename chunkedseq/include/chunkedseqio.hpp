@@ -0,0 +1,212 @@
+/*!
+ * \author Umut A. Acar
+ * \author Arthur Chargueraud
+ * \author Mike Rainey
+ * \date 2013-2018
+ * \copyright 2014 Umut A. Acar, Arthur Chargueraud, Mike Rainey
+ *
+ * \brief Binary files of chunked structures, loaded by copy or by mapping
+ * \file chunkedseqio.hpp
+ *
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "atomic.hpp"
+
+#ifndef _PASL_DATA_CHUNKEDSEQIO_H_
+#define _PASL_DATA_CHUNKEDSEQIO_H_
+
+namespace pasl {
+namespace data {
+namespace chunkedseq {
+namespace io {
+
+/***********************************************************************/
+
+/*---------------------------------------------------------------------*/
+/* File format
+ *
+ * A file starts with a header of `file_header_szb` bytes, which holds
+ * the 64-bit words:
+ *
+ *   magic number, format version, number of bytes per item,
+ *   chunk capacity, number of bytes per block, number of items
+ *
+ * followed by zeros. Then come the blocks: block `k` stores in its
+ * first cells the items at positions `[k * cap, (k + 1) * cap)`, where
+ * `cap` is the chunk capacity, and zeros in the rest of its cells. A
+ * block has room for `cap + 1` items, i.e., for the array of any
+ * heap-allocated chunk, and its size is rounded up to a multiple of
+ * `block_align` bytes, so that each block of a mapped file can serve
+ * directly as the array of a chunk.
+ */
+
+static constexpr uint64_t CHUNKEDSEQ_FILE_MAGIC = 0xc4c5ed5e;
+static constexpr uint64_t CHUNKEDSEQ_FILE_VERSION = 1;
+
+static constexpr int file_header_nb_words = 6;
+static constexpr size_t file_header_szb = 64;
+static constexpr size_t block_align = 64;
+
+template <class Item>
+size_t block_szb_of(size_t chunk_capacity) {
+  size_t szb = sizeof(Item) * (chunk_capacity + 1);
+  return (szb + block_align - 1) / block_align * block_align;
+}
+
+/*---------------------------------------------------------------------*/
+/* Save and load */
+
+/*!
+ * \brief Writes the items of a container to a file
+ *
+ * The items must be trivially copyable: their bytes are written as
+ * they are, one block per `chunk_capacity` items, whatever the chunks
+ * of `c`. The items are gathered in blocks by `for_each_segment`.
+ *
+ */
+template <class Container>
+void save(const Container& c, const std::string& path) {
+  using value_type = typename Container::value_type;
+  using const_pointer = const value_type*;
+  static_assert(std::is_trivially_copyable<value_type>::value,
+                "chunkedseq::io::save: items must be trivially copyable");
+  size_t cap = Container::chunk_capacity;
+  size_t block_szb = block_szb_of<value_type>(cap);
+  std::ofstream out(path, std::ofstream::binary);
+  if (! out)
+    util::atomic::die("chunkedseq::io::save: cannot open %s\n", path.c_str());
+  char header[file_header_szb];
+  memset(header, 0, file_header_szb);
+  uint64_t words[file_header_nb_words] = {
+    CHUNKEDSEQ_FILE_MAGIC, CHUNKEDSEQ_FILE_VERSION, uint64_t(sizeof(value_type)),
+    uint64_t(cap), uint64_t(block_szb), uint64_t(c.size())
+  };
+  memcpy(header, words, sizeof(words));
+  out.write(header, file_header_szb);
+  std::vector<char> block(block_szb, 0);
+  value_type* items = (value_type*)block.data();
+  size_t nb_in_block = 0;
+  c.for_each_segment([&] (const_pointer lo, const_pointer hi) {
+    while (lo < hi) {
+      size_t m = std::min(size_t(hi - lo), cap - nb_in_block);
+      memcpy(items + nb_in_block, lo, m * sizeof(value_type));
+      nb_in_block += m;
+      lo += m;
+      if (nb_in_block == cap) {
+        out.write(block.data(), block_szb);
+        nb_in_block = 0;
+      }
+    }
+  });
+  if (nb_in_block > 0) {
+    memset(items + nb_in_block, 0, (cap - nb_in_block) * sizeof(value_type));
+    out.write(block.data(), block_szb);
+  }
+  out.close();
+  if (! out)
+    util::atomic::die("chunkedseq::io::save: failed to write %s\n", path.c_str());
+}
+
+/*!
+ * \brief Appends to a container the items of a file written by `save`
+ *
+ * In both modes, the file is mapped in memory, and thus read without
+ * any parsing.
+ *
+ * If `mapped` is false, the blocks are copied into fresh chunks, and
+ * the mapping is released before returning.
+ *
+ * If `mapped` is true, and if the chunk capacity of the file is the
+ * one of the container, the blocks are adopted as they are by new
+ * chunks (see `adopt_pushn_back`), which requires heap-allocated
+ * chunks; the cost of the load is then that of the page faults on the
+ * first accesses to the items. The mapping is private: the first write
+ * to a page of the mapping, e.g., by a push or a pop, copies the page,
+ * which leaves the file unchanged. The mapping is released when the
+ * last chunk that uses it is freed; note that a chunk recycled by a
+ * chunk pool keeps its array, and thus the mapping. A file of another
+ * chunk capacity is copied as if `mapped` were false. A container
+ * whose middle sequence does not free its chunks (see
+ * `releases_adopted_blocks`) would never release the mapping, and
+ * cannot be loaded with `mapped` set.
+ *
+ */
+template <class Container>
+void load(Container& c, const std::string& path, bool mapped = false) {
+  using value_type = typename Container::value_type;
+  using const_pointer = const value_type*;
+  static_assert(std::is_trivially_copyable<value_type>::value,
+                "chunkedseq::io::load: items must be trivially copyable");
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    util::atomic::die("chunkedseq::io::load: cannot open %s\n", path.c_str());
+  struct stat st;
+  uint64_t words[file_header_nb_words];
+  if (fstat(fd, &st) != 0
+      || size_t(st.st_size) < file_header_szb
+      || pread(fd, words, sizeof(words), 0) != ssize_t(sizeof(words)))
+    util::atomic::die("chunkedseq::io::load: cannot read %s\n", path.c_str());
+  if (words[0] != CHUNKEDSEQ_FILE_MAGIC || words[1] != CHUNKEDSEQ_FILE_VERSION)
+    util::atomic::die("chunkedseq::io::load: %s is not a chunkedseq file\n", path.c_str());
+  if (words[2] != sizeof(value_type))
+    util::atomic::die("chunkedseq::io::load: %s holds items of %ld bytes, expected %ld\n",
+                      path.c_str(), (long)words[2], (long)sizeof(value_type));
+  size_t cap = size_t(words[3]);
+  size_t block_szb = size_t(words[4]);
+  size_t nb = size_t(words[5]);
+  size_t nb_blocks = (cap == 0) ? 0 : (nb + cap - 1) / cap;
+  size_t file_szb = size_t(st.st_size);
+  if (cap == 0
+      || block_szb != block_szb_of<value_type>(cap)
+      || file_szb != file_header_szb + nb_blocks * block_szb)
+    util::atomic::die("chunkedseq::io::load: bogus file %s\n", path.c_str());
+  if (nb == 0) {
+    close(fd);
+    return;
+  }
+  if (mapped && ! Container::releases_adopted_blocks)
+    util::atomic::die("chunkedseq::io::load: the container would never release the mapping of %s\n",
+                      path.c_str());
+  bool adopt = mapped && cap == size_t(Container::chunk_capacity);
+  int prot = adopt ? (PROT_READ | PROT_WRITE) : PROT_READ;
+  int flags = adopt ? MAP_PRIVATE : (MAP_PRIVATE | MAP_POPULATE);
+  void* p = mmap(NULL, file_szb, prot, flags, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED)
+    util::atomic::die("chunkedseq::io::load: failed to map %s\n", path.c_str());
+  char* first_block = (char*)p + file_header_szb;
+  if (adopt) {
+    std::shared_ptr<void> mapping(p, [file_szb] (void* p) {
+      munmap(p, file_szb);
+    });
+    c.adopt_pushn_back(nb, first_block, block_szb, mapping);
+  } else {
+    for (size_t k = 0; k < nb_blocks; k++) {
+      size_t m = std::min(cap, nb - k * cap);
+      c.pushn_back((const_pointer)(first_block + k * block_szb), m);
+    }
+    munmap(p, file_szb);
+  }
+}
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_DATA_CHUNKEDSEQIO_H_ */
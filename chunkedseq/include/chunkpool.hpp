@@ -0,0 +1,239 @@
+/*!
+ * \author Umut A. Acar
+ * \author Arthur Chargueraud
+ * \author Mike Rainey
+ * \date 2013-2018
+ * \copyright 2014 Umut A. Acar, Arthur Chargueraud, Mike Rainey
+ *
+ * \brief Allocation policies for the chunks of chunked sequences
+ * \file chunkpool.hpp
+ *
+ */
+
+#include <pthread.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifndef _PASL_DATA_CHUNKPOOL_H_
+#define _PASL_DATA_CHUNKPOOL_H_
+
+namespace pasl {
+namespace data {
+namespace chunkpool {
+
+/***********************************************************************/
+
+/*---------------------------------------------------------------------*/
+/* Policies
+ *
+ * A policy provides `static Chunk* alloc()`, which returns an empty
+ * chunk, and `static void free(Chunk* c)`, which takes back an empty
+ * chunk. Chunks that still hold items are deleted by the containers,
+ * regardless of the policy.
+ */
+
+//! Allocates every chunk with `new`, and its buffer with it
+template <class Chunk>
+class plain {
+public:
+
+  static Chunk* alloc() {
+    return new Chunk();
+  }
+
+  static void free(Chunk* c) {
+    delete c;
+  }
+
+};
+
+/*!
+ * \class recycling
+ * \brief Keeps the empty chunks for reuse, together with their buffers
+ * \tparam Chunk type of the chunk
+ * \tparam Batch number of chunks moved at once between a thread and
+ * the depot
+ * \tparam Max_depot_batches maximal number of batches in the depot
+ *
+ * Each thread keeps its own free list of chunks, which it accesses
+ * without synchronization. A thread whose list reaches `2 * Batch`
+ * chunks moves `Batch` of them, in one step, to a global depot; a
+ * thread whose list is empty takes a batch from the depot, if any,
+ * before allocating a new chunk. A thread that terminates moves its
+ * list to the depot. A batch that finds the depot full is deleted, so
+ * that the chunks kept after a peak of allocations are bounded by
+ * `Max_depot_batches * Batch`, plus `2 * Batch` per thread.
+ *
+ * A recycled chunk keeps its buffer, so that the chunks that are
+ * pushed and popped at a steady rate, as by FIFO queues, cost no call
+ * to the allocator. The buffer cannot be laid out in the same block as
+ * the chunk, because containers swap the buffers of their chunks.
+ */
+template <class Chunk, int Batch = 32, int Max_depot_batches = 64>
+class recycling {
+private:
+
+  using batch_type = std::vector<Chunk*>;
+
+  class depot_type {
+  public:
+    std::mutex lock;
+    std::vector<batch_type> batches;
+
+    ~depot_type() {
+      for (batch_type& b : batches)
+        for (Chunk* c : b)
+          delete c;
+    }
+  };
+
+  static depot_type& depot() {
+    static depot_type d;
+    return d;
+  }
+
+  class local_type {
+  public:
+    batch_type chunks;
+
+    local_type() {
+      chunks.reserve(2 * Batch);
+    }
+  };
+
+  static void push_to_depot(batch_type&& b) {
+    depot_type& d = depot();
+    {
+      std::lock_guard<std::mutex> guard(d.lock);
+      if ((int)d.batches.size() < Max_depot_batches) {
+        d.batches.push_back(std::move(b));
+        return;
+      }
+    }
+    for (Chunk* c : b)
+      delete c;
+    b.clear();
+  }
+
+  static void move_to_depot(local_type* l) {
+    if (l->chunks.empty())
+      return;
+    push_to_depot(std::move(l->chunks));
+  }
+
+  // called on the termination of a thread that has a list
+  static void release(void* p) {
+    local_type* l = (local_type*)p;
+    move_to_depot(l);
+    delete l;
+  }
+
+  /* The lists are released through a pthread key rather than by the
+   * destructor of a `thread_local` object, whose registration does not
+   * mix with allocators that are interposed at link time, such as
+   * malloc_count. The main thread, for which the key does not fire,
+   * moves its chunks to the depot when the key is destroyed, at exit.
+   */
+  class key_type {
+  public:
+    pthread_key_t key;
+
+    key_type() {
+      depot(); // constructs the depot first, so that it is destroyed last
+      pthread_key_create(&key, &release);
+    }
+
+    ~key_type() {
+      void* p = pthread_getspecific(key);
+      if (p != nullptr)
+        move_to_depot((local_type*)p);
+    }
+  };
+
+  static local_type& local() {
+    static thread_local local_type* l = nullptr;
+    if (l == nullptr) {
+      static key_type k;
+      l = new local_type;
+      pthread_setspecific(k.key, l);
+    }
+    return *l;
+  }
+
+public:
+
+  static Chunk* alloc() {
+    batch_type& chunks = local().chunks;
+    if (chunks.empty()) {
+      depot_type& d = depot();
+      std::lock_guard<std::mutex> guard(d.lock);
+      if (d.batches.empty())
+        return new Chunk();
+      chunks.swap(d.batches.back());
+      d.batches.pop_back();
+    }
+    Chunk* c = chunks.back();
+    chunks.pop_back();
+    c->clear();
+    typename Chunk::annotation_type annotation;
+    c->annotation.swap(annotation);
+    return c;
+  }
+
+  static void free(Chunk* c) {
+    batch_type& chunks = local().chunks;
+    chunks.push_back(c);
+    if ((int)chunks.size() < 2 * Batch)
+      return;
+    batch_type b(chunks.end() - Batch, chunks.end());
+    chunks.resize(Batch);
+    push_to_depot(std::move(b));
+  }
+
+};
+
+/*---------------------------------------------------------------------*/
+/* Selection of the policy by the item allocator
+ *
+ * The policy of a container is determined by its `Item_alloc`
+ * parameter: `recycling_allocator` selects `recycling`, and any other
+ * allocator selects `plain`.
+ */
+
+template <class Item, int Batch = 32, int Max_depot_batches = 64>
+class recycling_allocator : public std::allocator<Item> {
+public:
+
+  template <class Other>
+  class rebind {
+  public:
+    using other = recycling_allocator<Other, Batch, Max_depot_batches>;
+  };
+
+  recycling_allocator() { }
+
+  template <class Other>
+  recycling_allocator(const recycling_allocator<Other, Batch, Max_depot_batches>&) { }
+
+};
+
+template <class Chunk, class Item_alloc>
+class policy_of {
+public:
+  using type = plain<Chunk>;
+};
+
+template <class Chunk, class Item, int Batch, int Max_depot_batches>
+class policy_of<Chunk, recycling_allocator<Item, Batch, Max_depot_batches>> {
+public:
+  using type = recycling<Chunk, Batch, Max_depot_batches>;
+};
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_DATA_CHUNKPOOL_H_ */
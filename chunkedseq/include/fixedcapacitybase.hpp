@@ -35,10 +35,18 @@ template <class Item, int Capacity>
 class heap_allocator {
 private:
   
+  /* The array is freed, unless it belongs to an `owner`, e.g., a
+   * file mapping, in which case the reference to the owner is dropped
+   */
   class Deleter {
   public:
+    std::shared_ptr<void> owner;
+    Deleter() { }
+    Deleter(std::shared_ptr<void> owner)
+    : owner(owner) { }
     void operator()(Item* items) {
-      free(items);
+      if (owner == nullptr)
+        free(items);
     }
   };
   
@@ -75,6 +83,12 @@ public:
     std::swap(items, other.items);
   }
   
+  //! Replaces the array by the `capacity` cells at `p`, which belong to `owner`
+  void adopt(Item* p, std::shared_ptr<void> owner) {
+    assert(p != NULL);
+    items = std::unique_ptr<Item[], Deleter>(p, Deleter(owner));
+  }
+  
 };
 
 template <class Item, int Capacity>
@@ -325,7 +339,33 @@ public:
   void operator()(size_type i, reference dst) const {
     body(dst);
   }
-  
+
+};
+
+/*! \brief Loop body for array tabulation by position
+ *
+ * Implements the interface \ref foreach_loop_body
+ *
+ * This loop body writes to the cell at logical position `i` the
+ * value of `body(start + i)`.
+ */
+template <class Alloc, class Body>
+class tabulate_foreach_body {
+public:
+  typedef Alloc allocator_type;
+  typedef typename Alloc::size_type size_type;
+  typedef typename Alloc::reference reference;
+
+  const Body& body;
+  size_type start;
+
+  tabulate_foreach_body(const Body& body, size_type start = 0)
+  : body(body), start(start) { }
+
+  void operator()(size_type i, reference dst) const {
+    dst = body(start + i);
+  }
+
 };
 
 /*! \brief Polymorphic apply-to-each item
@@ -666,6 +706,19 @@ public:
     array.swap(other.array);
   }
   
+  /* Replaces the array of the empty container by the cells at
+   * `items`, which belong to `owner` (see `heap_allocator::adopt`),
+   * and whose first `nb` cells already hold the items of the
+   * container; the items are neither copied nor constructed.
+   */
+  void adopt(value_type* items, int nb, std::shared_ptr<void> owner) {
+    assert(empty());
+    assert(0 <= nb && nb <= capacity);
+    array.adopt(items, owner);
+    fr = 0;
+    sz = nb;
+  }
+  
   segment_type segment_by_index(int i) const {
     assert(i >= 0);
     assert(i < size());
@@ -1055,6 +1108,15 @@ public:
     array.swap(other.array);
   }
   
+  //! Same as `ringbuffer_idx::adopt`
+  void adopt(value_type* items, int nb, std::shared_ptr<void> owner) {
+    assert(empty());
+    assert(0 <= nb && nb <= capacity);
+    array.adopt(items, owner);
+    fr = beg();
+    bk = (nb == 0) ? end() : beg() + nb - 1;
+  }
+  
   segment_type segment_by_index(int i) const {
     assert(i >= 0);
     assert(i < size());
@@ -1472,6 +1534,15 @@ public:
     array.swap(other.array);
   }
   
+  //! Same as `ringbuffer_idx::adopt`
+  void adopt(value_type* items, int nb, std::shared_ptr<void> owner) {
+    assert(empty());
+    assert(0 <= nb && nb <= capacity);
+    array.adopt(items, owner);
+    fr = end();
+    bk = beg() + nb;
+  }
+  
   int array_index_of_logical_index(int ix) const {
     value_type* on_front_item = addr_of_front(fr);
     value_type* proj_addr_of_ix = on_front_item + ix;
@@ -1763,6 +1834,14 @@ public:
     std::swap(bk, other.bk);
   }
   
+  //! Same as `ringbuffer_idx::adopt`
+  void adopt(value_type* items, size_type nb, std::shared_ptr<void> owner) {
+    assert(empty());
+    assert(0 <= nb && nb <= capacity);
+    array.adopt(items, owner);
+    bk = nb - 1;
+  }
+  
   size_type index_of_last_item() const {
     size_type sz = size();
     return (sz > 0) ? sz - 1 : sz;
@@ -160,8 +160,10 @@ public:
       node::make_leaf();
     }
     
+    // copies the item by `Top_item_copier`, for the copy of a tree to
+    // own its items
     leaf_node(const leaf_node& other)
-    : node(other), item(other.item) { }
+    : node(other), item(Top_item_copier::should_use ? Top_item_copier::copy(other.item) : other.item) { }
     
     measured_type get_cached() const {
       measure_type meas_fct;
@@ -280,6 +282,18 @@ public:
     return new_node;
   }
   
+  static void node_deep_free(node* n) {
+    if (n->is_leaf()) {
+      if (Top_item_deleter::should_use)
+        Top_item_deleter::dealloc(leaf_node::force(n)->item);
+    } else {
+      branch_node* b = branch_node::force(n);
+      for (int i = 0; i < b->nb_branches(); i++)
+        node_deep_free(b->get_branch(i));
+    }
+    delete n;
+  }
+
   template <class Body>
   static void node_for_each(const Body& body, const node* n) {
     if (n->is_leaf()) {
@@ -473,6 +487,11 @@ public:
       for (int i = 0; i < size(); i++)
         node_for_each(body, d[i]);
     }
+
+    void deep_free() {
+      for (size_type i = 0; i < size(); i++)
+        node_deep_free(d[i]);
+    }
     
     void swap(digit& other) {
       d.swap(other.d);
@@ -813,6 +832,16 @@ public:
     return leaf_node::force(_front());
   }
   
+  // recursively deallocate the nodes of the tree, and the items of the
+  // leaves by `Top_item_deleter`, leaving the tree in an unstable state;
+  // only use this function to implement the destructor of `tftree`
+  void _deep_free() {
+    fr.deep_free();
+    if (deep())
+      middle->_deep_free();
+    bk.deep_free();
+  }
+
   template <class Body>
   void _for_each(const Body& body) const {
     if (empty())
@@ -967,6 +996,9 @@ public:
   using leaf_item_type = typename ftree_type::leaf_item_type;
   using leaf_node = typename ftree_type::leaf_node;
   using algebra_type = typename ftree_type::algebra_type;
+
+  //! The destructor deallocates the items by `Top_item_deleter`
+  static constexpr bool frees_items_when_destroyed = Top_item_deleter::should_use;
   
   ftree_type* ft;
   
@@ -979,6 +1011,7 @@ public:
   }
   
   ~tftree() {
+    ft->_deep_free();
     delete ft;
   }
   
@@ -0,0 +1,476 @@
+/*!
+ * \author Umut A. Acar
+ * \author Arthur Chargueraud
+ * \author Mike Rainey
+ * \date 2013-2018
+ * \copyright 2014 Umut A. Acar, Arthur Chargueraud, Mike Rainey
+ *
+ * \brief Persistent middle sequence, for chunked sequences with
+ * constant-time snapshots
+ * \file persistentchunkedseq.hpp
+ *
+ */
+
+#include <assert.h>
+#include <atomic>
+#include <cstdint>
+
+#include "chunk.hpp"
+#include "fixedcapacity.hpp"
+#include "cachedmeasure.hpp"
+#include "itemsearch.hpp"
+
+#ifndef _PASL_DATA_PERSISTENTCHUNKEDSEQ_H_
+#define _PASL_DATA_PERSISTENTCHUNKEDSEQ_H_
+
+namespace pasl {
+namespace data {
+namespace chunkedseq {
+namespace persistentchunkedseq {
+
+/***********************************************************************/
+
+/*!
+ * \class pdeque
+ * \brief Sequence of chunk pointers whose copies share their structure
+ *
+ * This class implements the interface of the middle sequence of
+ * `chunkedseqbase`, as does `bootchunkedseq::cdeque`, and takes the same
+ * template parameters; the last three are unused.
+ *
+ * The sequence is represented by a treap whose nodes hold one chunk
+ * each, and cache the combined measure of their subtree. The nodes, and
+ * the chunks, are reference counted: copying a sequence only shares its
+ * root, and concatenation and splitting share all the subtrees that
+ * they do not traverse. An operation copies the nodes that it modifies
+ * when they are shared with another sequence, so that the other
+ * sequence does not observe the change (path copying).
+ *
+ * A chunk is immutable while it is shared. A chunk that is popped, or
+ * that is extracted by a split, is handed to the caller, which may
+ * modify it: the chunk is copied at this point if another sequence
+ * still refers to it. As a consequence, the containers that use this
+ * sequence must modify only the chunks that they pop; this is why
+ * `persistent::deque` gives no mutable access to its items.
+ *
+ * The reference counts are atomic, so that copies may be used, and
+ * destroyed, by other threads than the one that modifies the original.
+ *
+ * Pushing and popping take logarithmic expected time in the number of
+ * chunks, and copying takes constant time.
+ */
+template <class Top_item_base,
+          int Chunk_capacity = 32,
+          class Cached_measure = cachedmeasure::trivial<Top_item_base*, size_t>,
+          class Top_item_deleter = Pointer_deleter, // provides: static void dealloc(foo* x)
+          class Top_item_copier = Pointer_deep_copier, // provides: static void copy(foo* x)
+          template<class Item, int Capacity, class Item_alloc> class Chunk_struct = fixedcapacity::heap_allocated::ringbuffer_ptr,
+          class Size_access=itemsearch::no_size_access
+          >
+class pdeque {
+public:
+
+  using size_type = size_t;
+
+  //! The chunks are freed with the last sequence that refers to them
+  static constexpr bool frees_items_when_destroyed = true;
+
+  using top_cache_type = Cached_measure;
+  using top_measured_type = typename top_cache_type::measured_type;
+  using top_algebra_type = typename top_cache_type::algebra_type;
+  using top_measure_type = typename top_cache_type::measure_type;
+
+  using value_type = Top_item_base*;
+
+private:
+
+  using self_type = pdeque<Top_item_base, Chunk_capacity, Cached_measure,
+                           Top_item_deleter, Top_item_copier, Chunk_struct, Size_access>;
+
+  using measured_type = top_measured_type;
+  using algebra_type = top_algebra_type;
+
+  //! Shared chunk, with its measure, which does not change while shared
+  class box_type {
+  public:
+    std::atomic<int> refcount;
+    value_type item;
+    measured_type measured;
+
+    box_type(value_type item, measured_type measured)
+    : refcount(1), item(item), measured(measured) { }
+  };
+
+  class node_type {
+  public:
+    std::atomic<int> refcount;
+    unsigned priority;
+    node_type* left;
+    node_type* right;
+    box_type* box;
+    //! combined measure of the items of the subtree
+    measured_type cached;
+
+    node_type(box_type* box, unsigned priority)
+    : refcount(1), priority(priority), left(nullptr), right(nullptr), box(box),
+      cached(box->measured) { }
+  };
+
+  using node_pointer = node_type*;
+
+  node_pointer root;
+
+  /*---------------------------------------------------------------------*/
+  /* Reference counting */
+
+  static void incr(node_pointer n) {
+    if (n != nullptr)
+      n->refcount.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static void decr(box_type* b) {
+    if (b->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      Top_item_deleter::dealloc(b->item);
+      delete b;
+    }
+  }
+
+  static void decr(node_pointer n) {
+    if (n == nullptr)
+      return;
+    if (n->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      decr(n->left);
+      decr(n->right);
+      decr(n->box);
+      delete n;
+    }
+  }
+
+  static bool is_shared(const std::atomic<int>& refcount) {
+    return refcount.load(std::memory_order_acquire) != 1;
+  }
+
+  /* Takes a reference to `n` and returns a node with the same contents
+   * that is referred to only by the caller: `n` itself, or a copy. */
+  static node_pointer own(node_pointer n) {
+    if (! is_shared(n->refcount))
+      return n;
+    node_pointer m = new node_type(n->box, n->priority);
+    m->box->refcount.fetch_add(1, std::memory_order_relaxed);
+    m->left = n->left;
+    m->right = n->right;
+    m->cached = n->cached;
+    incr(m->left);
+    incr(m->right);
+    decr(n);
+    return m;
+  }
+
+  //! Takes a reference to `b` and returns its chunk, for the caller to own
+  static value_type take(box_type* b) {
+    if (! is_shared(b->refcount)) {
+      value_type x = b->item;
+      delete b;
+      return x;
+    }
+    value_type x = Top_item_copier::copy(b->item);
+    decr(b);
+    return x;
+  }
+
+  /*---------------------------------------------------------------------*/
+  /* Treap operations; each takes the references to its arguments and
+   * returns references to its results */
+
+  static unsigned priority_of(const void* p) {
+    uint64_t x = (uint64_t)(uintptr_t)p;
+    x *= 0x9e3779b97f4a7c15ull;
+    return (unsigned)(x >> 32);
+  }
+
+  static measured_type cached_of(const node_type* n) {
+    return (n == nullptr) ? algebra_type::identity() : n->cached;
+  }
+
+  static void update(node_pointer n) {
+    measured_type m = algebra_type::combine(cached_of(n->left), n->box->measured);
+    n->cached = algebra_type::combine(m, cached_of(n->right));
+  }
+
+  static node_pointer singleton(value_type x, measured_type w) {
+    box_type* b = new box_type(x, w);
+    return new node_type(b, priority_of(b));
+  }
+
+  static node_pointer merge(node_pointer a, node_pointer b) {
+    if (a == nullptr)
+      return b;
+    if (b == nullptr)
+      return a;
+    if (a->priority >= b->priority) {
+      a = own(a);
+      a->right = merge(a->right, b);
+      update(a);
+      return a;
+    } else {
+      b = own(b);
+      b->left = merge(a, b->left);
+      update(b);
+      return b;
+    }
+  }
+
+  static node_pointer pop_first(node_pointer n, box_type*& x) {
+    n = own(n);
+    if (n->left != nullptr) {
+      n->left = pop_first(n->left, x);
+      update(n);
+      return n;
+    }
+    node_pointer r = n->right;
+    x = n->box;
+    delete n;
+    return r;
+  }
+
+  static node_pointer pop_last(node_pointer n, box_type*& x) {
+    n = own(n);
+    if (n->right != nullptr) {
+      n->right = pop_last(n->right, x);
+      update(n);
+      return n;
+    }
+    node_pointer l = n->left;
+    x = n->box;
+    delete n;
+    return l;
+  }
+
+  /* Splits `n` into the items `l` before, and `r` after, the first item
+   * `x` for which `p` holds on the measure of the items up to and
+   * including `x`; returns the measure before `x`. Assumes that `p`
+   * holds on the measure of all the items of `n`. */
+  template <class Pred>
+  static measured_type split(node_pointer n, const Pred& p, measured_type prefix,
+                             node_pointer& l, box_type*& x, node_pointer& r) {
+    n = own(n);
+    measured_type before = algebra_type::combine(prefix, cached_of(n->left));
+    if (n->left != nullptr && p(before)) {
+      node_pointer rl;
+      prefix = split(n->left, p, prefix, l, x, rl);
+      n->left = rl;
+      update(n);
+      r = n;
+      return prefix;
+    }
+    measured_type upto = algebra_type::combine(before, n->box->measured);
+    if (p(upto) || n->right == nullptr) {
+      l = n->left;
+      r = n->right;
+      x = n->box;
+      delete n;
+      return before;
+    }
+    node_pointer lr;
+    prefix = split(n->right, p, upto, lr, x, r);
+    n->right = lr;
+    update(n);
+    l = n;
+    return prefix;
+  }
+
+  template <class Body>
+  static void rec_for_each(const node_type* n, const Body& f) {
+    if (n == nullptr)
+      return;
+    rec_for_each(n->left, f);
+    value_type x = n->box->item;
+    f(x);
+    rec_for_each(n->right, f);
+  }
+
+  static measured_type rec_check(const node_type* n) {
+    if (n == nullptr)
+      return algebra_type::identity();
+    assert(n->left == nullptr || n->left->priority <= n->priority);
+    assert(n->right == nullptr || n->right->priority <= n->priority);
+    measured_type m = algebra_type::combine(rec_check(n->left), n->box->measured);
+    return algebra_type::combine(m, rec_check(n->right));
+  }
+
+  template <class Add_edge, class Process_chunk>
+  static void rec_reveal_internal_structure(const Add_edge& add_edge,
+                                            const Process_chunk& process_chunk,
+                                            const node_type* n) {
+    if (n->left != nullptr) {
+      add_edge((void*)n, (void*)n->left);
+      rec_reveal_internal_structure(add_edge, process_chunk, n->left);
+    }
+    add_edge((void*)n, (void*)n->box->item);
+    process_chunk(n->box->item);
+    if (n->right != nullptr) {
+      add_edge((void*)n, (void*)n->right);
+      rec_reveal_internal_structure(add_edge, process_chunk, n->right);
+    }
+  }
+
+public:
+
+  pdeque() : root(nullptr) { }
+
+  //! Constant time: the copy shares all its nodes with `other`
+  pdeque(const self_type& other) : root(other.root) {
+    incr(root);
+  }
+
+  ~pdeque() {
+    decr(root);
+  }
+
+  void swap(self_type& other) {
+    std::swap(root, other.root);
+  }
+
+  inline bool empty() const {
+    return root == nullptr;
+  }
+
+  inline measured_type get_cached() const {
+    return cached_of(root);
+  }
+
+  inline void push_front(const top_measure_type& top_meas, const value_type& x) {
+    root = merge(singleton(x, top_meas(x)), root);
+    check();
+  }
+
+  inline void push_back(const top_measure_type& top_meas, const value_type& x) {
+    root = merge(root, singleton(x, top_meas(x)));
+    check();
+  }
+
+  inline value_type front() const {
+    const node_type* n = root;
+    while (n->left != nullptr)
+      n = n->left;
+    return n->box->item;
+  }
+
+  inline value_type back() const {
+    const node_type* n = root;
+    while (n->right != nullptr)
+      n = n->right;
+    return n->box->item;
+  }
+
+  inline value_type cback() const {
+    return back();
+  }
+
+  //! Returns the first chunk, which the caller then owns and may modify
+  inline value_type pop_front(const top_measure_type&) {
+    box_type* x;
+    root = pop_first(root, x);
+    check();
+    return take(x);
+  }
+
+  //! Returns the last chunk, which the caller then owns and may modify
+  inline value_type pop_back(const top_measure_type&) {
+    box_type* x;
+    root = pop_last(root, x);
+    check();
+    return take(x);
+  }
+
+  // concatenate the items of "other" to the right of the current sequence,
+  // in place; leaves the "other" structure empty.
+  void concat(const top_measure_type&, self_type& other) {
+    root = merge(root, other.root);
+    other.root = nullptr;
+    check();
+  }
+
+  template <class Pred>
+  measured_type search_for_chunk(const Pred& p, measured_type prefix,
+                                 const Top_item_base*& c) const {
+    const node_type* n = root;
+    while (true) {
+      measured_type before = algebra_type::combine(prefix, cached_of(n->left));
+      if (n->left != nullptr && p(before)) {
+        n = n->left;
+        continue;
+      }
+      measured_type upto = algebra_type::combine(before, n->box->measured);
+      if (p(upto) || n->right == nullptr) {
+        c = n->box->item;
+        return before;
+      }
+      prefix = upto;
+      n = n->right;
+    }
+  }
+
+  /* 3-way splitting; assumes `other` to be empty; the chunk `x` is then
+   * owned by the caller */
+  template <class Pred>
+  measured_type split(const top_measure_type&,
+                      const Pred& p,
+                      measured_type prefix,
+                      value_type& x,
+                      self_type& other) {
+    assert(other.empty());
+    node_pointer l;
+    node_pointer r;
+    box_type* b;
+    prefix = split(root, p, prefix, l, b, r);
+    root = l;
+    other.root = r;
+    x = take(b);
+    check();
+    other.check();
+    return prefix;
+  }
+
+  // 2-way splitting; assumes `other` to be empty.
+  template <class Pred>
+  measured_type split(const top_measure_type& meas,
+                      const Pred& p,
+                      measured_type prefix,
+                      self_type& other) {
+    value_type v;
+    prefix = split(meas, p, prefix, v, other);
+    other.push_front(meas, v);
+    return prefix;
+  }
+
+  template <class Body>
+  void for_each(const Body& f) const {
+    rec_for_each(root, f);
+  }
+
+  void check() {
+    #ifdef BOOTCHUNKEDSEQ_CHECK
+    rec_check(root);
+    #endif
+  }
+
+  template <class Add_edge, class Process_chunk>
+  void reveal_internal_structure(const Add_edge& add_edge,
+                                 const Process_chunk& process_chunk) const {
+    if (root == nullptr)
+      return;
+    add_edge((void*)this, (void*)root);
+    rec_reveal_internal_structure(add_edge, process_chunk, root);
+  }
+
+};
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_DATA_PERSISTENTCHUNKEDSEQ_H_ */
@@ -548,6 +548,90 @@ public:
     }
   };
   
+  // to check that the pushes on the back by whole chunks give the same
+  // container as calls to push_back, for numbers of items around the
+  // chunk capacity, on an empty container and on a non-empty one
+  class bulk_push_same : public quickcheck::Property<container_pair_type> {
+  public:
+    using size_type = typename untrusted_type::size_type;
+    using allocator_type = typename untrusted_type::allocator_type;
+
+    // fills the chunks from the last one to the first one
+    class reverse_chunk_loop {
+    public:
+      template <class Fill>
+      void operator()(size_type nb_chunks, const Fill& fill) const {
+        for (size_type k = nb_chunks; k > 0; k--)
+          fill(k - 1);
+      }
+    };
+
+    static bool check_sizes(const container_pair_type& init) {
+      size_type cap = size_type(untrusted_type::chunk_capacity);
+      size_type sizes[] = { 0, 1, cap - 1, cap, cap + 1, 3 * cap + 2 };
+      bool ok = true;
+      for (size_type nb : sizes) {
+        value_type offset = value_type(init.trusted.size());
+        auto body = [offset] (size_type i) {
+          return offset + value_type(i);
+        };
+        using body_type = fixedcapacity::base::tabulate_foreach_body<allocator_type, decltype(body)>;
+        container_pair_type tabulated(init);
+        container_pair_type chunkwise(init);
+        for (size_type i = 0; i < nb; i++) {
+          tabulated.trusted.push_back(body(i));
+          chunkwise.trusted.push_back(body(i));
+        }
+        tabulated.untrusted.tabulate_pushn_back(nb, body);
+        chunkwise.untrusted.chunkwise_pushn_back(nb, [&] (size_type lo) {
+          return body_type(body, lo);
+        }, reverse_chunk_loop());
+        bool ok1 = check_and_print_container_pair(tabulated, "tabulate_pushn_back");
+        bool ok2 = check_and_print_container_pair(chunkwise, "chunkwise_pushn_back");
+        if (! (ok1 && ok2))
+          std::cout << "nb=" << nb << std::endl;
+        ok = ok && ok1 && ok2;
+      }
+      return ok;
+    }
+
+    bool holdsFor(const container_pair_type& _items) {
+      container_pair_type items(_items);
+      if (items.trusted.empty()) {
+        items.trusted.push_back(value_type(1));
+        items.untrusted.push_back(value_type(1));
+      }
+      return check_sizes(container_pair_type()) && check_sizes(items);
+    }
+  };
+  
+  // to check that a container saved to a file and then loaded, either
+  // by copy or by mapping the file, gives the same container, including
+  // after pushes and pops on the loaded container
+  class save_load_same : public quickcheck::Property<container_pair_type> {
+  public:
+    bool holdsFor(const container_pair_type& _items) {
+      container_pair_type items(_items);
+      std::string path = "quickcheck_chunkedseq_save_load.bin";
+      items.untrusted.save(path);
+      bool mapped = flip_coin();
+      untrusted_type loaded;
+      loaded.load(path, mapped);
+      remove(path.c_str());
+      items.untrusted.swap(loaded);
+      bool ok1 = check_and_print_container_pair(items);
+      size_t nb = (size_t)quickcheck::generateInRange(0, (int)items.trusted.size());
+      for (size_t i = 0; i < nb; i++) {
+        items.trusted.pop_front();
+        items.untrusted.pop_front();
+        items.trusted.push_back(value_type(i));
+        items.untrusted.push_back(value_type(i));
+      }
+      bool ok2 = check_and_print_container_pair(items);
+      return ok1 && ok2;
+    }
+  };
+  
 };
   
 /*---------------------------------------------------------------------*/
@@ -94,6 +94,14 @@ void chunkedseq_dispatch_by_property() {
     auto msg = "we get correct results over calls to backn and frontn";
     checkit<typename Properties::backn_frontn_sequence_same>(msg);
   });
+  c.add("bulk_push", [] {
+    auto msg = "we get the same container from pushes by whole chunks as from calls to push_back";
+    checkit<typename Properties::bulk_push_same>(msg);
+  });
+  c.add("save_load", [] {
+    auto msg = "we get the same container after saving it to a file and loading it back";
+    checkit<typename Properties::save_load_same>(msg);
+  });
   print_dashes();
   util::cmdline::dispatch_by_argmap_with_default_all(c, "property");
   print_dashes();
@@ -0,0 +1,241 @@
+/*!
+ * \author Umut A. Acar
+ * \author Arthur Chargueraud
+ * \author Mike Rainey
+ * \date 2013-2018
+ * \copyright 2014 Umut A. Acar, Arthur Chargueraud, Mike Rainey
+ *
+ * \brief Randomized test of the binary files of chunked sequences
+ * \file test_chunkedseqio.cpp
+ *
+ * Each round fills a container with random pushes and pops, saves it,
+ * and loads the file back, by copy and by mapping, into containers that
+ * are compared with a model, a `std::deque`. The loaded containers and
+ * their copies are then modified, which must leave the file unchanged.
+ * In mapped mode, the test also checks, by `/proc/self/maps`, that the
+ * file stays mapped only while a container uses its blocks.
+ *
+ * Usage: `test_chunkedseqio.exe [nb_rounds] [seed]`
+ *
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include "chunkedseq.hpp"
+
+using namespace pasl::data;
+
+/***********************************************************************/
+
+struct point {
+  int x;
+  double y;
+  bool operator==(const point& other) const {
+    return x == other.x && y == other.y;
+  }
+};
+
+static std::mt19937 gen;
+static long nb_failures = 0;
+static std::string path;
+
+static int random_int(int lo, int hi) {
+  return std::uniform_int_distribution<int>(lo, hi - 1)(gen);
+}
+
+static void make_item(int& x, int i) {
+  x = i * 7 + 1;
+}
+
+static void make_item(point& x, int i) {
+  x.x = i;
+  x.y = i * 0.5;
+}
+
+static void check(bool b, const char* name, int round, const char* msg) {
+  if (b)
+    return;
+  nb_failures++;
+  printf("failed: %s round %d: %s\n", name, round, msg);
+}
+
+template <class Seq, class Model>
+bool same(const Seq& s, const Model& m) {
+  if (s.size() != m.size())
+    return false;
+  size_t i = 0;
+  bool ok = true;
+  s.for_each([&] (const typename Seq::value_type& x) {
+    ok = ok && x == m[i++];
+  });
+  return ok;
+}
+
+// Returns whether the file at `path` is mapped in the address space
+static bool is_mapped() {
+  std::ifstream maps("/proc/self/maps");
+  std::string line;
+  while (std::getline(maps, line))
+    if (line.find(path) != std::string::npos)
+      return true;
+  return false;
+}
+
+/*---------------------------------------------------------------------*/
+
+template <class Seq, class Model>
+void random_pushes_and_pops(Seq& s, Model& m, int nb) {
+  using value_type = typename Seq::value_type;
+  for (int i = 0; i < nb; i++) {
+    value_type x;
+    make_item(x, random_int(0, 1 << 20));
+    int op = random_int(0, 8);
+    if (op < 3) {
+      s.push_back(x);
+      m.push_back(x);
+    } else if (op < 6) {
+      s.push_front(x);
+      m.push_front(x);
+    } else if (op == 6 && ! m.empty()) {
+      s.pop_back();
+      m.pop_back();
+    } else if (! m.empty()) {
+      s.pop_front();
+      m.pop_front();
+    }
+  }
+}
+
+template <class Seq>
+void check_round(const char* name, int round) {
+  using value_type = typename Seq::value_type;
+  using model_type = std::deque<value_type>;
+  model_type m;
+  {
+    Seq s;
+    int nb = random_int(0, (round % 2 == 0) ? 50 : 5000);
+    random_pushes_and_pops(s, m, nb);
+    s.save(path);
+  }
+  for (int mapped = 0; mapped < 2; mapped++) {
+    bool expect_mapping = mapped && ! m.empty();
+    {
+      Seq l;
+      model_type ml = m;
+      if (random_int(0, 2)) {
+        // loads behind an item, which is then popped
+        value_type x;
+        make_item(x, -1);
+        l.push_back(x);
+        l.load(path, mapped);
+        l.pop_front();
+      } else {
+        l.load(path, mapped);
+      }
+      check(same(l, m), name, round, "a loaded container has the saved items");
+      check(is_mapped() == expect_mapping, name, round, "the file is mapped only by a mapped load");
+      {
+        Seq copy(l);
+        model_type mc = m;
+        check(same(copy, mc), name, round, "a copy of a loaded container has the saved items");
+        random_pushes_and_pops(copy, mc, 100);
+        check(same(copy, mc), name, round, "a copy of a loaded container can be modified");
+      }
+      check(same(l, m), name, round, "a loaded container is unchanged by its copies");
+      random_pushes_and_pops(l, ml, 3 * int(m.size()));
+      if (l.size() > 1) {
+        Seq other;
+        l.split(size_t(random_int(0, int(l.size()))), other);
+        l.concat(other);
+      }
+      check(same(l, ml), name, round, "a loaded container can be modified");
+      Seq c;
+      c.load(path);
+      check(same(c, m), name, round, "the file is unchanged by writes to a loaded container");
+    }
+    check(! is_mapped(), name, round, "the mapping is released with the container");
+  }
+}
+
+template <class Seq>
+void check_all(const char* name, int nb_rounds) {
+  for (int round = 0; round < nb_rounds; round++)
+    check_round<Seq>(name, round);
+}
+
+// A copy of a mapped persistent container keeps the mapping alive
+void check_persistent_copy() {
+  using seq_type = chunkedseq::persistent::deque<int, 8>;
+  seq_type s;
+  for (int i = 0; i < 1000; i++)
+    s.push_back(i);
+  s.save(path);
+  seq_type* l = new seq_type;
+  l->load(path, true);
+  seq_type* c = new seq_type(*l);
+  delete l;
+  check(is_mapped(), "persistent", 0, "a copy keeps the mapping");
+  bool ok = c->size() == 1000;
+  for (int i = 0; ok && i < 1000; i++)
+    ok = (*c)[i] == i;
+  check(ok, "persistent", 0, "a copy of a mapped container has the saved items");
+  delete c;
+  check(! is_mapped(), "persistent", 0, "the mapping is released with the last copy");
+}
+
+// A file saved with another chunk capacity is loaded by copy
+void check_other_capacity() {
+  chunkedseq::bootstrapped::deque<int, 8> s;
+  for (int i = 0; i < 1000; i++)
+    s.push_back(i);
+  s.save(path);
+  chunkedseq::persistent::deque<int, 32> l;
+  l.load(path, true);
+  check(! is_mapped(), "capacity", 0, "a file of another capacity is not mapped");
+  bool ok = l.size() == 1000;
+  for (int i = 0; ok && i < 1000; i++)
+    ok = l[i] == i;
+  check(ok, "capacity", 0, "a file of another capacity is loaded by copy");
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  int nb_rounds = (argc > 1) ? atoi(argv[1]) : 50;
+  int seed = (argc > 2) ? atoi(argv[2]) : 1;
+  gen.seed(seed);
+  char tmpl[] = "/tmp/test_chunkedseqio_XXXXXX";
+  int fd = mkstemp(tmpl);
+  if (fd < 0) {
+    printf("cannot create a temporary file\n");
+    return 1;
+  }
+  close(fd);
+  path = tmpl;
+  using cache_type = cachedmeasure::trivial<int, size_t>;
+  check_all<chunkedseq::bootstrapped::deque<int, 8>>("bootstrapped::deque", nb_rounds);
+  check_all<chunkedseq::bootstrapped::deque<int, 8, cache_type,
+            fixedcapacity::heap_allocated::ringbuffer_ptr>>("bootstrapped::deque ringbuffer_ptr", nb_rounds);
+  check_all<chunkedseq::bootstrapped::stack<int, 8>>("bootstrapped::stack", nb_rounds);
+  check_all<chunkedseq::bootstrapped::deque<point, 512>>("bootstrapped::deque point", nb_rounds);
+  check_all<chunkedseq::ftree::deque<int, 16>>("ftree::deque", nb_rounds);
+  check_all<chunkedseq::persistent::deque<int, 8>>("persistent::deque", nb_rounds);
+  check_all<chunkedseq::persistent::stack<int, 8>>("persistent::stack", nb_rounds);
+  check_all<chunkedseq::persistent::deque<point, 512>>("persistent::deque point", nb_rounds);
+  check_persistent_copy();
+  check_other_capacity();
+  unlink(path.c_str());
+  if (nb_failures == 0)
+    printf("All tests complete\n");
+  else
+    printf("%ld tests failed\n", nb_failures);
+  return (nb_failures == 0) ? 0 : 1;
+}
+
+/***********************************************************************/
@@ -0,0 +1,227 @@
+/*!
+ * \author Umut A. Acar
+ * \author Arthur Chargueraud
+ * \author Mike Rainey
+ * \date 2013-2018
+ * \copyright 2014 Umut A. Acar, Arthur Chargueraud, Mike Rainey
+ *
+ * \brief Randomized test of the isolation of the copies of the
+ * persistent chunked sequence
+ * \file test_persistentchunkedseq.cpp
+ *
+ * Each step copies one of the versions kept by the test, and applies
+ * a random modification to the copy; after every modification, the
+ * original is compared with its model, a `std::deque`. All the
+ * versions are compared with their models at the end of each round.
+ *
+ * Usage: `test_persistentchunkedseq.exe [nb_rounds] [seed]`
+ *
+ * Meant to be built with `-fsanitize=address`, and optionally with
+ * `-DBOOTCHUNKEDSEQ_CHECK`.
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "chunkedseq.hpp"
+
+using namespace pasl::data;
+
+/***********************************************************************/
+
+using item_type = int;
+using model_type = std::deque<item_type>;
+
+// A small chunk capacity, for the middle sequence to hold many chunks
+using seq_type = chunkedseq::persistent::deque<item_type, 8>;
+
+struct version_type {
+  std::unique_ptr<seq_type> seq;
+  model_type model;
+};
+
+static const int nb_steps = 400;
+static const size_t max_size = 3000;
+
+static std::mt19937 gen;
+static long nb_failures = 0;
+
+static int random_int(int lo, int hi) {
+  return std::uniform_int_distribution<int>(lo, hi - 1)(gen);
+}
+
+static bool same(const seq_type& s, const model_type& m) {
+  if (s.size() != m.size())
+    return false;
+  for (size_t i = 0; i < m.size(); i++)
+    if (s[i] != m[i])
+      return false;
+  size_t i = 0;
+  bool ok = true;
+  s.for_each([&] (const item_type& x) {
+    ok = ok && x == m[i++];
+  });
+  i = 0;
+  s.for_each_segment([&] (const item_type* lo, const item_type* hi) {
+    for (; lo < hi; lo++)
+      ok = ok && *lo == m[i++];
+  });
+  return ok && i == m.size() && s.empty() == m.empty();
+}
+
+static void check(bool b, int round, int step, const char* msg) {
+  if (b)
+    return;
+  nb_failures++;
+  printf("failed: round %d step %d: %s\n", round, step, msg);
+}
+
+/*---------------------------------------------------------------------*/
+/* Modifications, each applied to a sequence and to its model */
+
+static void push(seq_type& s, model_type& m) {
+  int nb = random_int(0, 40);
+  bool back = random_int(0, 2);
+  for (int i = 0; i < nb; i++) {
+    item_type x = random_int(0, 1 << 30);
+    if (back) {
+      s.push_back(x);
+      m.push_back(x);
+    } else {
+      s.push_front(x);
+      m.push_front(x);
+    }
+  }
+}
+
+static bool pop(seq_type& s, model_type& m) {
+  int nb = random_int(0, 40);
+  bool back = random_int(0, 2);
+  bool ok = true;
+  for (int i = 0; i < nb && ! m.empty(); i++) {
+    if (back) {
+      ok = ok && s.pop_back() == m.back();
+      m.pop_back();
+    } else {
+      ok = ok && s.pop_front() == m.front();
+      m.pop_front();
+    }
+  }
+  return ok;
+}
+
+static void pushn(seq_type& s, model_type& m) {
+  std::vector<item_type> xs(random_int(0, 100));
+  for (auto& x : xs)
+    x = random_int(0, 1 << 30);
+  if (random_int(0, 2)) {
+    s.pushn_back(xs.data(), xs.size());
+    m.insert(m.end(), xs.begin(), xs.end());
+  } else {
+    s.pushn_front(xs.data(), xs.size());
+    m.insert(m.begin(), xs.begin(), xs.end());
+  }
+}
+
+static bool popn(seq_type& s, model_type& m) {
+  size_t nb = random_int(0, int(m.size()) + 1);
+  std::vector<item_type> xs(nb);
+  if (random_int(0, 2)) {
+    s.popn_back(xs.data(), nb);
+    bool ok = std::equal(xs.begin(), xs.end(), m.end() - nb);
+    m.erase(m.end() - nb, m.end());
+    return ok;
+  } else {
+    s.popn_front(xs.data(), nb);
+    bool ok = std::equal(xs.begin(), xs.end(), m.begin());
+    m.erase(m.begin(), m.begin() + nb);
+    return ok;
+  }
+}
+
+// Splits, modifies the two parts, and joins them back
+static bool split_concat(seq_type& s, model_type& m) {
+  size_t i = random_int(0, int(m.size()) + 1);
+  seq_type other;
+  if (i < m.size())
+    s.split(i, other);
+  model_type mother(m.begin() + i, m.end());
+  m.erase(m.begin() + i, m.end());
+  bool ok = same(s, m) && same(other, mother);
+  push(s, m);
+  ok = pop(other, mother) && ok;
+  s.concat(other);
+  m.insert(m.end(), mother.begin(), mother.end());
+  return ok && other.empty();
+}
+
+// Appends a copy of another version
+static void concat_copy(seq_type& s, model_type& m, const version_type& v) {
+  seq_type c(*v.seq);
+  s.concat(c);
+  m.insert(m.end(), v.model.begin(), v.model.end());
+}
+
+/*---------------------------------------------------------------------*/
+
+static void run_round(int round) {
+  std::vector<version_type> versions;
+  versions.push_back({ std::unique_ptr<seq_type>(new seq_type), model_type() });
+  for (int step = 0; step < nb_steps; step++) {
+    version_type& orig = versions[random_int(0, int(versions.size()))];
+    version_type copy = { std::unique_ptr<seq_type>(new seq_type(*orig.seq)), orig.model };
+    seq_type& s = *copy.seq;
+    model_type& m = copy.model;
+    check(same(s, m), round, step, "a copy has the items of the original");
+    int nb_writes = random_int(1, 4);
+    for (int k = 0; k < nb_writes; k++) {
+      bool ok = true;
+      switch (random_int(0, 8)) {
+        case 0: case 1: push(s, m); break;
+        case 2: ok = pop(s, m); break;
+        case 3: pushn(s, m); break;
+        case 4: ok = popn(s, m); break;
+        case 5: ok = split_concat(s, m); break;
+        case 6:
+          if (m.size() < max_size)
+            concat_copy(s, m, versions[random_int(0, int(versions.size()))]);
+          break;
+        case 7: s.clear(); m.clear(); break;
+      }
+      check(ok, round, step, "a write to a copy gives the expected items");
+      check(same(s, m), round, step, "a copy is as its model after a write");
+      check(same(*orig.seq, orig.model), round, step, "the original is unchanged by a write to a copy");
+    }
+    if (m.size() > max_size) {
+      seq_type rest;
+      s.split(max_size / 2, rest);
+      m.erase(m.begin() + max_size / 2, m.end());
+    }
+    versions.push_back(std::move(copy));
+    if (versions.size() > 16)
+      versions.erase(versions.begin() + random_int(0, int(versions.size())));
+  }
+  for (auto& v : versions)
+    check(same(*v.seq, v.model), round, nb_steps, "every version is as its model");
+}
+
+int main(int argc, char** argv) {
+  int nb_rounds = (argc > 1) ? atoi(argv[1]) : 20;
+  int seed = (argc > 2) ? atoi(argv[2]) : 1;
+  gen.seed(seed);
+  for (int round = 0; round < nb_rounds; round++)
+    run_round(round);
+  if (nb_failures == 0)
+    printf("All tests complete\n");
+  else
+    printf("%ld tests failed\n", nb_failures);
+  return (nb_failures == 0) ? 0 : 1;
+}
+
+/***********************************************************************/
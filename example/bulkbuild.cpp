@@ -0,0 +1,120 @@
+/*!
+ * \file bulkbuild.cpp
+ * \brief Compares ways to build a chunked sequence of n items.
+ * \example bulkbuild.cpp
+ * \date 2015
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-algo <string>` (default=tabulate)
+ *       - `push`: n calls to `push_back` on a `pcontainer::deque`
+ *       - `combine`: `pcontainer::combine`, which pushes on fresh
+ *         deques and concatenates them pairwise
+ *       - `vector`: fills a `std::vector` of size n with a
+ *         `parallel_for`, as a reference
+ *       - `tabulate`: `pcontainer::tabulate`
+ *       - `from_range`: `pcontainer::from_range`, from a vector of the
+ *         items (built before the timing)
+ *   - `-n <int>` (default=1000000000)
+ *
+ * Output: the number of items and their sum, which do not depend on
+ * `algo`.
+ *
+ */
+
+#include <vector>
+
+#include "benchmark.hpp"
+#include "pcontainer.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+namespace pcontainer = pasl::data::pcontainer;
+
+/*---------------------------------------------------------------------*/
+
+using value_type = int;
+using deque_type = pcontainer::deque<value_type>;
+
+static inline value_type item_of(long i) {
+  return value_type(i % 1024);
+}
+
+template <class Container>
+long sum_of(const Container& c) {
+  long s = 0;
+  c.for_each_segment([&] (const value_type* lo, const value_type* hi) {
+    for (const value_type* p = lo; p < hi; p++)
+      s += *p;
+  });
+  return s;
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  std::string algo;
+  long n = 0;
+  std::vector<value_type> src;
+  std::vector<value_type> vec;
+  deque_type deq;
+  long nb = 0;
+  long sum = 0;
+
+  auto init = [&] {
+    algo = pasl::util::cmdline::parse_or_default_string("algo", "tabulate");
+    n = std::max(0l, (long)pasl::util::cmdline::parse_or_default_long("n", 1000000000));
+    if (algo == "from_range") {
+      src.resize(n);
+      par::parallel_for(0l, n, [&] (long i) {
+        src[i] = item_of(i);
+      });
+    }
+  };
+  auto run = [&] (bool sequential) {
+    if (algo == "push") {
+      for (long i = 0; i < n; i++)
+        deq.push_back(item_of(i));
+    } else if (algo == "combine") {
+      pcontainer::combine(0l, n, deq, [] (long i, deque_type& d) {
+        d.push_back(item_of(i));
+      });
+    } else if (algo == "vector") {
+      vec.resize(n);
+      par::parallel_for(0l, n, [&] (long i) {
+        vec[i] = item_of(i);
+      });
+    } else if (algo == "tabulate") {
+      pcontainer::tabulate(n, deq, [] (long i) {
+        return item_of(i);
+      });
+    } else if (algo == "from_range") {
+      pcontainer::from_range(src.begin(), src.end(), deq);
+    } else {
+      pasl::util::atomic::die("bogus algo %s\n", algo.c_str());
+    }
+  };
+  auto output = [&] {
+    if (algo == "vector") {
+      nb = (long)vec.size();
+      for (value_type x : vec)
+        sum += x;
+    } else {
+      nb = (long)deq.size();
+      sum = sum_of(deq);
+    }
+    std::cout << "nb_items " << nb << std::endl;
+    std::cout << "sum " << sum << std::endl;
+  };
+  auto destroy = [&] {
+    ;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
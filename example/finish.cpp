@@ -0,0 +1,85 @@
+/*!
+ * \file finish.cpp
+ * \brief Microbenchmark for join points with a high fan-in.
+ * \example finish.cpp
+ * \date 2015
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-fanin <int>` (default=10000)
+ *       number of async threads that join into each finish block
+ *   - `-rounds <int>` (default=100)
+ *       number of finish blocks, executed one after the other
+ *   - `-work <int>` (default=0)
+ *       number of loop iterations performed by each async thread
+ *
+ * The async threads are spawned by a binary tree of asyncs, so that
+ * all workers take part in both spawning and completing them.
+ *
+ * Output: the average latency of one finish block in microseconds
+ * and the throughput in joined threads per second. Compare the
+ * instrategies with `-finish_instrategy distributed|fetch_add|snzi`,
+ * as `-proc` and `-fanin` grow.
+ *
+ */
+
+#include "benchmark.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+
+long work = 0;
+
+/*---------------------------------------------------------------------*/
+
+static void do_work() {
+  volatile long acc = 0;
+  for (long k = 0; k < work; k++)
+    acc = acc + k;
+}
+
+static void spawn(long lo, long hi, par::multishot* join) {
+  while (hi - lo > 1) {
+    long mid = (lo + hi) / 2;
+    par::async([=] { spawn(mid, hi, join); }, join);
+    hi = mid;
+  }
+  do_work();
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  long fanin = 0;
+  long rounds = 0;
+  double elapsed = 0.;
+
+  auto init = [&] {
+    fanin = (long)pasl::util::cmdline::parse_or_default_int("fanin", 10000);
+    rounds = (long)pasl::util::cmdline::parse_or_default_int("rounds", 100);
+    work = (long)pasl::util::cmdline::parse_or_default_int("work", 0);
+  };
+  auto run = [&] (bool sequential) {
+    pasl::util::microtime::microtime_t start = pasl::util::microtime::now();
+    for (long r = 0; r < rounds; r++)
+      par::finish([&] (par::multishot* join) {
+        spawn(0, fanin, join);
+      });
+    elapsed = pasl::util::microtime::seconds_since(start);
+  };
+  auto output = [&] {
+    printf("join_latency_us\t%.3lf\n", 1000000. * elapsed / rounds);
+    printf("join_throughput\t%.0lf\n", (double)(fanin * rounds) / elapsed);
+  };
+  auto destroy = [&] {
+    ;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
@@ -0,0 +1,136 @@
+/*!
+ * \file futures.cpp
+ * \brief Microbenchmark for futures: parallel traversal of a tree.
+ * \example futures.cpp
+ * \date 2015
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-n <int>` (default=1000000)
+ *       number of nodes of the tree
+ *   - `-cutoff <int>` (default=1000)
+ *       subtrees with fewer nodes are traversed sequentially
+ *   - `-work <int>` (default=0)
+ *       number of loop iterations performed at each node
+ *   - `-algo <string>` (default=future)
+ *       - `future`: the left subtree is traversed by a future
+ *       - `fork2`: the two subtrees are traversed by `fork2`
+ *
+ * The tree is a random binary search tree, so that its shape is
+ * irregular. Each node stores the size of its subtree, which serves
+ * for the cutoff. The traversal computes the sum of the keys.
+ *
+ */
+
+#include "benchmark.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+
+typedef struct node_struct {
+  long key;
+  long size;
+  struct node_struct* left;
+  struct node_struct* right;
+} node_type;
+
+long cutoff = 0;
+long work = 0;
+
+/*---------------------------------------------------------------------*/
+
+static long size_of(node_type* t) {
+  return (t == NULL) ? 0 : t->size;
+}
+
+// builds a random binary search tree with keys in [lo, hi)
+static node_type* build(long lo, long hi, unsigned int& seed) {
+  if (lo >= hi)
+    return NULL;
+  node_type* t = new node_type;
+  t->key = lo + (long)(rand_r(&seed) % (hi - lo));
+  t->left = build(lo, t->key, seed);
+  t->right = build(t->key + 1, hi, seed);
+  t->size = size_of(t->left) + size_of(t->right) + 1;
+  return t;
+}
+
+static void destroy_tree(node_type* t) {
+  if (t == NULL)
+    return;
+  destroy_tree(t->left);
+  destroy_tree(t->right);
+  delete t;
+}
+
+static long visit(node_type* t) {
+  volatile long acc = t->key;
+  for (long k = 0; k < work; k++)
+    acc = acc + k;
+  return t->key + (acc - acc);
+}
+
+static long seq_sum(node_type* t) {
+  if (t == NULL)
+    return 0;
+  return seq_sum(t->left) + seq_sum(t->right) + visit(t);
+}
+
+static long future_sum(node_type* t) {
+  if (size_of(t) <= cutoff)
+    return seq_sum(t);
+  par::future<long> left = par::spawn_future([t] { return future_sum(t->left); });
+  long right = future_sum(t->right);
+  return left.force() + right + visit(t);
+}
+
+static long fork2_sum(node_type* t) {
+  if (size_of(t) <= cutoff)
+    return seq_sum(t);
+  long left, right;
+  par::fork2([t, &left] { left = fork2_sum(t->left); },
+             [t, &right] { right = fork2_sum(t->right); });
+  return left + right + visit(t);
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  long result = 0;
+  long n = 0;
+  std::string algo;
+  node_type* root = NULL;
+
+  auto init = [&] {
+    n = (long)pasl::util::cmdline::parse_or_default_int("n", 1000000);
+    cutoff = (long)pasl::util::cmdline::parse_or_default_int("cutoff", 1000);
+    work = (long)pasl::util::cmdline::parse_or_default_int("work", 0);
+    algo = pasl::util::cmdline::parse_or_default_string("algo", "future");
+    unsigned int seed = 1;
+    root = build(0, n, seed);
+  };
+  auto run = [&] (bool sequential) {
+    if (sequential)
+      result = seq_sum(root);
+    else if (algo == "future")
+      result = future_sum(root);
+    else if (algo == "fork2")
+      result = fork2_sum(root);
+    else
+      pasl::util::atomic::die("bogus algo %s\n", algo.c_str());
+  };
+  auto output = [&] {
+    std::cout << "result " << result << std::endl;
+  };
+  auto destroy = [&] {
+    destroy_tree(root);
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
@@ -0,0 +1,176 @@
+/*!
+ * \file heartbeat.cpp
+ * \brief Benchmark for heartbeat mode against hand-tuned cutoffs.
+ * \example heartbeat.cpp
+ * \date 2015
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-bench <string>` (default=fib)
+ *       - `fib`: computes fib(n) with `fork2`
+ *       - `mergesort`: sorts `n` random numbers with `fork2`
+ *       - `bfs`: breadth-first search, with `parallel_for` on each
+ *         frontier, of a random graph with `n` vertices and `degree`
+ *         out-edges per vertex
+ *   - `-n <int>` (default=30 for fib, 10000000 otherwise)
+ *   - `-cutoff <int>` (default=1)
+ *       problem size below which fib and mergesort run sequentially
+ *   - `-degree <int>` (default=8)
+ *
+ * To compare heartbeat mode against the cutoffs, run for example
+ *
+ *   ./heartbeat.opt -bench fib -n 40 -cutoff 20 -proc 40
+ *   ./heartbeat.opt -bench fib -n 40 -cutoff 1 -heartbeat 100 -proc 40
+ *
+ * and, for bfs, `-loop_cutoff 1024` against `-heartbeat 100`. With
+ * `-stats_light 0`, the counters `thread_create` and
+ * `thread_promote` give the number of threads that were created.
+ *
+ */
+
+#include <algorithm>
+
+#include "benchmark.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+
+long cutoff = 0;
+
+/*---------------------------------------------------------------------*/
+/* Fib */
+
+static long seq_fib(long n) {
+  if (n < 2)
+    return n;
+  return seq_fib(n - 1) + seq_fib(n - 2);
+}
+
+static long par_fib(long n) {
+  if (n <= cutoff || n < 2)
+    return seq_fib(n);
+  long a, b;
+  par::fork2([n, &a] { a = par_fib(n-1); },
+             [n, &b] { b = par_fib(n-2); });
+  return a + b;
+}
+
+/*---------------------------------------------------------------------*/
+/* Mergesort */
+
+// sorts xs[lo, hi) using tmp[lo, hi) as scratch space
+static void mergesort(long* xs, long* tmp, long lo, long hi) {
+  if (hi - lo <= std::max(cutoff, 1l)) {
+    std::sort(xs + lo, xs + hi);
+    return;
+  }
+  long mid = (lo + hi) / 2;
+  par::fork2([&] { mergesort(xs, tmp, lo, mid); },
+             [&] { mergesort(xs, tmp, mid, hi); });
+  std::merge(xs + lo, xs + mid, xs + mid, xs + hi, tmp + lo);
+  std::copy(tmp + lo, tmp + hi, xs + lo);
+}
+
+/*---------------------------------------------------------------------*/
+/* BFS */
+
+typedef struct {
+  long nb_vertices;
+  long degree;
+  long* neighbors; // out-edges of vertex v in [v*degree, (v+1)*degree)
+} graph_type;
+
+// returns the number of vertices that are reachable from vertex 0
+static long bfs(const graph_type& g) {
+  long n = g.nb_vertices;
+  std::atomic<bool>* visited = new std::atomic<bool>[n];
+  long* frontier = new long[n];
+  long* next = new long[n];
+  for (long v = 0; v < n; v++)
+    visited[v].store(false);
+  visited[0].store(true);
+  frontier[0] = 0;
+  long frontier_size = 1;
+  long nb_visited = 1;
+  while (frontier_size > 0) {
+    std::atomic<long> next_size(0);
+    par::parallel_for(0l, frontier_size, [&] (long i) {
+      long* ns = g.neighbors + frontier[i] * g.degree;
+      for (long k = 0; k < g.degree; k++) {
+        long w = ns[k];
+        bool orig = false;
+        if (! visited[w].load() && visited[w].compare_exchange_strong(orig, true))
+          next[next_size++] = w;
+      }
+    });
+    frontier_size = next_size.load();
+    nb_visited += frontier_size;
+    std::swap(frontier, next);
+  }
+  delete [] visited;
+  delete [] frontier;
+  delete [] next;
+  return nb_visited;
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  long result = 0;
+  long n = 0;
+  std::string bench;
+  long* xs = NULL;
+  long* tmp = NULL;
+  graph_type g;
+  g.neighbors = NULL;
+
+  auto init = [&] {
+    bench = pasl::util::cmdline::parse_or_default_string("bench", "fib");
+    n = (long)pasl::util::cmdline::parse_or_default_int("n", (bench == "fib") ? 30 : 10000000);
+    cutoff = (long)pasl::util::cmdline::parse_or_default_int("cutoff", 1);
+    unsigned int seed = 1;
+    if (bench == "mergesort") {
+      xs = new long[n];
+      tmp = new long[n];
+      for (long i = 0; i < n; i++)
+        xs[i] = (long)rand_r(&seed);
+    } else if (bench == "bfs") {
+      g.nb_vertices = n;
+      g.degree = (long)pasl::util::cmdline::parse_or_default_int("degree", 8);
+      g.neighbors = new long[n * g.degree];
+      for (long i = 0; i < n * g.degree; i++)
+        g.neighbors[i] = (long)rand_r(&seed) % n;
+    }
+  };
+  auto run = [&] (bool sequential) {
+    if (bench == "fib") {
+      result = par_fib(n);
+    } else if (bench == "mergesort") {
+      mergesort(xs, tmp, 0, n);
+      result = std::is_sorted(xs, xs + n);
+    } else if (bench == "bfs") {
+      result = bfs(g);
+    } else {
+      pasl::util::atomic::die("bogus bench %s\n", bench.c_str());
+    }
+  };
+  auto output = [&] {
+    std::cout << "result " << result << std::endl;
+  };
+  auto destroy = [&] {
+    if (xs != NULL) {
+      delete [] xs;
+      delete [] tmp;
+    }
+    if (g.neighbors != NULL)
+      delete [] g.neighbors;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
@@ -0,0 +1,226 @@
+/*!
+ * \file messages.cpp
+ * \brief Microbenchmark for the channels of the message strategies.
+ * \example messages.cpp
+ * \date 2015
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-bench <string>` (default=channel)
+ *       - `channel`: two OS threads exchange messages through one
+ *         producer-consumer buffer, selected by `-channel`
+ *       - `fib`: computes fib(n) in parallel, with cutoff `cutoff`;
+ *         to be run with `-forkjoin_instrategy message`, so that
+ *         every join goes through the message strategy that is
+ *         selected by `-messagestrategy linked|batched`
+ *   - `-channel <string>` (default=ring)
+ *       `linked` (`data::pcb::linked`) or `ring` (`data::pcb::ring`)
+ *   - `-batch <int>` (default=8)
+ *       messages per push and per pop on a ring
+ *   - `-capacity <int>` (default=256)
+ *       capacity of the ring
+ *   - `-messages <int>` (default=10000000)
+ *       messages sent by the producer in the throughput test
+ *   - `-pingpongs <int>` (default=100000)
+ *       round trips in the latency test
+ *   - `-n <int>` (default=30) and `-cutoff <int>` (default=10)
+ *
+ * Output of `channel`: the throughput in millions of messages per
+ * second, and the one-way latency in nanoseconds, measured as half a
+ * round trip between two channels of the same kind. Both threads yield
+ * the processor when they find a channel empty (or full), so that the
+ * test also makes progress when they share a core.
+ *
+ */
+
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "messagestrategy.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+namespace pcb = pasl::data::pcb;
+typedef pasl::sched::message_t message_t;
+
+long cutoff = 0;
+
+/*---------------------------------------------------------------------*/
+
+static long seq_fib(long n) {
+  if (n < 2)
+    return n;
+  return seq_fib(n - 1) + seq_fib(n - 2);
+}
+
+static long par_fib(long n) {
+  if (n <= cutoff || n < 2)
+    return seq_fib(n);
+  long a, b;
+  par::fork2([n, &a] { a = par_fib(n-1); },
+             [n, &b] { b = par_fib(n-2); });
+  return a + b;
+}
+
+/*---------------------------------------------------------------------*/
+/* Uniform interface to both kinds of channels */
+
+static size_t push_batch(pcb::linked<message_t>& c, const message_t* src, size_t nb) {
+  for (size_t i = 0; i < nb; i++)
+    c.push(src[i]);
+  return nb;
+}
+
+static size_t pop_batch(pcb::linked<message_t>& c, message_t* dst, size_t nb) {
+  size_t k = 0;
+  while (k < nb && c.try_pop(dst[k]))
+    k++;
+  return k;
+}
+
+static size_t push_batch(pcb::ring<message_t>& c, const message_t* src, size_t nb) {
+  return c.try_push_batch(src, nb);
+}
+
+static size_t pop_batch(pcb::ring<message_t>& c, message_t* dst, size_t nb) {
+  return c.try_pop_batch(dst, nb);
+}
+
+static void init_channel(pcb::linked<message_t>& c, size_t capacity) {
+  c.init();
+}
+
+static void init_channel(pcb::ring<message_t>& c, size_t capacity) {
+  c.init(capacity);
+}
+
+/*---------------------------------------------------------------------*/
+
+// Returns the number of seconds taken to transfer `nb_messages`
+template <class Channel>
+double measure_throughput(long nb_messages, size_t batch, size_t capacity) {
+  Channel c;
+  init_channel(c, capacity);
+  pasl::util::microtime::microtime_t start = pasl::util::microtime::now();
+  std::thread consumer([&] {
+    std::vector<message_t> dst(batch);
+    long nb_received = 0;
+    int64_t sum = 0;
+    while (nb_received < nb_messages) {
+      size_t nb = pop_batch(c, dst.data(), batch);
+      if (nb == 0)
+        std::this_thread::yield();
+      for (size_t i = 0; i < nb; i++)
+        sum += dst[i].data.in_delta.d;
+      nb_received += nb;
+    }
+    if (sum != nb_messages)
+      pasl::util::atomic::die("messages lost\n");
+  });
+  std::vector<message_t> src(batch, pasl::sched::messagestrategy::in_delta(NULL, NULL, 1));
+  for (long nb_sent = 0; nb_sent < nb_messages; ) {
+    size_t nb = std::min((long)batch, nb_messages - nb_sent);
+    size_t nb_pushed = push_batch(c, src.data(), nb);
+    if (nb_pushed == 0)
+      std::this_thread::yield();
+    nb_sent += nb_pushed;
+  }
+  consumer.join();
+  double elapsed = pasl::util::microtime::seconds_since(start);
+  c.destroy();
+  return elapsed;
+}
+
+// Returns the number of seconds taken by `nb_pingpongs` round trips
+template <class Channel>
+double measure_round_trips(long nb_pingpongs, size_t capacity) {
+  Channel ping, pong;
+  init_channel(ping, capacity);
+  init_channel(pong, capacity);
+  message_t msg = pasl::sched::messagestrategy::in_delta(NULL, NULL, 1);
+  pasl::util::microtime::microtime_t start = pasl::util::microtime::now();
+  std::thread echo([&] {
+    message_t m;
+    for (long k = 0; k < nb_pingpongs; k++) {
+      while (pop_batch(ping, &m, 1) == 0)
+        std::this_thread::yield();
+      while (push_batch(pong, &m, 1) == 0)
+        std::this_thread::yield();
+    }
+  });
+  message_t m;
+  for (long k = 0; k < nb_pingpongs; k++) {
+    while (push_batch(ping, &msg, 1) == 0)
+      std::this_thread::yield();
+    while (pop_batch(pong, &m, 1) == 0)
+      std::this_thread::yield();
+  }
+  echo.join();
+  double elapsed = pasl::util::microtime::seconds_since(start);
+  ping.destroy();
+  pong.destroy();
+  return elapsed;
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  std::string bench;
+  std::string channel;
+  long nb_messages = 0;
+  long nb_pingpongs = 0;
+  size_t batch = 0;
+  size_t capacity = 0;
+  long n = 0;
+  long result = 0;
+  double throughput_time = 0.;
+  double latency_time = 0.;
+
+  auto init = [&] {
+    bench = pasl::util::cmdline::parse_or_default_string("bench", "channel");
+    channel = pasl::util::cmdline::parse_or_default_string("channel", "ring");
+    batch = (size_t)std::max(1, pasl::util::cmdline::parse_or_default_int("batch", 8));
+    capacity = (size_t)pasl::util::cmdline::parse_or_default_int("capacity", 256);
+    nb_messages = (long)pasl::util::cmdline::parse_or_default_int("messages", 10000000);
+    nb_pingpongs = (long)pasl::util::cmdline::parse_or_default_int("pingpongs", 100000);
+    n = (long)pasl::util::cmdline::parse_or_default_int("n", 30);
+    cutoff = (long)pasl::util::cmdline::parse_or_default_int("cutoff", 10);
+  };
+  auto run = [&] (bool sequential) {
+    if (bench == "fib") {
+      result = par_fib(n);
+    } else if (bench == "channel") {
+      if (channel == "linked") {
+        throughput_time = measure_throughput<pcb::linked<message_t>>(nb_messages, batch, capacity);
+        latency_time = measure_round_trips<pcb::linked<message_t>>(nb_pingpongs, capacity);
+      } else if (channel == "ring") {
+        throughput_time = measure_throughput<pcb::ring<message_t>>(nb_messages, batch, capacity);
+        latency_time = measure_round_trips<pcb::ring<message_t>>(nb_pingpongs, capacity);
+      } else {
+        pasl::util::atomic::die("bogus channel %s\n", channel.c_str());
+      }
+    } else {
+      pasl::util::atomic::die("bogus bench %s\n", bench.c_str());
+    }
+  };
+  auto output = [&] {
+    if (bench == "fib") {
+      std::cout << "result " << result << std::endl;
+    } else {
+      printf("throughput_mmsg_per_s\t%.3lf\n", nb_messages / throughput_time / 1000000.);
+      printf("latency_ns\t%.1lf\n", 1000000000. * latency_time / nb_pingpongs / 2.);
+    }
+  };
+  auto destroy = [&] {
+    ;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
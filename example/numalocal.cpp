@@ -0,0 +1,159 @@
+/*!
+ * \file numalocal.cpp
+ * \brief Microbenchmark for the placement of per-worker storage on
+ * NUMA nodes.
+ * \example numalocal.cpp
+ * \date 2015
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-bench <string>` (default=probe)
+ *       - `probe`: runs a `parallel_for` loop over `n` items, each of
+ *         which increments the cell of the calling worker in a
+ *         per-worker array and reads the cell of a random worker, as
+ *         a thief does when it probes for work
+ *       - `fib`: computes fib(n) in parallel, with cutoff `cutoff`,
+ *         so as to measure the steal throughput of the scheduler
+ *   - `-n <int>` (default=10000000)
+ *   - `-cutoff <int>` (default=20)
+ *
+ * The placement of the cells of per-worker arrays is selected by
+ * `-perworker_numa_local 1` (cells on the node of their worker, the
+ * default) or `-perworker_numa_local 0` (all the cells on the node of
+ * the worker that first touches the array, here worker 0).
+ *
+ * Output of `probe`: the number of accesses to cells that live on the
+ * node of the accessing worker and on another node. On a machine with
+ * a single node, a topology can be simulated with
+ * `-sim_workers_per_node`. With hwloc, `misplaced_cells` counts the
+ * cells whose pages are not on the node of their worker.
+ *
+ */
+
+#include "benchmark.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+namespace perworker = pasl::data::perworker;
+namespace machine = pasl::util::machine;
+
+long cutoff = 0;
+
+/*---------------------------------------------------------------------*/
+
+static long seq_fib (long n){
+  if (n < 2)
+    return n;
+  else
+    return seq_fib (n - 1) + seq_fib (n - 2);
+}
+
+static long par_fib(long n) {
+  if (n <= cutoff || n < 2)
+    return seq_fib(n);
+  long a, b;
+  par::fork2([n, &a] { a = par_fib(n-1); },
+             [n, &b] { b = par_fib(n-2); });
+  return a + b;
+}
+
+/*---------------------------------------------------------------------*/
+
+perworker::array<long> cells;
+perworker::counter::carray<long> nb_local;
+perworker::counter::carray<long> nb_remote;
+
+// Node on which the cell of worker `id` lives
+static machine::node_id_t home_of(pasl::worker_id_t id) {
+  machine::node_id_t node = machine::home_node_of_worker(id);
+  return (node == machine::node_undef) ? machine::the_proximity.node_of(0) : node;
+}
+
+static void count_access(pasl::worker_id_t my_id, pasl::worker_id_t id) {
+  if (home_of(id) == machine::the_proximity.node_of(my_id))
+    nb_local.incr(my_id, 1);
+  else
+    nb_remote.incr(my_id, 1);
+}
+
+static uint64_t hash(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  return x;
+}
+
+static long probe(long n) {
+  int nb_workers = pasl::util::worker::get_nb();
+  par::parallel_for(0l, n, [&] (long i) {
+    pasl::worker_id_t my_id = pasl::util::worker::get_my_id();
+    pasl::worker_id_t victim = (pasl::worker_id_t)(hash(i) % nb_workers);
+    cells.mine(my_id)++;
+    count_access(my_id, my_id);
+    volatile long v = cells[victim];
+    (void)v;
+    count_access(my_id, victim);
+  });
+  return cells.combine(0l, [] (long x, long y) { return x + y; });
+}
+
+static long nb_misplaced_cells() {
+  long nb = 0;
+#if defined(HAVE_HWLOC) && HWLOC_API_VERSION >= 0x00020000
+  if (machine::the_proximity.has_simulated_nodes())
+    return 0;
+  hwloc_nodeset_t nodeset = hwloc_bitmap_alloc();
+  cells.for_each([&] (pasl::worker_id_t id, long& c) {
+    if (hwloc_get_area_memlocation(machine::topology, &c, sizeof(long), nodeset,
+                                   HWLOC_MEMBIND_BYNODESET) == 0
+        && ! hwloc_bitmap_isset(nodeset, home_of(id)))
+      nb++;
+  });
+  hwloc_bitmap_free(nodeset);
+#endif
+  return nb;
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  long result = 0;
+  long n = 0;
+  std::string bench;
+
+  auto init = [&] {
+    bench = pasl::util::cmdline::parse_or_default_string("bench", "probe");
+    n = (long)pasl::util::cmdline::parse_or_default_int("n", 10000000);
+    cutoff = (long)pasl::util::cmdline::parse_or_default_int("cutoff", 20);
+    cells.init(0l);
+    nb_local.init(0l);
+    nb_remote.init(0l);
+  };
+  auto run = [&] (bool sequential) {
+    if (bench == "probe")
+      result = probe(n);
+    else if (bench == "fib")
+      result = par_fib(n);
+    else
+      pasl::util::atomic::die("bogus bench %s\n", bench.c_str());
+  };
+  auto output = [&] {
+    std::cout << "result " << result << std::endl;
+    if (bench == "probe") {
+      std::cout << "local_accesses " << nb_local.sum() << std::endl;
+      std::cout << "remote_accesses " << nb_remote.sum() << std::endl;
+      std::cout << "misplaced_cells " << nb_misplaced_cells() << std::endl;
+    }
+  };
+  auto destroy = [&] {
+    ;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
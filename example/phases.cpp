@@ -0,0 +1,80 @@
+/*!
+ * \file phases.cpp
+ * \brief Microbenchmark for the latency of barriers.
+ * \example phases.cpp
+ * \date 2015
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-max_threads <int>` (default=8)
+ *       the benchmark runs with 1, 2, 4, ... threads, up to this number
+ *   - `-phases <int>` (default=10000)
+ *       number of barrier phases that each thread goes through
+ *   - `-barrier <string>` and `-barrier_futex <bool>`
+ *       the barrier to measure (see `util::barrier::barrier_t`)
+ *
+ * The threads are plain OS threads, and not PASL workers, so that all
+ * of them can block in the barrier at the same time.
+ *
+ * Output: for each number of threads, the average latency of one
+ * phase in microseconds.
+ *
+ */
+
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+
+/***********************************************************************/
+
+namespace barrier = pasl::util::barrier;
+
+/*---------------------------------------------------------------------*/
+
+static double measure(int nb_threads, long nb_phases) {
+  barrier::barrier_t b;
+  b.init(nb_threads);
+  std::vector<std::thread> threads;
+  pasl::util::microtime::microtime_t start = pasl::util::microtime::now();
+  for (int id = 0; id < nb_threads; id++)
+    threads.push_back(std::thread([&b, id, nb_phases] {
+      for (long k = 0; k < nb_phases; k++)
+        b.wait(id);
+    }));
+  for (auto& t : threads)
+    t.join();
+  return pasl::util::microtime::seconds_since(start);
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  int max_threads = 0;
+  long nb_phases = 0;
+  std::vector<std::pair<int, double>> results;
+
+  auto init = [&] {
+    max_threads = pasl::util::cmdline::parse_or_default_int("max_threads", 8);
+    nb_phases = (long)pasl::util::cmdline::parse_or_default_int("phases", 10000);
+  };
+  auto run = [&] (bool sequential) {
+    for (int nb = 1; nb <= max_threads; nb *= 2)
+      results.push_back(std::make_pair(nb, measure(nb, nb_phases)));
+  };
+  auto output = [&] {
+    for (auto& r : results)
+      printf("threads %d\tphase_latency_us\t%.3lf\n",
+             r.first, 1000000. * r.second / nb_phases);
+  };
+  auto destroy = [&] {
+    ;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
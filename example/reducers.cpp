@@ -0,0 +1,186 @@
+/*!
+ * \file reducers.cpp
+ * \brief Compares reducers with `combine` on two accumulation
+ * workloads.
+ * \example reducers.cpp
+ * \date 2015
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-bench <string>` (default=histogram)
+ *       - `histogram`: counts the hashes of the integers in [0, n) by
+ *         bucket, in `buckets` buckets
+ *       - `frontier`: builds a bag of the integers in [0, n) whose hash
+ *         is a multiple of 4, as the edge map of a BFS builds its next
+ *         frontier
+ *   - `-algo <string>` (default=reducer)
+ *       - `reducer`: blocks of 1024 iterations, run by a
+ *         `parallel_for`, update a reducer; views are created only by
+ *         the blocks that run on a stolen branch
+ *       - `combine`: `native::combine` (`pcontainer::combine` for the
+ *         frontier), which creates a fresh output at every split and
+ *         joins the outputs pairwise
+ *   - `-n <int>` (default=100000000)
+ *   - `-buckets <int>` (default=1024)
+ *
+ * Output: the total count of the histogram, or the size of the
+ * frontier, which do not depend on `algo`.
+ *
+ */
+
+#include <vector>
+
+#include "benchmark.hpp"
+#include "pcontainer.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+namespace reducer = pasl::sched::reducer;
+namespace pcontainer = pasl::data::pcontainer;
+
+/*---------------------------------------------------------------------*/
+
+static inline uint64_t hash_of(uint64_t x) {
+  x *= 0x9e3779b97f4a7c15ull;
+  return x ^ (x >> 29);
+}
+
+/* Calls `body(lo, hi)` in parallel on blocks of iterations that cover
+ * [0, n), so that the view of a reducer is looked up once per block;
+ * a view stays valid until the next fork point of the calling strand */
+template <class Body>
+void for_each_block(long n, const Body& body) {
+  const long block = 1024;
+  par::parallel_for(0l, (n + block - 1) / block, [&] (long b) {
+    body(b * block, std::min(n, (b + 1) * block));
+  });
+}
+
+/*---------------------------------------------------------------------*/
+/* Histogram */
+
+using histogram_type = std::vector<long>;
+
+class histogram_monoid {
+public:
+  using value_type = histogram_type;
+  long nb_buckets;
+  histogram_monoid(long nb_buckets = 0) : nb_buckets(nb_buckets) { }
+  void identity(histogram_type& h) const {
+    h.assign(nb_buckets, 0);
+  }
+  void reduce(histogram_type& h1, histogram_type& h2) const {
+    for (long b = 0; b < nb_buckets; b++)
+      h1[b] += h2[b];
+  }
+};
+
+static histogram_type histogram_reducer(long n, long nb_buckets) {
+  histogram_monoid monoid(nb_buckets);
+  reducer::reducer<histogram_monoid> h(monoid);
+  for_each_block(n, [&] (long lo, long hi) {
+    histogram_type& v = h.view();
+    for (long i = lo; i < hi; i++)
+      v[hash_of(i) % nb_buckets]++;
+  });
+  return h.get();
+}
+
+static histogram_type histogram_combine(long n, long nb_buckets) {
+  histogram_type h;
+  auto join = [nb_buckets] (histogram_type& h1, histogram_type& h2) {
+    if (h1.empty())
+      h1.swap(h2);
+    else if (! h2.empty())
+      for (long b = 0; b < nb_buckets; b++)
+        h1[b] += h2[b];
+  };
+  par::combine(0l, n, h, join, [nb_buckets] (long i, histogram_type& h) {
+    if (h.empty())
+      h.assign(nb_buckets, 0);
+    h[hash_of(i) % nb_buckets]++;
+  });
+  return h;
+}
+
+/*---------------------------------------------------------------------*/
+/* Frontier */
+
+using frontier_type = pcontainer::bag<long>;
+
+static inline bool in_frontier(long i) {
+  return hash_of(i) % 4 == 0;
+}
+
+static long frontier_reducer(long n) {
+  pcontainer::bag_reducer<long> f;
+  for_each_block(n, [&] (long lo, long hi) {
+    frontier_type& v = f.view();
+    for (long i = lo; i < hi; i++)
+      if (in_frontier(i))
+        v.push_back(i);
+  });
+  return (long)f.get().size();
+}
+
+static long frontier_combine(long n) {
+  frontier_type f;
+  pcontainer::combine(0l, n, f, [] (long i, frontier_type& f) {
+    if (in_frontier(i))
+      f.push_back(i);
+  });
+  return (long)f.size();
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  std::string bench;
+  std::string algo;
+  long n = 0;
+  long nb_buckets = 0;
+  long result = 0;
+
+  auto init = [&] {
+    bench = pasl::util::cmdline::parse_or_default_string("bench", "histogram");
+    algo = pasl::util::cmdline::parse_or_default_string("algo", "reducer");
+    n = (long)pasl::util::cmdline::parse_or_default_long("n", 100000000);
+    nb_buckets = std::max(1l, (long)pasl::util::cmdline::parse_or_default_long("buckets", 1024));
+  };
+  auto run = [&] (bool sequential) {
+    if (bench == "histogram") {
+      histogram_type h;
+      if (algo == "reducer")
+        h = histogram_reducer(n, nb_buckets);
+      else if (algo == "combine")
+        h = histogram_combine(n, nb_buckets);
+      else
+        pasl::util::atomic::die("bogus algo %s\n", algo.c_str());
+      for (long c : h)
+        result += c;
+    } else if (bench == "frontier") {
+      if (algo == "reducer")
+        result = frontier_reducer(n);
+      else if (algo == "combine")
+        result = frontier_combine(n);
+      else
+        pasl::util::atomic::die("bogus algo %s\n", algo.c_str());
+    } else {
+      pasl::util::atomic::die("bogus bench %s\n", bench.c_str());
+    }
+  };
+  auto output = [&] {
+    std::cout << "result " << result << std::endl;
+  };
+  auto destroy = [&] {
+    ;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
@@ -0,0 +1,128 @@
+/*!
+ * \file resize.cpp
+ * \brief Microbenchmark for the latency of changes to the number of
+ * active workers.
+ * \example resize.cpp
+ * \date 2015
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-resizes <int>` (default=100)
+ *       number of times that the workers are shrunk, then grown back
+ *   - `-low <int>` (default=1)
+ *       number of active workers after a shrink
+ *   - `-load <bool>` (default=true)
+ *       if true, the workers compute fib(n) in parallel, with cutoff
+ *       `cutoff`, in a loop during the resizes; otherwise they are idle
+ *   - `-n <int>` (default=30)
+ *   - `-cutoff <int>` (default=15)
+ *
+ * The resizes are issued by an OS thread that is not a worker, as a
+ * co-located job would. Shrink latency is measured from the call to
+ * `threaddag::set_nb_active_workers()` until all the deactivated
+ * workers are parked, which includes the time that they take to run
+ * or give away the threads that they hold. Grow latency is measured
+ * until no worker is parked.
+ *
+ * Output: average shrink and grow latencies in microseconds.
+ *
+ */
+
+#include <thread>
+
+#include "benchmark.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+namespace threaddag = pasl::sched::threaddag;
+
+long cutoff = 0;
+long n = 0;
+
+/*---------------------------------------------------------------------*/
+
+static long seq_fib(long n) {
+  if (n < 2)
+    return n;
+  return seq_fib(n - 1) + seq_fib(n - 2);
+}
+
+static long par_fib(long n) {
+  if (n <= cutoff || n < 2)
+    return seq_fib(n);
+  long a, b;
+  par::fork2([n, &a] { a = par_fib(n-1); },
+             [n, &b] { b = par_fib(n-2); });
+  return a + b;
+}
+
+/*---------------------------------------------------------------------*/
+
+// Returns the time, in seconds, until `nb` workers are parked
+static double time_to_nb_parked(int nb, pasl::util::microtime::microtime_t start) {
+  while (pasl::util::worker::the_group.get_nb_parked() != nb)
+    pasl::util::ticks::microseconds_sleep(1.);
+  return pasl::util::microtime::seconds_since(start);
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  long nb_resizes = 0;
+  int low = 0;
+  bool load = true;
+  double shrink_time = 0.;
+  double grow_time = 0.;
+  long nb_loads = 0;
+
+  auto init = [&] {
+    nb_resizes = (long)pasl::util::cmdline::parse_or_default_int("resizes", 100);
+    low = pasl::util::cmdline::parse_or_default_int("low", 1);
+    load = pasl::util::cmdline::parse_or_default_bool("load", true);
+    n = (long)pasl::util::cmdline::parse_or_default_int("n", 30);
+    cutoff = (long)pasl::util::cmdline::parse_or_default_int("cutoff", 15);
+  };
+  auto run = [&] (bool sequential) {
+    int nb_workers = threaddag::get_nb_workers();
+    low = std::max(1, std::min(low, nb_workers));
+    std::atomic<bool> done(false);
+    std::thread resizer([&] {
+      for (long r = 0; r < nb_resizes; r++) {
+        pasl::util::microtime::microtime_t start = pasl::util::microtime::now();
+        threaddag::set_nb_active_workers(low);
+        shrink_time += time_to_nb_parked(nb_workers - low, start);
+        start = pasl::util::microtime::now();
+        threaddag::set_nb_active_workers(nb_workers);
+        grow_time += time_to_nb_parked(0, start);
+      }
+      done.store(true);
+    });
+    while (! done.load()) {
+      if (load) {
+        par_fib(n);
+        nb_loads++;
+      } else {
+        // lets the scheduler answer the steal requests of thieves
+        par::yield();
+        pasl::util::ticks::microseconds_sleep(100.);
+      }
+    }
+    resizer.join();
+  };
+  auto output = [&] {
+    printf("nb_loads\t%ld\n", nb_loads);
+    printf("shrink_latency_us\t%.3lf\n", 1000000. * shrink_time / nb_resizes);
+    printf("grow_latency_us\t%.3lf\n", 1000000. * grow_time / nb_resizes);
+  };
+  auto destroy = [&] {
+    ;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
@@ -0,0 +1,110 @@
+/*!
+ * \file steal.cpp
+ * \brief Microbenchmark for the migration of threads between workers.
+ * \example steal.cpp
+ * \date 2015
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-bench <string>` (default=flat)
+ *       - `flat`: one worker spawns `n` threads in a row, which the
+ *         other workers then have to steal
+ *       - `parallel_for`: runs a `parallel_for` loop over `n` items
+ *       - `fib`: computes fib(n) in parallel, with cutoff `cutoff`
+ *   - `-n <int>` (default=1000000)
+ *   - `-work <int>` (default=100)
+ *       number of loop iterations performed by each spawned thread
+ *       (flat) or by each iteration (parallel_for)
+ *   - `-cutoff <int>` (default=20)
+ *
+ * Meant to be run with `-threadset shared_deques`, so as to compare
+ * single-item steals (`-steal_half 0`) against batched steals
+ * (`-steal_half 1`). The execution time gives the steal throughput
+ * and, compared to `-proc 1`, the speedup; with `-stats_light 0`, the
+ * counters `thread_send` and `thread_steal_batch` give the number of
+ * steals and the number of threads that migrated in batches.
+ *
+ */
+
+#include "benchmark.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+
+long cutoff = 0;
+long work = 0;
+
+/*---------------------------------------------------------------------*/
+
+static long do_work(long i) {
+  volatile long acc = i;
+  for (long k = 0; k < work; k++)
+    acc = acc + k;
+  return acc;
+}
+
+static long seq_fib (long n){
+  if (n < 2)
+    return n;
+  else
+    return seq_fib (n - 1) + seq_fib (n - 2);
+}
+
+static long par_fib(long n) {
+  if (n <= cutoff || n < 2)
+    return seq_fib(n);
+  long a, b;
+  par::fork2([n, &a] { a = par_fib(n-1); },
+             [n, &b] { b = par_fib(n-2); });
+  return a + b;
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  long result = 0;
+  long n = 0;
+  std::string bench;
+  std::atomic<long> counter;
+
+  auto init = [&] {
+    bench = pasl::util::cmdline::parse_or_default_string("bench", "flat");
+    n = (long)pasl::util::cmdline::parse_or_default_int("n", 1000000);
+    work = (long)pasl::util::cmdline::parse_or_default_int("work", 100);
+    cutoff = (long)pasl::util::cmdline::parse_or_default_int("cutoff", 20);
+    counter.store(0);
+  };
+  auto run = [&] (bool sequential) {
+    if (bench == "flat") {
+      par::finish([&] (par::multishot* join) {
+        for (long i = 0; i < n; i++)
+          par::async([&, i] { do_work(i); counter++; }, join);
+      });
+      result = counter.load();
+    } else if (bench == "parallel_for") {
+      par::parallel_for(0l, n, [&] (long i) {
+        do_work(i);
+        counter++;
+      });
+      result = counter.load();
+    } else if (bench == "fib") {
+      result = par_fib(n);
+    } else {
+      pasl::util::atomic::die("bogus bench %s\n", bench.c_str());
+    }
+  };
+  auto output = [&] {
+    std::cout << "result " << result << std::endl;
+  };
+  auto destroy = [&] {
+    ;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return 0;
+}
+
+/***********************************************************************/
@@ -0,0 +1,99 @@
+/*!
+ * \file submit.cpp
+ * \brief Root tasks submitted to a persistent scheduler by external
+ * OS threads.
+ * \example submit.cpp
+ * \date 2015
+ * \copyright COPYRIGHT (c) 2012 Umut Acar, Arthur Chargueraud, and
+ * Michael Rainey. All rights reserved.
+ * \license This project is released under the GNU Public License.
+ *
+ * Arguments:
+ * ==================================================================
+ *   - `-clients <int>` (default=4)
+ *       number of OS threads that submit root tasks
+ *   - `-requests <int>` (default=100)
+ *       number of root tasks submitted by each client, one at a time
+ *   - `-n <int>` (default=25)
+ *       each root task computes fib(n) in parallel
+ *   - `-cutoff <int>` (default=15)
+ *
+ * Stands for a server that runs one parallel query per request on a
+ * single scheduler instance (see `service.hpp`), instead of one
+ * launch per request. Output: the average latency of one request in
+ * microseconds, and the throughput in requests per second.
+ *
+ */
+
+#include <pthread.h>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "service.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+namespace service = pasl::sched::service;
+
+long cutoff = 0;
+long n = 0;
+long nb_requests = 0;
+std::atomic<long> nb_wrong_results;
+
+/*---------------------------------------------------------------------*/
+
+static long seq_fib(long n) {
+  if (n < 2)
+    return n;
+  return seq_fib(n - 1) + seq_fib(n - 2);
+}
+
+static long par_fib(long n) {
+  if (n <= cutoff || n < 2)
+    return seq_fib(n);
+  long a, b;
+  par::fork2([n, &a] { a = par_fib(n-1); },
+             [n, &b] { b = par_fib(n-2); });
+  return a + b;
+}
+
+static void* client(void*) {
+  long expected = seq_fib(n);
+  for (long i = 0; i < nb_requests; i++) {
+    long result = 0;
+    service::handle_p h = service::submit([&result] { result = par_fib(n); });
+    h->wait();
+    h->release();
+    if (result != expected)
+      nb_wrong_results++;
+  }
+  return NULL;
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  pasl::util::cmdline::set(argc, argv);
+  long nb_clients = (long)pasl::util::cmdline::parse_or_default_int("clients", 4);
+  nb_requests = (long)pasl::util::cmdline::parse_or_default_int("requests", 100);
+  n = (long)pasl::util::cmdline::parse_or_default_int("n", 25);
+  cutoff = (long)pasl::util::cmdline::parse_or_default_int("cutoff", 15);
+  nb_wrong_results.store(0);
+  service::start();
+  pasl::util::microtime::microtime_t start = pasl::util::microtime::now();
+  std::vector<pthread_t> clients(nb_clients);
+  for (long i = 0; i < nb_clients; i++)
+    pthread_create(&clients[i], NULL, client, NULL);
+  for (long i = 0; i < nb_clients; i++)
+    pthread_join(clients[i], NULL);
+  double elapsed = pasl::util::microtime::seconds_since(start);
+  service::stop();
+  long total = nb_clients * nb_requests;
+  printf("wrong_results\t%ld\n", nb_wrong_results.load());
+  printf("request_latency_us\t%.3lf\n", 1000000. * elapsed * nb_clients / total);
+  printf("request_throughput\t%.0lf\n", (double) total / elapsed);
+  return 0;
+}
+
+/***********************************************************************/
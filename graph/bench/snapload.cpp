@@ -0,0 +1,113 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file snapload.cpp
+ * \brief Compares the loaders of snap files
+ *
+ * Arguments:
+ *   - `-infile <string>`: snap file to load
+ *   - `-generate <int>` (default=0): if positive, first writes to
+ *     `infile` a random graph with that many edges (not timed)
+ *   - `-algo <string>` (default=stream)
+ *       - `load`: `read_snap_graph`, which reads the whole file, then
+ *         parses it
+ *       - `stream`: `read_snap_graph_streaming`, which parses chunks of
+ *         the file while it reads the next ones
+ *   - `-chunk_szb <int>` (default=1048576) and `-max_in_flight <int>`
+ *     (default=16): parameters of `stream`
+ *
+ * Output: the numbers of vertices and edges, a checksum of the edges,
+ * which do not depend on `algo`, and the throughput of the loader.
+ */
+
+#include <cstdio>
+
+#include "graphio.hpp"
+#include "benchmark.hpp"
+
+/***********************************************************************/
+
+namespace pasl {
+namespace graph {
+
+/*---------------------------------------------------------------------*/
+
+static void generate_snap_file(std::string fname, long nb_edges) {
+  long nb_vertices = std::max(1l, nb_edges / 8);
+  std::ofstream out(fname);
+  out << "# Directed graph: " << fname << "\n";
+  out << "# Random graph\n";
+  out << "# Nodes: " << nb_vertices << " Edges: " << nb_edges << "\n";
+  out << "# FromNodeId\tToNodeId\n";
+  for (long i = 0; i < nb_edges; i++)
+    out << (rand() % nb_vertices) << "\t" << (rand() % nb_vertices) << "\n";
+  out.close();
+}
+
+template <class Edgelist>
+uint64_t checksum(const Edgelist& edges) {
+  uint64_t h = 0;
+  for (edgeid_type i = 0; i < edges.get_nb_edges(); i++)
+    h = h * 31 + uint64_t(edges.edges[i].src) * 7 + uint64_t(edges.edges[i].dst);
+  return h;
+}
+
+template <class Edgelist>
+void snapload() {
+  std::string infile;
+  std::string algo;
+  long chunk_szb = 0;
+  long max_in_flight = 0;
+  Edgelist edges;
+  double exectime = 0.;
+  auto init = [&] {
+    infile = util::cmdline::parse_or_default_string("infile", "");
+    algo = util::cmdline::parse_or_default_string("algo", "stream");
+    chunk_szb = std::max(1l, util::cmdline::parse_or_default_long("chunk_szb", 1l << 20));
+    max_in_flight = util::cmdline::parse_or_default_long("max_in_flight", 16);
+    long nb_edges = util::cmdline::parse_or_default_long("generate", 0);
+    if (infile == "")
+      util::atomic::die("missing infile");
+    if (nb_edges > 0)
+      generate_snap_file(infile, nb_edges);
+  };
+  auto run = [&] (bool sequential) {
+    util::microtime::microtime_t start = util::microtime::now();
+    if (algo == "load")
+      read_snap_graph(infile, edges);
+    else if (algo == "stream")
+      read_snap_graph_streaming(infile, edges, chunk_szb, max_in_flight);
+    else
+      util::atomic::die("bogus algo %s", algo.c_str());
+    exectime = util::microtime::seconds_since(start);
+  };
+  auto output = [&] {
+    std::ifstream in(infile, std::ifstream::ate | std::ifstream::binary);
+    double nb_mb = double(in.tellg()) / (1024. * 1024.);
+    std::cout << "nb_vertices\t" << edges.nb_vertices << std::endl;
+    std::cout << "nb_edges\t" << edges.get_nb_edges() << std::endl;
+    std::cout << "checksum\t" << checksum(edges) << std::endl;
+    printf("throughput_mb_per_s\t%.1lf\n", nb_mb / exectime);
+  };
+  auto destroy = [&] { };
+  sched::launch(init, run, output, destroy);
+}
+
+} // end namespace
+} // end namespace
+
+/*---------------------------------------------------------------------*/
+
+using namespace pasl;
+
+int main(int argc, char ** argv) {
+  util::cmdline::set(argc, argv);
+  using vtxid_type = long;
+  using edge_type = graph::edge<vtxid_type>;
+  using edgelist_type = graph::edgelist<data::array_seq<edge_type>>;
+  graph::snapload<edgelist_type>();
+  return 0;
+}
+
+/***********************************************************************/
@@ -11,12 +11,15 @@
 #include <istream>
 #include <ostream>
 #include <sstream>
+#include <vector>
+#include <algorithm>
 
 #include "edgelist.hpp"
 #include "adjlist.hpp"
 #include "mmio.hpp"
 #include "sequence.hpp"
 #include "cmdline.hpp"
+#include "pipeline.hpp"
 
 #ifndef _PASL_GRAPH_IO_H_
 #define _PASL_GRAPH_IO_H_
@@ -331,12 +334,11 @@ void compute_nb_vertices(edgelist<Edge_bag>& graph) {
 /* snap graph format
  * http://snap.stanford.edu/data/
  */
-template <class Edge_bag>
-void read_snap_graph(std::string fname, edgelist<Edge_bag>& dst) {
-  using vtxid_type = typename edgelist<Edge_bag>::vtxid_type;
-  using edge_type = typename edgelist<Edge_bag>::edge_type;
-  using size_type = typename data::array_seq<int>::size_type;
-  std::ifstream in(fname);
+  
+/* Reads the four header lines of a snap file, the third of which gives
+ * the numbers of vertices and edges */
+template <class Vertex_id>
+void read_snap_header(std::istream& in, Vertex_id& nb_vertices, edgeid_type& nb_edges) {
   std::string metadata;
   const int nb_header_lines = 4;
   const int metadata_line_id = 2;
@@ -348,8 +350,7 @@ void read_snap_graph(std::string fname, edgelist<Edge_bag>& dst) {
   }
   std::stringstream ss(metadata);
   std::string tmp;
-  vtxid_type nb_vertices;
-  edgeid_type nb_edges = 0;
+  nb_edges = 0;
   int i = 0;
   const int nb_metadata_items = 5;
   const int nb_vertices_idx = 2;
@@ -363,6 +364,17 @@ void read_snap_graph(std::string fname, edgelist<Edge_bag>& dst) {
   }
   if (i != nb_metadata_items)
     util::atomic::die("bogus header");
+}
+
+template <class Edge_bag>
+void read_snap_graph(std::string fname, edgelist<Edge_bag>& dst) {
+  using vtxid_type = typename edgelist<Edge_bag>::vtxid_type;
+  using edge_type = typename edgelist<Edge_bag>::edge_type;
+  using size_type = typename data::array_seq<int>::size_type;
+  std::ifstream in(fname);
+  vtxid_type nb_vertices;
+  edgeid_type nb_edges;
+  read_snap_header(in, nb_vertices, nb_edges);
   long beg = in.tellg();
   in.seekg (0, in.end);
   long n = in.tellg();
@@ -389,6 +401,108 @@ void read_snap_graph(std::string fname, edgelist<Edge_bag>& dst) {
   in.close();
   compute_nb_vertices(dst);
 }
+
+/* Block of complete lines of a snap file, and the edges in it, that
+ * goes through the pipeline of `read_snap_graph_streaming` */
+template <class Edge>
+class snap_chunk {
+public:
+  using vtxid_type = typename Edge::vtxid_type;
+  std::string bytes;
+  std::vector<Edge> edges;
+  vtxid_type max_vtxid;
+  //! position of the first edge of the chunk in the edge list
+  edgeid_type offset;
+};
+
+/* Parses the vertex ids in `bytes`, two per edge, into `edges` */
+template <class Edge>
+void parse_snap_edges(const std::string& bytes, std::vector<Edge>& edges,
+                      typename Edge::vtxid_type& max_vtxid) {
+  using vtxid_type = typename Edge::vtxid_type;
+  edges.clear();
+  max_vtxid = vtxid_type(0);
+  const char* p = bytes.data();
+  const char* end = p + bytes.size();
+  vtxid_type ids[2];
+  int nb_ids = 0;
+  while (true) {
+    while (p < end && is_space(*p))
+      p++;
+    if (p == end)
+      break;
+    long n = 0;
+    for (; p < end && ! is_space(*p); p++)
+      n = n * 10 + (*p - '0');
+    ids[nb_ids++] = vtxid_type(n);
+    max_vtxid = std::max(max_vtxid, vtxid_type(n));
+    if (nb_ids == 2) {
+      edges.push_back(Edge(ids[0], ids[1]));
+      nb_ids = 0;
+    }
+  }
+  if (nb_ids != 0)
+    util::atomic::die("bogus edge line");
+}
+
+/* Same as `read_snap_graph`, but overlaps reading the file with
+ * parsing: the file is read in chunks of `chunk_szb` bytes, extended to
+ * the end of their last line, which go through a `native::pipeline` of
+ * at most `max_in_flight` chunks:
+ *   - input (serial in order): reads the next chunk
+ *   - parse (parallel): parses the edges of the chunk
+ *   - max (serial out of order): updates the largest vertex id
+ *   - offset (serial in order): assigns the chunk its place in the list
+ *   - copy (parallel): copies the edges of the chunk to the list
+ * Only `max_in_flight` chunks are in memory at a time, instead of the
+ * whole file.
+ */
+template <class Edge_bag>
+void read_snap_graph_streaming(std::string fname, edgelist<Edge_bag>& dst,
+                               long chunk_szb = 1l << 20, long max_in_flight = 16) {
+  using vtxid_type = typename edgelist<Edge_bag>::vtxid_type;
+  using edge_type = typename edgelist<Edge_bag>::edge_type;
+  using chunk_type = snap_chunk<edge_type>;
+  using pipeline_type = sched::native::pipeline<chunk_type>;
+  std::ifstream in(fname);
+  vtxid_type nb_vertices;
+  edgeid_type nb_edges;
+  read_snap_header(in, nb_vertices, nb_edges);
+  dst.edges.alloc(nb_edges);
+  vtxid_type max_vtxid = vtxid_type(0);
+  edgeid_type nb_actual_edges = 0;
+  pipeline_type pipeline(max_in_flight);
+  pipeline.add_stage(pipeline_type::parallel, [] (chunk_type& c) {
+    parse_snap_edges(c.bytes, c.edges, c.max_vtxid);
+  });
+  pipeline.add_stage(pipeline_type::serial_out_of_order, [&] (chunk_type& c) {
+    max_vtxid = std::max(max_vtxid, c.max_vtxid);
+  });
+  pipeline.add_stage(pipeline_type::serial_in_order, [&] (chunk_type& c) {
+    c.offset = nb_actual_edges;
+    nb_actual_edges += edgeid_type(c.edges.size());
+    if (nb_actual_edges > nb_edges)
+      util::atomic::die("inconsistent edge counts");
+  });
+  pipeline.add_stage(pipeline_type::parallel, [&] (chunk_type& c) {
+    std::copy(c.edges.begin(), c.edges.end(), &dst.edges[c.offset]);
+  });
+  pipeline.run([&] (chunk_type& c) {
+    c.bytes.resize(chunk_szb);
+    in.read(&c.bytes[0], chunk_szb);
+    c.bytes.resize(in.gcount());
+    if (c.bytes.empty())
+      return false;
+    std::string rest;
+    std::getline(in, rest);
+    c.bytes += rest;
+    return true;
+  });
+  in.close();
+  if (nb_actual_edges != nb_edges)
+    util::atomic::die("inconsistent edge counts");
+  dst.nb_vertices = max_vtxid + 1;
+}
   
 template <class Vertex_id>
 void read_snap_graph(std::string fname, adjlist<flat_adjlist_seq<Vertex_id>>& graph) {
@@ -8,6 +8,7 @@
  */
 
 #include "benchmark.hpp"
+#include "pcontainer.hpp"
 #include "hash.hpp"
 #include "dup.hpp"
 #include "string.hpp"
@@ -46,6 +47,32 @@ sparray exp_dist_sparray(long s, long n) {
   return tmp;
 }
 
+loop_controller_type find_first_contr("find_first");
+
+/* returns the smallest index i such that xs[i] == x, or xs.size() if
+ * there is none; if `cancel`, the search is cancelled as soon as one
+ * occurrence is found, so that the result is the first occurrence only
+ * if x occurs once in xs */
+long find_first(const sparray& xs, value_type x, bool cancel) {
+  long n = xs.size();
+  std::atomic<long> result(n);
+  pasl::sched::native::cancellable([&] {
+    const pasl::sched::cancellation::token* token =
+      pasl::sched::native::my_thread()->cancel_token;
+    par::parallel_for(find_first_contr, 0l, n, [&] (long i) {
+      if (cancel && token->is_cancelled_here())
+        return;
+      if (xs[i] != x)
+        return;
+      long r = result.load();
+      while (i < r && ! result.compare_exchange_weak(r, i));
+      if (cancel)
+        pasl::sched::native::cancel();
+    });
+  });
+  return result.load();
+}
+
 /*---------------------------------------------------------------------*/
 /* Benchmark framework */
 
@@ -367,6 +394,110 @@ benchmark_type sort_bench() {
   return make_benchmark(init, bench, output, destroy);
 }
 
+// time to find the only occurrence of a key, with and without cancellation
+benchmark_type find_first_bench() {
+  long n = pasl::util::cmdline::parse_or_default_long("n", 1l<<26);
+  long position = pasl::util::cmdline::parse_or_default_long("position", n/8);
+  bool cancel = pasl::util::cmdline::parse_or_default_bool("cancel", true);
+  sparray* inp = new sparray(0);
+  long* result = new long;
+  auto init = [=] {
+    *inp = fill(n, 0);
+    (*inp)[std::max(0l, std::min(position, n-1))] = 1;
+  };
+  auto bench = [=] {
+    *result = find_first(*inp, 1, cancel);
+  };
+  auto output = [=] {
+    std::cout << "result " << *result << std::endl;
+  };
+  auto destroy = [=] {
+    delete inp;
+    delete result;
+  };
+  return make_benchmark(init, bench, output, destroy);
+}
+
+/* Compares the parallel algorithms of `sparray` with those of
+ * `pcontainer` on a chunked sequence of the same items:
+ *   - `-op <string>` (default=reduce): one of `reduce` (sum),
+ *     `count_if` (number of even items), `scan` (inclusive prefix
+ *     sums), `filter` (even items) and `transform` (items plus one)
+ *   - `-seq <string>` (default=sparray): `sparray` or `chunkedseq`
+ * The result, which does not depend on `seq`, is the sum of the
+ * output, or the output itself for `reduce` and `count_if`. */
+benchmark_type seqalgo_bench() {
+  using chunkedseq_type = pasl::data::pcontainer::deque<value_type>;
+  namespace pcontainer = pasl::data::pcontainer;
+  long n = pasl::util::cmdline::parse_or_default_long("n", 1l<<20);
+  std::string op = pasl::util::cmdline::parse_or_default_string("op", "reduce");
+  std::string seq = pasl::util::cmdline::parse_or_default_string("seq", "sparray");
+  if (seq != "sparray" && seq != "chunkedseq")
+    pasl::util::atomic::die("bogus seq %s", seq.c_str());
+  sparray* inp = new sparray(0);
+  sparray* outp = new sparray(0);
+  chunkedseq_type* cinp = new chunkedseq_type;
+  chunkedseq_type* coutp = new chunkedseq_type;
+  value_type* result = new value_type(0);
+  auto init = [=] {
+    *inp = gen_random_sparray(n);
+    if (seq == "chunkedseq") {
+      pcontainer::from_range(&(*inp)[0], &(*inp)[0] + n, *cinp);
+      *inp = sparray(0);
+    }
+  };
+  auto is_even = [] (value_type x) {
+    return x % 2 == 0;
+  };
+  auto plus1 = [] (value_type x) {
+    return x + 1;
+  };
+  auto bench = [=] {
+    if (seq == "sparray") {
+      sparray& in = *inp;
+      if (op == "reduce")
+        *result = sum(in);
+      else if (op == "count_if")
+        *result = reduce(plus_fct, [&] (value_type x) { return value_type(is_even(x)); }, 0l, in);
+      else if (op == "scan")
+        *outp = prefix_sums_incl(in);
+      else if (op == "filter")
+        *outp = filter(is_even, in);
+      else if (op == "transform")
+        *outp = map(plus1, in);
+      else
+        pasl::util::atomic::die("bogus op %s", op.c_str());
+    } else {
+      chunkedseq_type& in = *cinp;
+      if (op == "reduce")
+        *result = pcontainer::reduce(in, value_type(0), plus_fct);
+      else if (op == "count_if")
+        *result = value_type(pcontainer::count_if(in, is_even));
+      else if (op == "scan")
+        pcontainer::inclusive_scan(in, *coutp, value_type(0), plus_fct);
+      else if (op == "filter")
+        pcontainer::filter(in, *coutp, is_even);
+      else if (op == "transform")
+        pcontainer::transform(in, *coutp, plus1);
+      else
+        pasl::util::atomic::die("bogus op %s", op.c_str());
+    }
+  };
+  auto output = [=] {
+    if (op != "reduce" && op != "count_if")
+      *result = (seq == "sparray") ? sum(*outp) : pcontainer::reduce(*coutp, value_type(0), plus_fct);
+    std::cout << "result " << *result << std::endl;
+  };
+  auto destroy = [=] {
+    delete inp;
+    delete outp;
+    delete cinp;
+    delete coutp;
+    delete result;
+  };
+  return make_benchmark(init, bench, output, destroy);
+}
+
 benchmark_type graph_bench() {
   adjlist* graphp = new adjlist;
   sparray* visitedp = new sparray;
@@ -417,6 +548,8 @@ int main(int argc, char** argv) {
     m.add("graph",                [&] { return graph_bench(); });
     m.add("duplicate",            [&] { return duplicate_bench(); });
     m.add("ktimes",               [&] { return ktimes_bench(); });
+    m.add("find_first",           [&] { return find_first_bench(); });
+    m.add("seqalgo",              [&] { return seqalgo_bench(); });
     
 
     m.add("map_incr_ex",          [&] { return map_incr_bench(true); });
@@ -1,18 +1,24 @@
 /* COPYRIGHT (c) 2011 Arthur Chargueraud and Michael Rainey
  * All rights reserved.
  *
- * Barriers (implemented using pthread_barrier or spinning)
+ * Barriers (implemented using pthread_barrier, spinning, a combining
+ * tree or dissemination)
  * 
  */
 
 #ifndef _PASL_UTIL_BARRIER_H_
 #define _PASL_UTIL_BARRIER_H_
 
+#include <algorithm>
 #include <atomic>
 #include <iostream>
+#include <limits.h>
+#include <stdlib.h>
 
 #include "atomic.hpp"
 #include "microtime.hpp"
+#include "pcmdline.hpp"
+#include "futex.hpp"
 
 /*! \defgroup barrier Barrier
  * \ingroup sync
@@ -33,8 +39,65 @@ namespace barrier {
  */
 class signature {
 public:
+  virtual ~signature() { }
   virtual void init(int nb_workers) = 0;
   virtual void wait() = 0;
+  /*! \brief Same as `wait()`, for the participant `id`
+   *
+   * \pre `id` is in [0, nb_workers) and distinct from the ids of the
+   * other participants of the same phase
+   */
+  virtual void wait(int id) {
+    wait();
+  }
+};
+
+/*---------------------------------------------------------------------*/
+/* Waiting for a flag */
+
+static constexpr int nb_spins_before_block = 2000;
+
+static inline void cpu_relax() {
+#ifdef TARGET_X86_64
+  __builtin_ia32_pause();
+#endif
+}
+
+/*! \brief Waits until `done(v)` holds for the value `v` of `flag`
+ *
+ * The caller spins for a while; then, if `block` is set, it sleeps on
+ * a futex until the value of `flag` changes, in which case whoever
+ * changes it must call `futex::wake(flag, ...)`.
+ */
+template <class Done>
+static inline void await(std::atomic<int>* flag, bool block, const Done& done) {
+  for (int i = 0; ; i++) {
+    int v = flag->load();
+    if (done(v))
+      return;
+    if (block && i >= nb_spins_before_block)
+      futex::wait(flag, v, 1000.);
+    else
+      cpu_relax();
+  }
+}
+
+/*---------------------------------------------------------------------*/
+/* Allocation on a cache line */
+
+/* Base class of the barriers whose members are aligned on a cache
+ * line, which the plain `new` of C++14 does not honor. */
+class cache_aligned {
+public:
+  static void* operator new(size_t szb) {
+    void* p = nullptr;
+    if (posix_memalign(&p, 64, szb) != 0)
+      atomic::die("barrier: out of memory\n");
+    return p;
+  }
+  static void operator delete(void* p) {
+    free(p);
+  }
 };
 
 /*---------------------------------------------------------------------*/
@@ -97,17 +160,259 @@ public:
   
 };
 
+/*---------------------------------------------------------------------*/
+/**
+ * \class tree
+ * \brief Combining-tree barrier
+ * \ingroup barrier
+ *
+ * Participants are grouped by `fanin` under the leaves of a tree, and
+ * the nodes of each level are grouped by `fanin` under the nodes of
+ * the level above. The last participant to arrive at a node goes on to
+ * arrive at the parent node, so that the counter of each node takes at
+ * most `fanin` decrements per phase. The last participant to arrive at
+ * the root releases all the others by bumping a phase number. Each
+ * node sits on its own cache line.
+ *
+ * Participants that do not pass their id to `wait()` are numbered in
+ * order of arrival, at the cost of one shared fetch-and-add.
+ */
+class tree : public signature, public cache_aligned {
+private:
+  
+  static constexpr int fanin = 4;
+  
+  typedef struct {
+    std::atomic<int> nb_left;
+    int nb_children;
+    int parent;
+    int padding[(64 - 3 * sizeof(int)) / 4];
+  } node_type;
+  
+  __attribute__ ((aligned (64))) std::atomic<int> phase;
+  int padding1[64/4];
+  std::atomic<int> ticket;
+  int padding2[64/4];
+  node_type* nodes;
+  int nb_participants;
+  bool block;
+  
+  void arrive(int node) {
+    if (nodes[node].nb_left.fetch_sub(1) != 1)
+      return;
+    nodes[node].nb_left.store(nodes[node].nb_children);
+    if (nodes[node].parent >= 0) {
+      arrive(nodes[node].parent);
+    } else {
+      phase++;
+      if (block)
+        futex::wake(&phase, INT_MAX);
+    }
+  }
+  
+public:
+  
+  tree(bool block = false)
+  : nodes(NULL), block(block) { }
+  
+  ~tree() {
+    if (nodes != NULL)
+      delete [] nodes;
+  }
+  
+  void init(int nb_workers) {
+    nb_participants = nb_workers;
+    phase.store(0);
+    ticket.store(0);
+    // count the nodes, level by level, leaves first
+    int nb_nodes = 0;
+    for (int w = nb_workers; ; w = (w + fanin - 1) / fanin) {
+      int nb_level = (w + fanin - 1) / fanin;
+      nb_nodes += nb_level;
+      if (nb_level == 1)
+        break;
+    }
+    if (nodes != NULL)
+      delete [] nodes;
+    nodes = new node_type[nb_nodes];
+    int first = 0;
+    for (int w = nb_workers; ; w = (w + fanin - 1) / fanin) {
+      int nb_level = (w + fanin - 1) / fanin;
+      for (int i = 0; i < nb_level; i++) {
+        node_type& n = nodes[first + i];
+        n.nb_children = std::min(fanin, w - i * fanin);
+        n.nb_left.store(n.nb_children);
+        n.parent = (nb_level == 1) ? -1 : first + nb_level + i / fanin;
+      }
+      first += nb_level;
+      if (nb_level == 1)
+        break;
+    }
+  }
+  
+  void wait() {
+    wait(ticket.fetch_add(1) % nb_participants);
+  }
+  
+  void wait(int id) {
+    int p = phase.load();
+    arrive(id / fanin);
+    await(&phase, block, [&] (int v) { return v != p; });
+  }
+  
+};
+
+/*---------------------------------------------------------------------*/
+/**
+ * \class dissemination
+ * \brief Dissemination barrier
+ * \ingroup barrier
+ *
+ * Implements the barrier of Hensgen, Finkel and Manber: in round `r`
+ * of a phase, participant `i` signals participant `i + 2^r` (modulo
+ * the number of participants) and waits for the signal of participant
+ * `i - 2^r`. After `ceil(log2(nb_workers))` rounds, every participant
+ * has heard, directly or not, from all the others. There is no shared
+ * counter; each flag sits on its own cache line, and has a single
+ * writer. A signal is the number of the phase, which only grows, so
+ * that flags need not be reset.
+ *
+ * Participants that do not pass their id to `wait()` are numbered in
+ * order of arrival, at the cost of one shared fetch-and-add.
+ */
+class dissemination : public signature, public cache_aligned {
+private:
+  
+  typedef struct {
+    std::atomic<int> value;
+    int padding[(64 - sizeof(int)) / 4];
+  } flag_type;
+  
+  __attribute__ ((aligned (64))) std::atomic<int> ticket;
+  int padding[64/4];
+  int nb_participants;
+  int nb_rounds;
+  // flags[i * nb_rounds + r]: signal received by participant `i` in round `r`
+  flag_type* flags;
+  // phases[i]: number of the phase of participant `i`
+  flag_type* phases;
+  bool block;
+  
+public:
+  
+  dissemination(bool block = false)
+  : flags(NULL), phases(NULL), block(block) { }
+  
+  ~dissemination() {
+    if (flags != NULL)
+      delete [] flags;
+    if (phases != NULL)
+      delete [] phases;
+  }
+  
+  void init(int nb_workers) {
+    nb_participants = nb_workers;
+    nb_rounds = 0;
+    while ((1 << nb_rounds) < nb_workers)
+      nb_rounds++;
+    ticket.store(0);
+    if (flags != NULL)
+      delete [] flags;
+    if (phases != NULL)
+      delete [] phases;
+    flags = new flag_type[std::max(1, nb_workers * nb_rounds)];
+    phases = new flag_type[nb_workers];
+    for (int i = 0; i < nb_workers * nb_rounds; i++)
+      flags[i].value.store(0);
+    for (int i = 0; i < nb_workers; i++)
+      phases[i].value.store(0);
+  }
+  
+  void wait() {
+    wait(ticket.fetch_add(1) % nb_participants);
+  }
+  
+  void wait(int id) {
+    int p = phases[id].value.load() + 1;
+    phases[id].value.store(p);
+    for (int r = 0; r < nb_rounds; r++) {
+      int partner = (id + (1 << r)) % nb_participants;
+      std::atomic<int>* out = &flags[partner * nb_rounds + r].value;
+      out->store(p);
+      if (block)
+        futex::wake(out, INT_MAX);
+      std::atomic<int>* in = &flags[id * nb_rounds + r].value;
+      await(in, block, [&] (int v) { return v >= p; });
+    }
+  }
+  
+};
+
 /*---------------------------------------------------------------------*/
 /**
  * \class barrier_t
- * \brief Barrier
+ * \brief Barrier whose implementation is selected at runtime
  * \ingroup barrier
+ *
+ * Command-line parameters, read by `init()`:
+ *   - `-barrier <string>`: `spin`, `tree`, `dissemination` or, if
+ *     available, `pthread` (the default is `pthread` if available, and
+ *     `spin` otherwise)
+ *   - `-barrier_futex <bool>` (default=false): lets the `tree` and
+ *     `dissemination` barriers put the waiters to sleep after a short
+ *     spin
+ *
+ * The participants of a barrier must either all pass their ids to
+ * `wait()`, or none of them.
  */
+class barrier_t : public signature {
+private:
+  
+  signature* impl;
+  
+public:
+  
+  barrier_t() : impl(NULL) { }
+  
+  ~barrier_t() {
+    if (impl != NULL)
+      delete impl;
+  }
+  
+  void init(int nb_workers) {
 #ifdef HAVE_PTHREAD_BARRIER
-class barrier_t : public pthread { };
+    std::string dflt = "pthread";
 #else
-class barrier_t : public spin { };
+    std::string dflt = "spin";
+#endif
+    std::string kind = cmdline::parse_or_default_string("barrier", dflt, false);
+    bool block = cmdline::parse_or_default_bool("barrier_futex", false, false);
+    if (impl != NULL)
+      delete impl;
+    if (kind == "spin")
+      impl = new spin();
+    else if (kind == "tree")
+      impl = new tree(block);
+    else if (kind == "dissemination")
+      impl = new dissemination(block);
+#ifdef HAVE_PTHREAD_BARRIER
+    else if (kind == "pthread")
+      impl = new pthread();
 #endif
+    else
+      atomic::die("bogus barrier %s\n", kind.c_str());
+    impl->init(nb_workers);
+  }
+  
+  void wait() {
+    impl->wait();
+  }
+  
+  void wait(int id) {
+    impl->wait(id);
+  }
+  
+};
 
 /***********************************************************************/
 
@@ -0,0 +1,162 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file futex.hpp
+ * \brief Blocking wait on a memory word (futex) and eventcounts
+ *
+ */
+
+#ifndef _PASL_UTIL_FUTEX_H_
+#define _PASL_UTIL_FUTEX_H_
+
+#include <atomic>
+#include <limits.h>
+#include <time.h>
+#ifdef TARGET_LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "microtime.hpp"
+
+/*! \defgroup futex Futex
+ * \ingroup sync
+ * @{
+ */
+
+namespace pasl {
+namespace util {
+namespace futex {
+
+/***********************************************************************/
+
+/*---------------------------------------------------------------------*/
+/* Futex primitives */
+
+/*! \brief Suspends the calling thread for at most `nb_microseconds`,
+ *  provided that `*addr` equals `expected` at the time of the call.
+ *
+ * Spurious wakeups are possible; the caller must recheck its
+ * condition after the call returns.
+ *
+ * On platforms that lack futexes, the call degrades to a short
+ * busy wait.
+ */
+static inline void wait(std::atomic<int>* addr, int expected, double nb_microseconds) {
+#ifdef TARGET_LINUX
+  struct timespec ts;
+  long nsec = (long) (nb_microseconds * 1000.);
+  ts.tv_sec = nsec / 1000000000l;
+  ts.tv_nsec = nsec % 1000000000l;
+  syscall(SYS_futex, (int*) addr, FUTEX_WAIT_PRIVATE, expected, &ts, NULL, 0);
+#else
+  if (addr->load() == expected)
+    microtime::microsleep(1.0);
+#endif
+}
+
+/*! \brief Wakes at most `nb` threads waiting on `addr`.
+ *  \return the number of threads that were woken up, or zero if
+ *  the platform does not support futexes
+ */
+static inline int wake(std::atomic<int>* addr, int nb) {
+#ifdef TARGET_LINUX
+  return (int) syscall(SYS_futex, (int*) addr, FUTEX_WAKE_PRIVATE, nb, NULL, NULL, 0);
+#else
+  return 0;
+#endif
+}
+
+/*---------------------------------------------------------------------*/
+/**
+ * \class eventcount
+ * \brief A condition variable that requires no lock
+ * \ingroup futex
+ *
+ * Waiters follow a two-phase protocol:
+ *
+ *    int key = ec.prepare_wait();
+ *    if (condition holds) ec.cancel_wait();
+ *    else ec.commit_wait(key, timeout);
+ *
+ * Notifiers first make the condition true and then call `notify()`.
+ * A notification that comes in between `prepare_wait()` and
+ * `commit_wait()` causes `commit_wait()` to return immediately.
+ *
+ * The call to `notify()` costs a single load when there are no
+ * waiters, so that it can sit on fast paths, such as the push of a
+ * thread onto a deque.
+ */
+class eventcount {
+private:
+
+  __attribute__ ((aligned (64))) std::atomic<int> epoch;
+  std::atomic<int> nb_waiters;
+  int padding[64/4];
+
+public:
+
+  eventcount() {
+    init();
+  }
+
+  void init() {
+    epoch.store(0);
+    nb_waiters.store(0);
+  }
+
+  //! Returns the key to be passed to `commit_wait()`
+  int prepare_wait() {
+    nb_waiters++;
+    return epoch.load();
+  }
+
+  void cancel_wait() {
+    nb_waiters--;
+  }
+
+  /*! \brief Blocks until notification or until `nb_microseconds` elapse
+   *  \return true if the caller was released by a notification
+   */
+  bool commit_wait(int key, double nb_microseconds) {
+    wait(&epoch, key, nb_microseconds);
+    nb_waiters--;
+    return epoch.load() != key;
+  }
+
+  bool has_waiters() const {
+    return nb_waiters.load() > 0;
+  }
+
+  int get_nb_waiters() const {
+    return nb_waiters.load();
+  }
+
+  //! Releases at most `nb` waiters; returns true if there were any waiters
+  bool notify(int nb) {
+    if (! has_waiters())
+      return false;
+    epoch++;
+    wake(&epoch, nb);
+    return true;
+  }
+
+  //! Releases all waiters
+  void notify_all() {
+    epoch++;
+    wake(&epoch, INT_MAX);
+  }
+
+};
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+/*! @} */
+
+#endif /*! _PASL_UTIL_FUTEX_H_ */
@@ -9,6 +9,11 @@
 #include <sys/sysctl.h>
 #endif
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <map>
+#include <mutex>
 #include <vector>
 
 #include "machine.hpp"
@@ -44,6 +49,10 @@ hyperthreading_mode_t htmode;
 /* Locals */
 
 static int                 nb_pus;
+static bool                perworker_numa_local = true;
+#ifdef HAVE_HWLOC
+static bool                topology_loaded = false;
+#endif
 
 /*---------------------------------------------------------------------*/
 
@@ -147,15 +156,18 @@ void init(hyperthreading_mode_t _htmode) {
 #ifdef HAVE_HWLOC
   hwloc_topology_init (&topology);
   hwloc_topology_load (topology);
+  topology_loaded = true;
   nb_pus = get_nb_pus ();
 #else
   nb_pus = cpuinfo.nb_cpus;
 #endif
+  perworker_numa_local = cmdline::parse_or_default_bool("perworker_numa_local", true, false);
 }
 
 void destroy() {
   cache_line_szb = 0;
 #ifdef HAVE_HWLOC
+  topology_loaded = false;
   hwloc_topology_destroy(topology);
 #endif
 }
@@ -351,6 +363,7 @@ void binding_policy::destroy() {
   }
   delete [] cpusets;
 #endif
+  nb_workers = 0;
 }
 
 void binding_policy::pin_calling_thread(worker_id_t my_id) {
@@ -391,6 +404,10 @@ hwloc_nodeset_t binding_policy::nodeset_of_worker(worker_id_t my_id_or_undef) {
   hwloc_cpuset_to_nodeset(topology, cpuset, nodeset);
   return nodeset;
 }
+
+hwloc_cpuset_t binding_policy::cpuset_of_worker(worker_id_t my_id) {
+  return hwloc_bitmap_dup(cpusets[(int)my_id]);
+}
 #endif
 
 /*---------------------------------------------------------------------*/
@@ -408,6 +425,12 @@ void numa::init(int nb_workers) {
       printf("Warning: failed to set NUMA round-robin allocation policy\n");
   }
 #endif
+  // the module may be initialized again, with another number of workers
+  delete [] nodes;
+  delete [] nb_workers_per_node;
+  delete [] node_ranks;
+  delete [] leaders;
+  node_info.clear();
   nodes = new node_id_t[nb_workers];
   int max_node_id = 0;
   for (worker_id_t id = 0; id < nb_workers; id++) {
@@ -508,6 +531,218 @@ worker_id_t numa::set_leader_of_node(node_id_t node, worker_id_t id) {
 
 numa the_numa;
 
+/*---------------------------------------------------------------------*/
+
+#ifdef HAVE_HWLOC
+/* returns the logical index of the L3 cache that covers all CPUs on
+ * which the given worker may execute, or -1 if there is none */
+static int l3_of_cpuset(hwloc_cpuset_t cpuset) {
+  hwloc_obj_t obj = hwloc_get_obj_covering_cpuset(topology, cpuset);
+  for (; obj != NULL; obj = obj->parent) {
+#if HWLOC_API_VERSION >= 0x00020000
+    if (obj->type == HWLOC_OBJ_L3CACHE)
+      return (int)obj->logical_index;
+#else
+    if (obj->type == HWLOC_OBJ_CACHE && obj->attr->cache.depth == 3)
+      return (int)obj->logical_index;
+#endif
+  }
+  return -1;
+}
+#endif
+
+void proximity::init(int nb_workers) {
+  int sim_workers_per_l3 = cmdline::parse_or_default_int("sim_workers_per_l3", 0, false);
+  int sim_workers_per_node = cmdline::parse_or_default_int("sim_workers_per_node", 0, false);
+  simulated_nodes = (sim_workers_per_node > 0);
+  l3_of_worker.assign(nb_workers, -1);
+  node_of_worker.assign(nb_workers, 0);
+  for (worker_id_t id = 0; id < nb_workers; id++) {
+    if (sim_workers_per_node > 0)
+      node_of_worker[id] = (node_id_t)(id / sim_workers_per_node);
+    else
+      node_of_worker[id] = the_numa.node_of_worker(id);
+    if (sim_workers_per_l3 > 0) {
+      l3_of_worker[id] = (int)(id / sim_workers_per_l3);
+    } else {
+#ifdef HAVE_HWLOC
+      hwloc_cpuset_t cpuset = the_bindpolicy.cpuset_of_worker(id);
+      l3_of_worker[id] = l3_of_cpuset(cpuset);
+      hwloc_bitmap_free(cpuset);
+#endif
+    }
+  }
+  peers.assign(nb_workers, std::vector<worker_set_t>(NB_PROXIMITY_LEVELS));
+  for (worker_id_t id1 = 0; id1 < nb_workers; id1++)
+    for (worker_id_t id2 = 0; id2 < nb_workers; id2++)
+      if (id1 != id2)
+        peers[id1][level_between(id1, id2)].push_back(id2);
+}
+
+proximity_level_t proximity::level_between(worker_id_t id1, worker_id_t id2) const {
+  if (l3_of_worker[id1] != -1 && l3_of_worker[id1] == l3_of_worker[id2])
+    return PROXIMITY_L3;
+  else if (node_of_worker[id1] == node_of_worker[id2])
+    return PROXIMITY_NODE;
+  else
+    return PROXIMITY_REMOTE;
+}
+
+const std::vector<worker_id_t>& proximity::peers_of(worker_id_t id,
+                                                    proximity_level_t level) const {
+  return peers[id][level];
+}
+
+node_id_t proximity::node_of(worker_id_t id) const {
+  return node_of_worker[id];
+}
+
+int proximity::get_nb_workers() const {
+  return (int)node_of_worker.size();
+}
+
+bool proximity::has_simulated_nodes() const {
+  return simulated_nodes;
+}
+
+proximity the_proximity;
+
+/*---------------------------------------------------------------------*/
+
+node_id_t home_node_of_worker(worker_id_t id) {
+  if (! perworker_numa_local || id < 0 || id >= the_proximity.get_nb_workers())
+    return node_undef;
+  return the_proximity.node_of(id);
+}
+
+/* Header that precedes each block returned by `alloc_near_worker()`;
+ * `node` is `node_undef` for heap blocks. */
+typedef struct {
+  size_t szb;
+  node_id_t node;
+} block_header_t;
+
+static constexpr size_t block_header_szb = 64;
+
+/* Bound blocks that were released, by node and by size. The table is
+ * never destroyed, because blocks can be released by the destructors
+ * of static objects. */
+typedef std::map<std::pair<node_id_t, size_t>, std::vector<char*>> free_blocks_t;
+static std::mutex free_blocks_lock;
+static free_blocks_t* free_blocks = new free_blocks_t;
+
+/* Bound blocks that were released by each worker, which are reused
+ * first by that worker, without any lock, so that the containers
+ * that live as long as a finish block do not serialize on the table
+ * above. Only the workers with ids below `max_nb_block_caches` have a
+ * cache. */
+static constexpr int max_nb_block_caches = 128;
+static constexpr int block_cache_capacity = 14;
+
+typedef struct {
+  int nb;
+  char* blocks[block_cache_capacity];
+} __attribute__ ((aligned (64))) block_cache_t;
+
+static block_cache_t block_caches[max_nb_block_caches];
+
+static block_cache_t* my_block_cache() {
+  worker_id_t my_id = worker::get_my_id();
+  if (my_id < 0 || my_id >= max_nb_block_caches)
+    return NULL;
+  return &block_caches[my_id];
+}
+
+// Returns the node to which to bind the pages of a block, if any
+static node_id_t binding_node_of_worker(worker_id_t id) {
+#ifdef HAVE_HWLOC
+  if (topology_loaded
+      && ! the_proximity.has_simulated_nodes()
+      && hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_NODE) > 1)
+    return home_node_of_worker(id);
+#endif
+  return node_undef;
+}
+
+void* alloc_near_worker(worker_id_t id, size_t szb, bool clear) {
+  node_id_t node = binding_node_of_worker(id);
+  size_t total_szb = block_header_szb + szb;
+  char* b = NULL;
+  if (node == node_undef) {
+    if (posix_memalign((void**)&b, block_header_szb, total_szb) != 0)
+      atomic::die("alloc_near_worker: out of memory\n");
+    if (clear)
+      memset(b + block_header_szb, 0, szb);
+  } else {
+#ifdef HAVE_HWLOC
+    size_t page_szb = (size_t)sysconf(_SC_PAGESIZE);
+    size_t used_szb = total_szb;
+    total_szb = (total_szb + page_szb - 1) / page_szb * page_szb;
+    block_cache_t* cache = my_block_cache();
+    for (int i = 0; cache != NULL && i < cache->nb; i++) {
+      block_header_t* h = (block_header_t*)cache->blocks[i];
+      if (h->node == node && h->szb == total_szb) {
+        b = cache->blocks[i];
+        cache->blocks[i] = cache->blocks[--cache->nb];
+        break;
+      }
+    }
+    if (b == NULL) {
+      free_blocks_lock.lock();
+      std::vector<char*>& recycled = (*free_blocks)[std::make_pair(node, total_szb)];
+      if (! recycled.empty()) {
+        b = recycled.back();
+        recycled.pop_back();
+      }
+      free_blocks_lock.unlock();
+    }
+    if (b != NULL) {
+      // the caller uses only the first `szb` bytes
+      if (clear)
+        memset(b + block_header_szb, 0, used_szb - block_header_szb);
+    } else {
+      void* m = mmap(NULL, total_szb, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (m == MAP_FAILED)
+        atomic::die("alloc_near_worker: out of memory\n");
+      b = (char*)m;
+      hwloc_nodeset_t nodeset = hwloc_bitmap_alloc();
+      hwloc_bitmap_only(nodeset, node);
+      // on failure, the pages are placed by first touch
+#if HWLOC_API_VERSION >= 0x00020000
+      hwloc_set_area_membind(topology, b, total_szb, nodeset,
+                             HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET);
+#else
+      hwloc_set_area_membind_nodeset(topology, b, total_szb, nodeset,
+                                     HWLOC_MEMBIND_BIND, 0);
+#endif
+      hwloc_bitmap_free(nodeset);
+    }
+#endif
+  }
+  block_header_t* h = (block_header_t*)b;
+  h->szb = total_szb;
+  h->node = node;
+  return b + block_header_szb;
+}
+
+void free_near_worker(void* p) {
+  char* b = (char*)p - block_header_szb;
+  block_header_t* h = (block_header_t*)b;
+  if (h->node == node_undef) {
+    free(b);
+    return;
+  }
+  block_cache_t* cache = my_block_cache();
+  if (cache != NULL && cache->nb < block_cache_capacity) {
+    cache->blocks[cache->nb++] = b;
+    return;
+  }
+  free_blocks_lock.lock();
+  (*free_blocks)[std::make_pair(h->node, h->szb)].push_back(b);
+  free_blocks_lock.unlock();
+}
+
 /***********************************************************************/
 
 } // end namespace
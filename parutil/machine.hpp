@@ -92,6 +92,13 @@ public:
    * by calling hwloc_bitmap_free().
    */
   hwloc_nodeset_t nodeset_of_worker(worker_id_t my_id_or_undef);
+  /* \brief Returns the set of CPUs on which the given worker may
+   * execute.
+   *
+   * \warning The caller is responsible to free the return result
+   * by calling hwloc_bitmap_free().
+   */
+  hwloc_cpuset_t cpuset_of_worker(worker_id_t my_id);
 #endif
 
 protected:
@@ -181,6 +188,93 @@ public:
   
 extern numa the_numa;
 
+/*---------------------------------------------------------------------*/
+
+/*! \brief Levels of the memory hierarchy at which two workers meet,
+ *  from the closest to the farthest.
+ */
+typedef enum {
+  PROXIMITY_L3 = 0,  // the two workers share a last-level (L3) cache
+  PROXIMITY_NODE,    // the two workers share a NUMA node, but no L3 cache
+  PROXIMITY_REMOTE,  // the two workers are on different NUMA nodes
+  NB_PROXIMITY_LEVELS
+} proximity_level_t;
+
+/*! \class proximity
+ *  \brief Groups, for each worker, the other workers by how close
+ *  they are in the memory hierarchy.
+ *
+ * The information is mined from the hwloc topology and the binding
+ * policy; in particular, workers that are not bound to a set of CPUs
+ * are not considered to share any cache. Without hwloc, all workers
+ * share NUMA node 0.
+ *
+ * For experiments on machines with a single node, a topology can be
+ * simulated from the command line:
+ *   - `-sim_workers_per_l3 <int>` puts workers `k*n`, ..., `k*n+n-1`
+ *     under the same L3 cache
+ *   - `-sim_workers_per_node <int>` likewise for NUMA nodes
+ */
+class proximity {
+private:
+  typedef std::vector<worker_id_t> worker_set_t;
+  std::vector<int> l3_of_worker;
+  std::vector<node_id_t> node_of_worker;
+  bool simulated_nodes;
+  // peers[id][level] = workers that meet worker id at the given level
+  std::vector<std::vector<worker_set_t>> peers;
+
+public:
+  //! \pre `the_numa` is initialized
+  void init(int nb_workers);
+  //! Returns the level at which workers `id1` and `id2` meet
+  proximity_level_t level_between(worker_id_t id1, worker_id_t id2) const;
+  //! Returns the workers, other than `id`, that meet `id` at `level`
+  const std::vector<worker_id_t>& peers_of(worker_id_t id, proximity_level_t level) const;
+  /*! \brief Returns the NUMA node of the given worker, taking into
+   *  account the simulated topology */
+  node_id_t node_of(worker_id_t id) const;
+  //! Returns the number of workers, or zero before `init()`
+  int get_nb_workers() const;
+  //! Returns true if the NUMA nodes are simulated from the command line
+  bool has_simulated_nodes() const;
+};
+
+extern proximity the_proximity;
+
+/*---------------------------------------------------------------------*/
+/* NUMA-local allocation */
+
+/*! \brief Returns the NUMA node on which to place the data that is
+ *  private to the given worker
+ *
+ * Takes into account the simulated topology. Returns `node_undef`
+ * before `the_proximity` is initialized, for ids out of range, and
+ * if `-perworker_numa_local 0` was given.
+ */
+node_id_t home_node_of_worker(worker_id_t id);
+
+/*! \brief Allocates a block of `szb` bytes, aligned on a cache
+ *  line, on the NUMA node of the given worker
+ *
+ * With hwloc, on a machine with several NUMA nodes, the pages of the
+ * block are bound to the home node of the worker. Otherwise, the
+ * block is an ordinary heap block, whose fresh pages get placed by
+ * their first touch.
+ *
+ * The block is zero filled, unless `clear` is false, in which case
+ * the contents are undefined and the allocation does not write to the
+ * block, which leaves the first touch to the users of the block.
+ *
+ * Bound blocks are recycled by `free_near_worker()` rather than
+ * returned to the system: unmapping pages would shoot down the TLBs
+ * of all the workers. Each worker keeps a few of the blocks that it
+ * releases, and reuses them without taking any lock.
+ */
+void* alloc_near_worker(worker_id_t id, size_t szb, bool clear = true);
+//! Releases a block that was allocated by `alloc_near_worker()`
+void free_near_worker(void* p);
+
 /***********************************************************************/
 
 } // namespace
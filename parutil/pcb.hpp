@@ -2,14 +2,17 @@
  * Rainey
  * All rights reserved.
  *
- * Producer-consumer buffers (built on top of linked lists)
+ * Producer-consumer buffers (built on top of linked lists or of
+ * ring buffers)
  *
  */
 
 #ifndef _PCB_H_
 #define _PCB_H_
 
+#include <assert.h>
 #include <atomic>
+#include <cstddef>
 
 namespace pasl {
 namespace data {
@@ -33,6 +36,7 @@ namespace pcb {
 template <typename Item>
 class signature {
 public:
+  virtual ~signature() { }
   virtual bool empty() = 0;
   //! Pushes item `m` on the PCB
   virtual void push(Item m) = 0;
@@ -58,7 +62,7 @@ class linked : public pcb::signature<Item> {
   
 private:
   struct item_s {
-    std::atomic<Item> msg;
+    Item msg;
     std::atomic<struct item_s*> next;
   };
   
@@ -97,28 +101,23 @@ public:
   }
 
   bool empty() {
-    return head->next == NULL;
+    return head->next.load(std::memory_order_acquire) == NULL;
   }
   
   void push(Item m) {
-    assert(false);
-    /*
     item_p item = item_create();
-    tail->msg.store(m);
-    // need store-store barrier
-    tail->next.store(item);
+    tail->msg = m;
+    // publishes the message along with the new tail
+    tail->next.store(item, std::memory_order_release);
     tail = item;
-    */
   }
   
   void pop(Item& m) {
-    /*
-   assert(! empty());
-    m = head->msg.load();
+    assert(! empty());
+    m = head->msg;
     item_p tmp = head;
-    head = head->next.load();
+    head = head->next.load(std::memory_order_relaxed);
     delete tmp;
-    */
   }
   
   bool try_pop(Item& m) {
@@ -132,6 +131,129 @@ public:
 };
   
   
+/*---------------------------------------------------------------------*/
+/**
+ * \class ring
+ * \ingroup pcb
+ * \brief PCB implemented with a bounded ring buffer
+ *
+ * Unlike `linked`, the ring allocates nothing per item, and items can
+ * be transferred in batches, at the cost of one release store per
+ * batch. Each side keeps a private copy of the index of the other
+ * side, and reloads the shared index only when its copy says that the
+ * ring is full (producer) or empty (consumer).
+ *
+ * The push of an item fails when the ring is full; `push()` then
+ * spins until the consumer makes room.
+ */
+template <typename Item>
+class ring : public pcb::signature<Item> {
+  
+private:
+  
+  // written by the consumer
+  __attribute__ ((aligned (64))) std::atomic<size_t> head;
+  size_t tail_cache;
+  // written by the producer
+  __attribute__ ((aligned (64))) std::atomic<size_t> tail;
+  size_t head_cache;
+  // read-only after init()
+  __attribute__ ((aligned (64))) Item* items;
+  size_t mask;
+
+  size_t nb_free_slots() {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head_cache > mask)
+      head_cache = head.load(std::memory_order_acquire);
+    return mask + 1 - (t - head_cache);
+  }
+
+  size_t nb_ready_items() {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (tail_cache == h)
+      tail_cache = tail.load(std::memory_order_acquire);
+    return tail_cache - h;
+  }
+  
+public:
+  
+  ring() : items(NULL), mask(0) { }
+  
+  ring(const ring& src) : items(NULL), mask(0) { }
+  
+  /*! \param capacity the maximum number of items in the ring, rounded
+   *  up to a power of two
+   */
+  void init(size_t capacity) {
+    size_t c = 1;
+    while (c < capacity)
+      c *= 2;
+    items = new Item[c];
+    mask = c - 1;
+    head.store(0);
+    tail.store(0);
+    head_cache = 0;
+    tail_cache = 0;
+  }
+  
+  void destroy() {
+    delete [] items;
+    items = NULL;
+  }
+
+  size_t capacity() const {
+    return mask + 1;
+  }
+  
+  bool empty() {
+    return nb_ready_items() == 0;
+  }
+
+  /*! \brief Pushes the `nb` items of `src`, or as many of them as fit
+   *  \return the number of items pushed, from the front of `src`
+   */
+  size_t try_push_batch(const Item* src, size_t nb) {
+    size_t nb_free = nb_free_slots();
+    if (nb > nb_free)
+      nb = nb_free;
+    size_t t = tail.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < nb; i++)
+      items[(t + i) & mask] = src[i];
+    tail.store(t + nb, std::memory_order_release);
+    return nb;
+  }
+
+  bool try_push(Item m) {
+    return try_push_batch(&m, 1) == 1;
+  }
+  
+  void push(Item m) {
+    while (! try_push(m));
+  }
+
+  /*! \brief Pops at most `nb` items, oldest first, to `dst`
+   *  \return the number of items popped
+   */
+  size_t try_pop_batch(Item* dst, size_t nb) {
+    size_t nb_ready = nb_ready_items();
+    if (nb > nb_ready)
+      nb = nb_ready;
+    size_t h = head.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < nb; i++)
+      dst[i] = items[(h + i) & mask];
+    head.store(h + nb, std::memory_order_release);
+    return nb;
+  }
+  
+  void pop(Item& m) {
+    while (! try_pop(m));
+  }
+  
+  bool try_pop(Item& m) {
+    return try_pop_batch(&m, 1) == 1;
+  }
+};
+  
 /***********************************************************************/
   
 } // end namespace
@@ -7,7 +7,10 @@
  *
  */
 
+#include <algorithm>
+#include <functional>
 #include <utility>
+#include <vector>
 
 #include "native.hpp"
 #include "container.hpp"
@@ -40,6 +43,10 @@ using stack = chunkedseq::bootstrapped::stack<Item, chunk_capacity>;
 template <class Item>
 using bag = chunkedseq::bootstrapped::bagopt<Item, chunk_capacity>;
 
+//! reducer that appends to a bag the items pushed by all the strands
+template <class Item>
+using bag_reducer = reducer::concat<bag<Item>>;
+
 //--------------------------
 // for benchmarking purposes
   
@@ -54,47 +61,326 @@ using ftree_bag = chunkedseq::ftree::bagopt<Item, chunk_capacity>;
   
 //--------------------------
   
-template <class Container, class Body>
-void for_each_segment(const Container& cont, const Body& body) {
+/*---------------------------------------------------------------------*/
+/* Splits by position
+ *
+ * The parallel algorithms below split their input by positions; each
+ * split is a search from the root of the container, guided by the
+ * sizes cached in its tree, so that the span of a traversal stays
+ * polylogarithmic. The pieces are then processed one segment at a
+ * time, that is, one contiguous run of items of a chunk at a time.
+ */
+
+/* Calls `body(beg, end, out)` on ranges of iterators that cover the
+ * container, each holding at most `loop_cutoff` items or a single item;
+ * the output of a range is initialized by `identity(out)`, and joined
+ * to the output of the range to its left by `join(left, right)`. */
+template <class Container, class Output, class Identity, class Join, class Body>
+void forkjoin_segments(const Container& cont, Output& out, const Identity& identity,
+                       const Join& join, const Body& body) {
   using size_type = typename Container::size_type;
   using iterator_type = typename Container::iterator;
-  using segment_type = typename Container::segment_type;
-  using input_type = std::pair<iterator_type, iterator_type>;
-  auto cutoff = [] (const input_type& in) {
-    size_type sz_beg = in.first.size();
-    size_type sz_end = in.second.size();
-    return sz_end - sz_beg <= size_type(native::loop_cutoff);
+  using range_type = std::pair<iterator_type, iterator_type>;
+  range_type in(cont.begin(), cont.end());
+  auto cutoff = [] (const range_type& r) {
+    size_type nb = size_type(r.second - r.first);
+    return nb <= 1 || nb <= size_type(native::loop_cutoff);
   };
-  auto split = [&] (input_type& src, input_type& dst) {
-    size_type sz_beg = src.first.size();
-    size_type sz_end = src.second.size();
-    iterator_type mid = cont.begin() + ((sz_beg + sz_end) / 2);
-    dst.first = mid;
+  auto split = [&] (range_type& src, range_type& dst) {
+    // `size()` is the one-based position of an iterator
+    size_type mid = (src.first.size() + src.second.size()) / 2 - 1;
+    dst.first = cont.begin() + mid;
     dst.second = src.second;
-    src.second = mid;
+    src.second = dst.first;
+  };
+  auto set_in_env = [] (range_type&) { };
+  auto _body = [&] (range_type& r, Output& out) {
+    body(r.first, r.second, out);
   };
+  native::forkjoin(in, out, cutoff, split, join, set_in_env, identity, _body);
+}
+
+//! Reads the items of a container in order, from a given position
+template <class Container>
+class segment_cursor {
+public:
+
+  using size_type = typename Container::size_type;
+  using iterator_type = typename Container::iterator;
+  using pointer = typename Container::value_type*;
+
+  //! Iterator on the first item read from the current segment
+  iterator_type it;
+  pointer b;
+  pointer p;
+  pointer e;
+
+  segment_cursor(const Container& cont, size_type i)
+  : it(cont.begin() + i) {
+    load_segment();
+  }
+
+  void load_segment() {
+    auto seg = it.get_segment();
+    b = p = seg.middle;
+    e = seg.end;
+  }
+
+  pointer next() {
+    if (p == e) {
+      it += size_type(e - b);
+      load_segment();
+    }
+    return p++;
+  }
+
+};
+
+/*---------------------------------------------------------------------*/
+/* Loop bodies that fill the chunks of a new container, in order, from
+ * a cursor (see `chunkwise_pushn_back`) */
+
+template <class Alloc, class Cursor, class Func>
+class transform_foreach_body {
+public:
+  typedef Alloc allocator_type;
+  typedef typename Alloc::size_type size_type;
+  typedef typename Alloc::reference reference;
+
+  mutable Cursor cursor;
+  const Func& f;
+
+  transform_foreach_body(const Cursor& cursor, const Func& f)
+  : cursor(cursor), f(f) { }
+
+  void operator()(size_type, reference dst) const {
+    dst = f(*cursor.next());
+  }
+};
+
+template <class Alloc, class Cursor, class Pred>
+class filter_foreach_body {
+public:
+  typedef Alloc allocator_type;
+  typedef typename Alloc::size_type size_type;
+  typedef typename Alloc::reference reference;
+
+  mutable Cursor cursor;
+  const Pred& p;
+
+  filter_foreach_body(const Cursor& cursor, const Pred& p)
+  : cursor(cursor), p(p) { }
+
+  void operator()(size_type, reference dst) const {
+    auto x = cursor.next();
+    while (! p(*x))
+      x = cursor.next();
+    dst = *x;
+  }
+};
+
+template <class Alloc, class Cursor, class Combine, bool Inclusive>
+class scan_foreach_body {
+public:
+  typedef Alloc allocator_type;
+  typedef typename Alloc::size_type size_type;
+  typedef typename Alloc::value_type value_type;
+  typedef typename Alloc::reference reference;
+
+  mutable Cursor cursor;
+  mutable value_type acc;
+  const Combine& op;
+
+  scan_foreach_body(const Cursor& cursor, const value_type& acc, const Combine& op)
+  : cursor(cursor), acc(acc), op(op) { }
+
+  void operator()(size_type, reference dst) const {
+    if (Inclusive) {
+      acc = op(acc, *cursor.next());
+      dst = acc;
+    } else {
+      dst = acc;
+      acc = op(acc, *cursor.next());
+    }
+  }
+};
+
+template <class Container>
+class parallel_chunk_loop {
+public:
+  using size_type = typename Container::size_type;
+
+  template <class Fill>
+  void operator()(size_type nb_chunks, const Fill& fill) const {
+    native::parallel_for1(size_type(0), nb_chunks, [&] (size_type k) {
+      fill(k);
+    });
+  }
+};
+
+/*---------------------------------------------------------------------*/
+/* Parallel algorithms
+ *
+ * The bodies work one segment at a time, on a pair of pointers, so
+ * that their inner loops are plain loops over arrays. The algorithms
+ * that produce a container append their results to `dst`, by whole
+ * chunks that are filled in parallel.
+ */
+
+template <class Container, class Body>
+void for_each_segment(const Container& cont, const Body& body) {
+  using iterator_type = typename Container::iterator;
   struct { } dummy;
   using dummy_type = typeof(dummy);
+  auto identity = [] (dummy_type&) { };
   auto join = [] (dummy_type, dummy_type) { };
-  auto _body = [&] (input_type& in, dummy_type& out) {
-    iterator_type beg = in.first;
-    iterator_type end = in.second;
-    cont.for_each_segment(beg, end, body);
-  };
-  input_type in(cont.begin(), cont.end());
-  native::forkjoin(in, dummy, cutoff, split, join, _body);
+  forkjoin_segments(cont, dummy, identity, join, [&] (iterator_type lo, iterator_type hi, dummy_type&) {
+    cont.for_each_segment(lo, hi, body);
+  });
 }
 
 template <class Container, class Body>
 void for_each(const Container& cont, const Body& body) {
-  using size_type = typename Container::size_type;
   using value_type = typename Container::value_type;
-  using segment_type = typename Container::segment_type;
   for_each_segment(cont, [&] (value_type* lo, value_type* hi) {
-    for (value_type* p = lo; lo < hi; p++)
+    for (value_type* p = lo; p < hi; p++)
       body(*p);
   });
 }
+
+//! Returns `op(... op(op(id, lift(x0)), lift(x1)) ..., lift(xn-1))`, for an associative `op`
+template <class Container, class Result, class Combine, class Lift>
+Result reduce(const Container& cont, Result id, const Combine& op, const Lift& lift) {
+  using value_type = typename Container::value_type;
+  using iterator_type = typename Container::iterator;
+  Result result = id;
+  auto identity = [&] (Result& r) {
+    r = id;
+  };
+  auto join = [&] (Result& r1, Result& r2) {
+    r1 = op(r1, r2);
+  };
+  forkjoin_segments(cont, result, identity, join, [&] (iterator_type lo, iterator_type hi, Result& r) {
+    Result acc = r;
+    cont.for_each_segment(lo, hi, [&] (const value_type* b, const value_type* e) {
+      for (const value_type* p = b; p < e; p++)
+        acc = op(acc, lift(*p));
+    });
+    r = acc;
+  });
+  return result;
+}
+
+template <class Container, class Combine>
+typename Container::value_type reduce(const Container& cont, typename Container::value_type id,
+                                      const Combine& op) {
+  using value_type = typename Container::value_type;
+  return reduce(cont, id, op, [] (const value_type& x) { return x; });
+}
+
+template <class Container, class Pred>
+typename Container::size_type count_if(const Container& cont, const Pred& p) {
+  using size_type = typename Container::size_type;
+  using value_type = typename Container::value_type;
+  auto plus = [] (size_type x, size_type y) { return x + y; };
+  return reduce(cont, size_type(0), plus, [&] (const value_type& x) {
+    return size_type(p(x) ? 1 : 0);
+  });
+}
+
+//! Appends `f(x)` to `dst`, for each item `x` of `src`, in order
+template <class Container_src, class Container_dst, class Func>
+void transform(const Container_src& src, Container_dst& dst, const Func& f) {
+  using cursor_type = segment_cursor<Container_src>;
+  using size_type = typename Container_dst::size_type;
+  using body_type = transform_foreach_body<typename Container_dst::allocator_type,
+                                           cursor_type, Func>;
+  dst.chunkwise_pushn_back(src.size(), [&] (size_type i) {
+    return body_type(cursor_type(src, i), f);
+  }, parallel_chunk_loop<Container_dst>());
+}
+
+//! Appends to `dst` the items of `src` that satisfy `p`, in order
+template <class Container_src, class Container_dst, class Pred>
+void filter(const Container_src& src, Container_dst& dst, const Pred& p) {
+  using cursor_type = segment_cursor<Container_src>;
+  using value_type = typename Container_src::value_type;
+  using size_type = typename Container_dst::size_type;
+  using body_type = filter_foreach_body<typename Container_dst::allocator_type,
+                                        cursor_type, Pred>;
+  size_type n = src.size();
+  // the items are counted by blocks of the size of the chunks of `dst`
+  size_type cap = size_type(Container_dst::chunk_capacity);
+  long nb_blocks = long((n + cap - 1) / cap);
+  // kept[k]: number of items kept before block k
+  std::vector<size_type> kept(nb_blocks + 1, 0);
+  native::parallel_for1(0l, nb_blocks, [&] (long k) {
+    size_type lo = size_type(k) * cap;
+    size_type hi = std::min(n, lo + cap);
+    size_type nb = 0;
+    src.for_each_segment(src.begin() + lo, src.begin() + hi, [&] (const value_type* b, const value_type* e) {
+      for (const value_type* q = b; q < e; q++)
+        nb += p(*q) ? 1 : 0;
+    });
+    kept[k + 1] = nb;
+  });
+  for (long k = 0; k < nb_blocks; k++)
+    kept[k + 1] += kept[k];
+  dst.chunkwise_pushn_back(kept[nb_blocks], [&] (size_type i) {
+    // positions the cursor on the item of `src` that is kept `i`-th
+    long k = long(std::upper_bound(kept.begin(), kept.end(), i) - kept.begin()) - 1;
+    cursor_type cursor(src, size_type(k) * cap);
+    for (size_type r = i - kept[k]; r > 0; )
+      if (p(*cursor.next()))
+        r--;
+    return body_type(cursor, p);
+  }, parallel_chunk_loop<Container_dst>());
+}
+
+template <bool Inclusive, class Container_src, class Container_dst, class Combine>
+void scan(const Container_src& src, Container_dst& dst,
+          typename Container_dst::value_type id, const Combine& op) {
+  using cursor_type = segment_cursor<Container_src>;
+  using value_type = typename Container_dst::value_type;
+  using size_type = typename Container_dst::size_type;
+  using body_type = scan_foreach_body<typename Container_dst::allocator_type,
+                                      cursor_type, Combine, Inclusive>;
+  size_type n = src.size();
+  if (n == 0)
+    return;
+  // the partial sums are taken by chunks of `dst`
+  size_type cap = size_type(Container_dst::chunk_capacity);
+  long nb_chunks = long((n + cap - 1) / cap);
+  std::vector<value_type> prefix(nb_chunks + 1, id);
+  native::parallel_for1(0l, nb_chunks, [&] (long k) {
+    size_type lo = size_type(k) * cap;
+    size_type hi = std::min(n, lo + cap);
+    cursor_type cursor(src, lo);
+    value_type acc = id;
+    for (size_type i = lo; i < hi; i++)
+      acc = op(acc, *cursor.next());
+    prefix[k + 1] = acc;
+  });
+  for (long k = 0; k < nb_chunks; k++)
+    prefix[k + 1] = op(prefix[k], prefix[k + 1]);
+  dst.chunkwise_pushn_back(n, [&] (size_type i) {
+    return body_type(cursor_type(src, i), prefix[i / cap], op);
+  }, parallel_chunk_loop<Container_dst>());
+}
+
+//! Appends to `dst` the items `op(... op(id, x0) ..., xi)` of `src`
+template <class Container_src, class Container_dst, class Combine>
+void inclusive_scan(const Container_src& src, Container_dst& dst,
+                    typename Container_dst::value_type id, const Combine& op) {
+  scan<true>(src, dst, id, op);
+}
+
+//! Appends to `dst` the items `op(... op(id, x0) ..., xi-1)` of `src`
+template <class Container_src, class Container_dst, class Combine>
+void exclusive_scan(const Container_src& src, Container_dst& dst,
+                    typename Container_dst::value_type id, const Combine& op) {
+  scan<false>(src, dst, id, op);
+}
   
 template <class Item, class Body>
 void for_each(const stl::deque_seq<Item>& cont, const Body& body) {
@@ -110,6 +396,27 @@ void combine(Number lo, Number hi, Container& dst, const Body& body,
   native::combine(lo, hi, dst, join, body, cutoff);
 }
 
+/* Appends to `dst` the `n` items `body(0), ..., body(n-1)`; the chunks
+ * that receive the items are filled in parallel, then linked in the
+ * middle sequence of `dst`, one push per chunk. */
+template <class Container, class Body>
+void tabulate(typename Container::size_type n, Container& dst, const Body& body) {
+  using size_type = typename Container::size_type;
+  auto loop = [] (size_type nb_chunks, const std::function<void (size_type)>& fill) {
+    native::parallel_for1(size_type(0), nb_chunks, fill);
+  };
+  dst.tabulate_pushn_back(n, body, loop);
+}
+
+//! Appends to `dst` the items of the random-access range `[first, last)`
+template <class Container, class Iter>
+void from_range(Iter first, Iter last, Container& dst) {
+  using size_type = typename Container::size_type;
+  tabulate((size_type)(last - first), dst, [first] (size_type i) {
+    return first[i];
+  });
+}
+
 template <class Container_src, class Pointer>
 void transfer_contents_to_array(Container_src& src, Pointer dst) {
   using size_type = typename Container_src::size_type;
@@ -8,6 +8,7 @@
 
 #include <time.h>
 #include <sys/time.h>
+#include <algorithm>
 
 #include "worker.hpp"
 #include "machine.hpp"
@@ -31,6 +32,7 @@ static bool interrupts;
 
 group_t::group_t() {
   state = NOT_INIT;
+  parked = NULL;
 }
 
 void group_t::set_factory(controller_factory_p factory) {
@@ -43,6 +45,7 @@ void group_t::init(int nb_workers, machine::binding_policy_p bindpolicy) {
   state = PASSIVE;
   factory = NULL;
   controllers = new controller_p[nb_workers];
+  nb_active.store(nb_workers);
   tls_alloc(worker_id_t, worker_id);
   tls_setter(worker_id_t, worker_id, undef);
   interrupts = cmdline::parse_or_default_bool("interrupts", false, false);
@@ -114,9 +117,20 @@ void controller_t::mysrand(unsigned seed) {
 worker_id_t controller_t::random_other() {
   int nb_workers = get_nb();
   assert(nb_workers > 1);
+  worker_id_t my_id = get_my_id();
   worker_id_t id = (worker_id_t)myrand() % (nb_workers-1);
-  if (id >= get_my_id())
+  if (id >= my_id)
     id++;
+  if (the_group.get_nb_active() == nb_workers)
+    return id;
+  /* Deactivated workers that are still running hold threads that are
+   * worth stealing, so that only the parked ones are skipped. The
+   * number of tries is bounded because all the others may be parked. */
+  for (int nb_tries = 0; nb_tries < nb_workers && the_group.is_parked(id); nb_tries++) {
+    id = (worker_id_t)myrand() % (nb_workers-1);
+    if (id >= my_id)
+      id++;
+  }
   return id;
 }
     
@@ -256,16 +270,30 @@ void controller_t::rem_periodic(periodic_p p) {
   periodic_set.erase(iter);
 }
 
+void controller_t::add_background(periodic_p p) {
+  assert(my_id != undef);
+  background_set.push_back(p);
+}
+
+void controller_t::rem_background(periodic_p p) {
+  periodic_set_t::iterator iter =
+    std::find(background_set.begin(), background_set.end(), p);
+  if (iter == background_set.end())
+    atomic::die("failed to remove background check\n");
+  background_set.erase(iter);
+}
+
 void controller_t::check_periodic() {
   double delay = ticks::microseconds_since(last_check_periodic);
   if (delay > delta) { 
     last_check_periodic = ticks::now();
-    for (periodic_set_t::iterator iter = periodic_set.begin();
-         iter < periodic_set.end();
-         iter++) {
-      periodic_p p = *iter;
+    // a check may remove itself from the set, which invalidates iterators
+    for (size_t i = 0; i < periodic_set.size(); i++) {
+      periodic_p p = periodic_set[i];
       p->check();
     }
+    for (size_t i = 0; i < background_set.size(); i++)
+      background_set[i]->check();
   }
 }
   
@@ -307,6 +335,37 @@ worker_id_t group_t::get_my_id_or_undef() {
   }
 }
 
+/*---------------------------------------------------------------------*/
+/* Elastic worker count */
+
+void group_t::set_nb_active(int nb) {
+  nb = std::max(1, std::min(nb, nb_workers));
+  nb_active.store(nb);
+  resized.notify_all();
+}
+
+int group_t::get_nb_parked() const {
+  int nb = 0;
+  for (worker_id_t id = 0; id < nb_workers; id++)
+    if (is_parked(id))
+      nb++;
+  return nb;
+}
+
+void group_t::park_while_inactive(worker_id_t id) {
+  parked[id].store(true);
+  while (! is_active_worker(id) && ! all_workers_should_exit) {
+    int key = resized.prepare_wait();
+    if (is_active_worker(id) || all_workers_should_exit) {
+      resized.cancel_wait();
+      break;
+    }
+    // the timeout is a safety net; wakeups come from `set_nb_active()`
+    resized.commit_wait(key, 1000000.);
+  }
+  parked[id].store(false);
+}
+
 /*---------------------------------------------------------------------*/
 
 bool group_t::exit_controller() {
@@ -349,10 +408,10 @@ void* group_t::build_thread(void* arg) {
   group->controllers[my_id] = controller;
   if (my_id != 0) {
     controller->init();
-    group->creation_barrier.wait();
+    group->creation_barrier.wait(my_id);
     controller->run();
     controller->destroy();
-    group->destruction_barrier.wait();
+    group->destruction_barrier.wait(my_id);
   }
   return NULL;
 }
@@ -364,6 +423,11 @@ void group_t::create_threads() {
   assert(factory != NULL);
   state = ACTIVE;
   all_workers_should_exit = false;
+  nb_active.store(nb_workers);
+  parked = new std::atomic<bool>[nb_workers];
+  for (worker_id_t id = 0; id < nb_workers; id++)
+    parked[id].store(false);
+  resized.init();
   factory->create_shared_state();
   pthreads = new pthread_t[nb_workers];
   creation_barrier.init(nb_workers);
@@ -381,7 +445,7 @@ void group_t::create_threads() {
   worker0_init->first = 0;
   worker0_init->second = this;
   build_thread(worker0_init);
-  creation_barrier.wait();
+  creation_barrier.wait(0);
   controllers[0]->init();
 #ifndef DISABLE_INTERRUPTS
   ping_loop_create();
@@ -391,17 +455,21 @@ void group_t::create_threads() {
 void group_t::destroy_threads() {
   assert(state == ACTIVE);
   all_workers_should_exit = true;
+  // release the workers that are parked, so that they can exit
+  resized.notify_all();
 #ifndef DISABLE_INTERRUPTS
   ping_loop_destroy();
 #endif
   controllers[0]->destroy();
-  destruction_barrier.wait();
+  destruction_barrier.wait(0);
   factory->delete_shared_state();
   delete [] pthreads;
   for (worker_id_t id = 0; id < nb_workers; id++) {
     factory->destroy_controller(controllers[id]);
   }
   delete [] controllers;
+  delete [] parked;
+  parked = NULL;
   state = PASSIVE;
 }
 
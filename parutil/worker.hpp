@@ -11,6 +11,7 @@
 #define _PASL_UTIL_WORKER_H_
 
 #include <assert.h>
+#include <atomic>
 #include <deque>
 #include <signal.h>
 #include <cstdlib>
@@ -22,6 +23,7 @@
 #include "tls.hpp"
 #include "aliases.hpp"
 #include "machine.hpp"
+#include "futex.hpp"
 
 namespace pasl {
 namespace util {
@@ -78,6 +80,11 @@ extern double delta;
  * of a set of tasks, etc. As such, in order to ensure progress of the 
  * program, subclass of this signature must regularly run the checks. A
  * subclass can run all the checks by calling `check_periodic()`.
+ *
+ * Background checks run along with the periodic checks, but, unlike
+ * them, do not keep the worker from exiting or parking. They serve
+ * services that are up for the whole lifetime of the worker, such as
+ * the delivery of messages.
  */
 class controller_t {
 protected:
@@ -126,6 +133,10 @@ public:
   /*! \brief Returns an id chosen uniformly at random from the set of
    * worker ids, excluding the id of this worker. Return result is
    * undefined if `nb_workers == 1`.
+   *
+   * Workers that are parked because they were deactivated (see
+   * `group_t::set_nb_active()`) are skipped, except when no other
+   * worker is left to choose from.
    */
   worker_id_t random_other();
   ///@}
@@ -136,12 +147,17 @@ protected:
   ticks_t last_check_periodic;
   typedef std::deque<periodic_p> periodic_set_t;
   periodic_set_t periodic_set;  
+  periodic_set_t background_set;
   
 public:  
   /*! \brief Adds to the set of periodic checks the check `p`. */
   void add_periodic(periodic_p p);
   /*! \brief Removes from the set of periodic checks the check `p`. */
   void rem_periodic(periodic_p p);
+  /*! \brief Adds to the set of background checks the check `p`. */
+  void add_background(periodic_p p);
+  /*! \brief Removes from the set of background checks the check `p`. */
+  void rem_background(periodic_p p);
   /*! \brief Runs all the checks in the set of periodic checks.
    *  \warning May be called asynchronously by the worker's signal
    *   handler.
@@ -257,6 +273,50 @@ public:
       body(i);
   }
 
+  /** @name Elastic worker count
+   *
+   * Only the workers whose id is below `get_nb_active()` are active.
+   * A deactivated worker finishes or gives away the threads that it
+   * holds, like any other worker, and then parks in
+   * `park_while_inactive()` instead of looking for more work. Worker
+   * ids and per-worker storage are unaffected, so that a parked worker
+   * resumes where it stopped when it is activated again.
+   */
+  ///@{
+protected:
+  std::atomic<int>        nb_active;
+  std::atomic<bool>*      parked;         // one flag per worker
+  futex::eventcount       resized;
+public:
+  /*! \brief Sets the number of active workers to `nb`, clamped to
+   *  `[1, get_nb()]`; worker 0 always stays active.
+   *
+   * Thread safe; may be called by any OS thread while the workers run.
+   * Returns without waiting for the workers to park or wake up.
+   */
+  void set_nb_active(int nb);
+  //! Returns the number of active workers
+  int get_nb_active() const {
+    return nb_active.load(std::memory_order_relaxed);
+  }
+  bool is_active_worker(worker_id_t id) const {
+    return id < get_nb_active();
+  }
+  //! Returns true if the worker `id` is parked by `park_while_inactive()`
+  bool is_parked(worker_id_t id) const {
+    return parked[id].load(std::memory_order_relaxed);
+  }
+  //! Returns the number of workers that are parked
+  int get_nb_parked() const;
+  /*! \brief Blocks the calling worker as long as it is deactivated and
+   *  the group is not exiting.
+   *
+   * The caller must have withdrawn from its scheduler beforehand, so
+   * that no other worker waits on it while it is parked.
+   */
+  void park_while_inactive(worker_id_t id);
+  ///@}
+
   /** @name Interrupts */
   ///@{
 protected:
@@ -11,7 +11,10 @@
 #define _PASL_DATA_PERWORKER_H_
 
 #include <assert.h>
+#include <algorithm>
+#include <atomic>
 #include <initializer_list>
+#include <new>
 
 #include "callback.hpp"
 #include "worker.hpp"
@@ -54,8 +57,20 @@ static constexpr int default_max_nb_workers = 128;
  * crucial to avoid false sharing on frequent writes to the
  * cells of the container.
  *
- * Access to this container is not synchronized. Thread safety must
- * be enforced by the clients of the container.
+ * The storage of the cells is allocated on demand, by the first access
+ * to a cell that does not exist yet, and at least for each worker of
+ * the group: the footprint of the container follows the number of
+ * workers, and not `max_nb_workers`. The cells of the workers that
+ * share a NUMA node are stored together, in a block that is placed on
+ * that node (see `util::machine::alloc_near_worker()`). The allocation
+ * does not write to the block: each cell is value initialized by the
+ * first access to it, which, for the cells that are accessed by
+ * `mine()`, is made by the worker that owns the cell. Cells never move
+ * once they are initialized.
+ *
+ * Access to the items is not synchronized. Thread safety must be
+ * enforced by the clients of the container. The allocation and the
+ * initialization of the cells are thread safe.
  *
  */
 template <class Item,
@@ -75,7 +90,14 @@ private:
   } contents_type;
   
   int padding[padding_szb/4];
-  __attribute__ ((aligned (64))) contents_type contents[max_nb_workers];
+  // cells[id]: the cell of worker `id`, once it is initialized
+  __attribute__ ((aligned (64))) mutable std::atomic<contents_type*> cells[max_nb_workers];
+  // slots[id]: the storage of the cell of worker `id`, once it is allocated
+  mutable contents_type* slots[max_nb_workers];
+  // the blocks that hold the storage, at most one for each node
+  mutable void* blocks[max_nb_workers];
+  mutable int nb_blocks;
+  mutable std::atomic<bool> growing;
   
   void check_index(index_type id) const {
     assert(id >= 0);
@@ -83,20 +105,100 @@ private:
     util::worker::the_group.check_worker_id(worker_id_t(id));
   }
   
+  // Allocates the storage of the workers in [first, nb) that share the node of worker `first`
+  void alloc_block(index_type first, int nb) const {
+    util::machine::node_id_t node = util::machine::home_node_of_worker(first);
+    int n = 0;
+    for (index_type id = first; id < nb; id++)
+      if (slots[id] == NULL && util::machine::home_node_of_worker(id) == node)
+        n++;
+    // the padding in front of the first cell keeps it off the cache line of the block header
+    size_t szb = padding_szb + n * sizeof(contents_type);
+    char* b = (char*)util::machine::alloc_near_worker(first, szb, false);
+    blocks[nb_blocks++] = b;
+    contents_type* c = (contents_type*)(b + padding_szb);
+    for (index_type id = first; id < nb; id++) {
+      if (slots[id] == NULL && util::machine::home_node_of_worker(id) == node) {
+        slots[id] = c;
+        c++;
+      }
+    }
+  }
+  
+  // Slow path of `cell_of`: allocates storage for at least all the workers, and initializes the cell of `id`
+  __attribute__ ((noinline)) contents_type* make_cell(index_type id) const {
+    int nb = std::max(int(id) + 1, int(util::worker::get_nb()));
+    if (nb > max_nb_workers)
+      util::atomic::die("perworker: worker id out of range of the container\n");
+    while (growing.exchange(true))
+      ;
+    contents_type* c = cells[id].load();
+    if (c == NULL) {
+      for (index_type i = 0; i < nb; i++)
+        if (slots[i] == NULL)
+          alloc_block(i, nb);
+      c = slots[id];
+      new (&c->item) value_type();
+      cells[id].store(c, std::memory_order_release);
+    }
+    growing.store(false);
+    return c;
+  }
+  
+  contents_type& cell_of(index_type id) const {
+    check_index(id);
+    contents_type* c = cells[id].load(std::memory_order_acquire);
+    if (c == NULL)
+      c = make_cell(id);
+    return *c;
+  }
+  
+  void init_empty() {
+    for (int i = 0; i < max_nb_workers; i++) {
+      cells[i].store(NULL);
+      slots[i] = NULL;
+    }
+    nb_blocks = 0;
+    growing.store(false);
+  }
+  
 public:
   
-  array() { }
+  array() {
+    init_empty();
+  }
   
   array(std::initializer_list<value_type> l) {
+    init_empty();
     if (l.size() != 1)
       util::atomic::fatal([] { std::cout << "perworker given bogus initializer list"; });
     init(*(l.begin()));
   }
   
+  array(const array& other) {
+    init_empty();
+    *this = other;
+  }
+  
+  array& operator=(const array& other) {
+    if (this != &other)
+      for (index_type id = 0; id < max_nb_workers; id++)
+        if (other.cells[id].load() != NULL)
+          (*this)[id] = other.cells[id].load()->item;
+    return *this;
+  }
+  
+  ~array() {
+    for (index_type id = 0; id < max_nb_workers; id++)
+      if (cells[id].load() != NULL)
+        cells[id].load()->item.~value_type();
+    for (int i = 0; i < nb_blocks; i++)
+      util::machine::free_near_worker(blocks[i]);
+  }
+  
   //! \brief Returns reference to the contents of the cell at position `id` in the array
   value_type& operator[](const index_type id) {
-    check_index(id);
-    return contents[id].item;
+    return cell_of(id).item;
   }
   
   //! \brief Returns reference to the contents of the cell at position `id` in the array
@@ -131,7 +233,7 @@ public:
   template <class Body>
   void cfor_each(const Body& body) const {
     auto b = [&] (index_type id) {
-      body(id, contents[id].item);
+      body(id, (const value_type&)cell_of(id).item);
     };
     util::worker::the_group.for_each_worker(b);
   }
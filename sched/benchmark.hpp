@@ -14,9 +14,15 @@
 #include <numa.h>
 #endif
 
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
 #include "pcmdline.hpp"
 #include "threaddag.hpp"
 #include "native.hpp"
+#include "hwcounters.hpp"
 
 #ifndef _PASL_BENCHMARK_H_
 #define _PASL_BENCHMARK_H_
@@ -49,9 +55,185 @@ void launch(const Body& body) {
 #endif
 }
 
+/*---------------------------------------------------------------------*/
+/* Speedup-curve driver */
+
+namespace sweep {
+
+//! Measurements at one worker count
+typedef struct {
+  int proc;
+  std::vector<double> runs; // seconds
+  double median;
+  double p95;
+  double mean;
+  double ci95_low;
+  double ci95_high;
+  double speedup;
+  double efficiency;
+} point_t;
+
+//! Parses a comma-separated list of worker counts
+static inline std::vector<int> procs_of_string(std::string s) {
+  std::vector<int> procs;
+  size_t start = 0;
+  while (start < s.size()) {
+    size_t end = s.find(',', start);
+    if (end == std::string::npos)
+      end = s.size();
+    int p = atoi(s.substr(start, end - start).c_str());
+    if (p < 1)
+      util::atomic::die("bogus worker count in -sweep_proc %s\n", s.c_str());
+    procs.push_back(p);
+    start = end + 1;
+  }
+  if (procs.empty())
+    util::atomic::die("empty -sweep_proc\n");
+  return procs;
+}
+
+//! Two-sided 95% quantile of the Student t distribution
+static inline double student_t95(int df) {
+  static const double table[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+  if (df < 1)
+    return 0.;
+  return (df <= 30) ? table[df - 1] : 1.960;
+}
+
+static inline void summarize(point_t& pt) {
+  std::vector<double> sorted = pt.runs;
+  std::sort(sorted.begin(), sorted.end());
+  size_t n = sorted.size();
+  pt.median = (n % 2 == 1) ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2.;
+  pt.p95 = sorted[(size_t)std::ceil(0.95 * n) - 1];
+  double sum = 0.;
+  for (double t : sorted)
+    sum += t;
+  pt.mean = sum / n;
+  double var = 0.;
+  for (double t : sorted)
+    var += (t - pt.mean) * (t - pt.mean);
+  double half_width = 0.;
+  if (n > 1)
+    half_width = student_t95((int)n - 1) * std::sqrt(var / (n - 1)) / std::sqrt((double)n);
+  pt.ci95_low = pt.mean - half_width;
+  pt.ci95_high = pt.mean + half_width;
+}
+
+static inline void print_json(FILE* f, std::vector<point_t>& points) {
+  fprintf(f, "{\n  \"benchmark\": \"%s\",\n  \"points\": [\n",
+          util::cmdline::name_of_my_executable().c_str());
+  for (size_t i = 0; i < points.size(); i++) {
+    point_t& pt = points[i];
+    fprintf(f, "    { \"proc\": %d, \"runs\": [", pt.proc);
+    for (size_t k = 0; k < pt.runs.size(); k++)
+      fprintf(f, "%s%.6lf", (k == 0) ? "" : ", ", pt.runs[k]);
+    fprintf(f, "], \"median\": %.6lf, \"p95\": %.6lf, \"mean\": %.6lf, "
+            "\"ci95_low\": %.6lf, \"ci95_high\": %.6lf, "
+            "\"speedup\": %.4lf, \"efficiency\": %.4lf }%s\n",
+            pt.median, pt.p95, pt.mean, pt.ci95_low, pt.ci95_high,
+            pt.speedup, pt.efficiency, (i + 1 == points.size()) ? "" : ",");
+  }
+  fprintf(f, "  ]\n}\n");
+}
+
+static inline void print_csv(FILE* f, std::vector<point_t>& points) {
+  fprintf(f, "proc,nb_runs,median,p95,mean,ci95_low,ci95_high,speedup,efficiency\n");
+  for (point_t& pt : points)
+    fprintf(f, "%d,%d,%.6lf,%.6lf,%.6lf,%.6lf,%.6lf,%.4lf,%.4lf\n",
+            pt.proc, (int)pt.runs.size(), pt.median, pt.p95, pt.mean,
+            pt.ci95_low, pt.ci95_high, pt.speedup, pt.efficiency);
+}
+
+} // end namespace
+
+/*! \brief Runs `init` once, then `run` repeatedly, for each worker
+ *  count of a list, and reports a speedup curve
+ *
+ * The worker group is torn down and created again for each worker
+ * count, but the input that `init` builds is kept: `run` must thus
+ * leave the input as it finds it. `output` and `destroy` run once, at
+ * the end.
+ *
+ * Command-line parameters:
+ *   - `-sweep_proc <list>`: comma-separated worker counts, e.g. `1,2,4`
+ *   - `-warmup <int>` (default=1): untimed runs for each worker count
+ *   - `-repeat <int>` (default=5): timed runs for each worker count
+ *   - `-sweep_format json|csv` (default=json)
+ *   - `-sweep_output <file>` (default: standard output)
+ *
+ * For each worker count, the report gives the median, the 95th
+ * percentile, the mean with its 95% confidence interval (Student t),
+ * and the speedup and parallel efficiency with respect to the median
+ * at the first worker count of the list.
+ */
+template <class Init, class Run, class Output, class Destroy>
+void launch_sweep(const Init& init, const Run& run, const Output& output,
+                  const Destroy& destroy) {
+  std::vector<int> procs =
+    sweep::procs_of_string(util::cmdline::parse_string("sweep_proc"));
+  int nb_warmup = util::cmdline::parse_or_default_int("warmup", 1);
+  int nb_repeat = std::max(1, util::cmdline::parse_or_default_int("repeat", 5));
+  std::string format = util::cmdline::parse_or_default_string("sweep_format", "json");
+  std::string path = util::cmdline::parse_or_default_string("sweep_output", "");
+  std::vector<sweep::point_t> points;
+  for (size_t i = 0; i < procs.size(); i++) {
+    if (i > 0)
+      threaddag::destroy();
+    util::cmdline::set_override("proc", std::to_string(procs[i]));
+    threaddag::init();
+    if (i == 0)
+      launch(init);
+    sweep::point_t pt;
+    pt.proc = procs[i];
+    for (int k = 0; k < nb_warmup; k++)
+      launch([&] { run(false); });
+    for (int k = 0; k < nb_repeat; k++) {
+      uint64_t start_time = util::microtime::now();
+      launch([&] { run(false); });
+      pt.runs.push_back(util::microtime::seconds_since(start_time));
+    }
+    sweep::summarize(pt);
+    points.push_back(pt);
+  }
+  for (sweep::point_t& pt : points) {
+    pt.speedup = points[0].median / pt.median;
+    pt.efficiency = pt.speedup * points[0].proc / pt.proc;
+  }
+  FILE* f = (path == "") ? stdout : fopen(path.c_str(), "w");
+  if (f == NULL)
+    util::atomic::die("failed to open %s\n", path.c_str());
+  if (format == "json")
+    sweep::print_json(f, points);
+  else if (format == "csv")
+    sweep::print_csv(f, points);
+  else
+    util::atomic::die("bogus sweep_format %s\n", format.c_str());
+  if (f != stdout)
+    fclose(f);
+  launch(output);
+  launch(destroy);
+  threaddag::destroy();
+  util::cmdline::clear_override("proc");
+}
+
+/*---------------------------------------------------------------------*/
+
+/*! \brief Runs `init`, then `run` once, then `output` and `destroy`
+ *
+ * With `-sweep_proc`, runs the speedup-curve driver instead (see
+ * `launch_sweep`).
+ */
 template <class Init, class Run, class Output, class Destroy>
 void launch(const Init& init, const Run& run, const Output& output,
             const Destroy& destroy) {
+  if (util::cmdline::parse_or_default_string("sweep_proc", "", false) != "") {
+    launch_sweep(init, run, output, destroy);
+    return;
+  }
   bool sequential = (util::cmdline::parse_or_default_int("proc", 1, false) == 0);
   bool report_time = util::cmdline::parse_or_default_bool("report_time", true, false);
 #ifdef USE_LIBNUMA
@@ -60,14 +242,17 @@ void launch(const Init& init, const Run& run, const Output& output,
   threaddag::init();
   launch(init);
   LOG_BASIC(ENTER_ALGO);
+  util::hwcounters::enter_algo();
   uint64_t start_time = util::microtime::now();
   launch([&] { run(sequential); });
   double exec_time = util::microtime::seconds_since(start_time);
+  util::hwcounters::exit_algo();
   LOG_BASIC(EXIT_ALGO);
   if (report_time)
     printf ("exectime %.3lf\n", exec_time);
   STAT_IDLE(sum());
   STAT(dump(stdout));
+  util::hwcounters::dump(stdout);
   STAT_IDLE(print_idle(stdout));
 #ifdef DUMP_JEMALLOC_STATS
   // Dump allocator statistics to stderr.
@@ -0,0 +1,79 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file cancellation.hpp
+ * \brief Cancellation tokens for subtrees of threads
+ *
+ */
+
+#include <atomic>
+
+#ifndef _PASL_SCHED_CANCELLATION_H_
+#define _PASL_SCHED_CANCELLATION_H_
+
+/***********************************************************************/
+
+namespace pasl {
+namespace sched {
+namespace cancellation {
+
+/*---------------------------------------------------------------------*/
+
+/*! \class token
+ *  \brief Flag shared by all the threads of a cancellable subtree
+ *
+ * A thread carries a pointer to the token of the innermost cancellable
+ * scope in which it was created (see `thread::cancel_token`). Tokens
+ * nest: a token reads as cancelled as soon as it, or the token of an
+ * enclosing scope, is cancelled.
+ *
+ * The scheduler drops the threads whose token is cancelled and whose
+ * body has not started yet; it still runs their outstrategy, so that
+ * the join counters of the subtree stay consistent. Threads that have
+ * started run to completion, unless they poll `is_cancelled()`.
+ */
+class token {
+private:
+
+  std::atomic<bool> cancelled;
+
+public:
+
+  //! token of the enclosing scope, or null
+  token* const parent;
+
+  token(token* parent = nullptr)
+  : cancelled(false), parent(parent) { }
+
+  void cancel() {
+    cancelled.store(true);
+  }
+
+  //! True if this token has been cancelled, excluding its ancestors
+  bool is_cancelled_here() const {
+    return cancelled.load(std::memory_order_relaxed);
+  }
+
+  /*! \brief True if this token or one of its ancestors has been
+   * cancelled
+   *
+   * Costs one relaxed load per level of nesting, which is cheap
+   * enough to be polled in inner loops.
+   */
+  bool is_cancelled() const {
+    for (const token* t = this; t != nullptr; t = t->parent)
+      if (t->is_cancelled_here())
+        return true;
+    return false;
+  }
+
+};
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_SCHED_CANCELLATION_H_ */
@@ -139,6 +139,13 @@ namespace scheduler {
     virtual void reject() { }
     virtual void unblock() { }
 
+    /*! Returns true at most once per period of the heartbeat, and
+     *  always false when heartbeat mode is disabled
+     */
+    virtual bool heartbeat() {
+      return false;
+    }
+
     ///@}
     
   };
@@ -0,0 +1,344 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file hwcounters.cpp
+ *
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#ifdef TARGET_LINUX
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "hwcounters.hpp"
+#include "pcmdline.hpp"
+#include "workerlocal.hpp"
+
+namespace pasl {
+namespace util {
+namespace hwcounters {
+
+/***********************************************************************/
+
+bool enabled = false;
+
+static constexpr int nb_events = 4;
+
+typedef struct {
+  const char* name;
+  uint32_t type;
+  uint64_t config;
+} event_desc_t;
+
+#if defined(TARGET_LINUX) && defined(TARGET_X86_64)
+#define HWCOUNTERS_RDPMC
+#endif
+
+#ifdef TARGET_LINUX
+static const event_desc_t hardware_events[nb_events] = {
+  { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+  { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+  { "llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+  { "dtlb_misses", PERF_TYPE_HW_CACHE,
+    PERF_COUNT_HW_CACHE_DTLB
+    | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) }
+};
+
+static const event_desc_t software_events[nb_events] = {
+  { "cpu_clock_ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK },
+  { "task_clock_ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+  { "page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+  { "context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES }
+};
+#endif
+
+// the events in use: `hardware_events` or `software_events`
+static const event_desc_t* events = NULL;
+
+typedef uint64_t counts_t[NB_PHASES][nb_events];
+
+/* State of the counters of one worker. The worker is the only writer;
+ * the main thread reads the state at the edges of the window. The
+ * worker makes `seq` odd while it updates the state, so that the main
+ * thread can tell a torn read and try again (see `snapshot()`). */
+typedef struct {
+  std::atomic<uint64_t> seq;
+  bool is_open;
+  int leader_fd;
+  // slot[k]: position of event k in the group, or -1 if it is unavailable
+  int slot[nb_events];
+  // fds[k], pages[k]: descriptor of event k, and its mapped user page
+  int fds[nb_events];
+  void* pages[nb_events];
+  phase_t phase;
+  uint64_t phase_start[nb_events];
+  counts_t by_phase;
+} worker_counters_t;
+
+static data::perworker::array<worker_counters_t> counters;
+
+static counts_t window_start;
+static counts_t window_end;
+
+static inline void begin_update(worker_counters_t& w) {
+  w.seq.store(w.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+static inline void end_update(worker_counters_t& w) {
+  w.seq.store(w.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/*---------------------------------------------------------------------*/
+/* System interface */
+
+#ifdef TARGET_LINUX
+static int open_event(const event_desc_t& e, int group_fd) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = e.type;
+  attr.config = e.config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+static void read_counts(const worker_counters_t& w, uint64_t* dst) {
+  for (int k = 0; k < nb_events; k++)
+    dst[k] = 0;
+  if (! w.is_open || w.leader_fd < 0)
+    return;
+  struct {
+    uint64_t nr;
+    uint64_t values[nb_events];
+  } buf;
+  if (read(w.leader_fd, &buf, sizeof(buf)) <= 0)
+    return;
+  for (int k = 0; k < nb_events; k++)
+    if (w.slot[k] >= 0 && (uint64_t)w.slot[k] < buf.nr)
+      dst[k] = buf.values[w.slot[k]];
+}
+
+/* Reads the counts of the calling worker by `rdpmc`, through the user
+ * pages of its events, which saves the system call of `read_counts()`.
+ * Returns false if an event cannot be read this way at the moment,
+ * e.g., a software event, or a hardware event that the kernel does not
+ * expose to user space, or that is not scheduled on a counter. */
+#ifdef HWCOUNTERS_RDPMC
+static inline uint64_t rdpmc(uint32_t counter) {
+  uint32_t lo, hi;
+  __asm__ __volatile__("rdpmc" : "=a" (lo), "=d" (hi) : "c" (counter));
+  return (uint64_t)lo | ((uint64_t)hi << 32);
+}
+
+static bool read_count_by_rdpmc(void* page, uint64_t& dst) {
+  volatile struct perf_event_mmap_page* pc = (struct perf_event_mmap_page*)page;
+  uint32_t seq;
+  uint64_t count;
+  do {
+    seq = pc->lock;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    uint32_t index = pc->index;
+    if (! pc->cap_user_rdpmc || index == 0)
+      return false;
+    int64_t pmc = (int64_t)rdpmc(index - 1);
+    int shift = 64 - pc->pmc_width;
+    pmc = (pmc << shift) >> shift;
+    count = pc->offset + pmc;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+  } while (pc->lock != seq);
+  dst = count;
+  return true;
+}
+#endif
+
+static void read_my_counts(const worker_counters_t& w, uint64_t* dst) {
+#ifdef HWCOUNTERS_RDPMC
+  bool ok = w.is_open;
+  for (int k = 0; ok && k < nb_events; k++)
+    if (w.slot[k] < 0)
+      dst[k] = 0;
+    else
+      ok = w.pages[k] != NULL && read_count_by_rdpmc(w.pages[k], dst[k]);
+  if (ok)
+    return;
+#endif
+  read_counts(w, dst);
+}
+
+/*---------------------------------------------------------------------*/
+
+void init() {
+  enabled = false;
+  if (! cmdline::parse_or_default_bool("hwcounters", false, false))
+    return;
+#ifdef TARGET_LINUX
+  const event_desc_t* candidates[2] = { hardware_events, software_events };
+  for (int i = 0; i < 2 && events == NULL; i++) {
+    int fd = open_event(candidates[i][0], -1);
+    if (fd >= 0) {
+      close(fd);
+      events = candidates[i];
+    }
+  }
+#endif
+  if (events == NULL) {
+    printf("Warning: hwcounters: the kernel refuses performance events\n");
+    return;
+  }
+  enabled = true;
+  memset(window_start, 0, sizeof(counts_t));
+  memset(window_end, 0, sizeof(counts_t));
+}
+
+void destroy() {
+  enabled = false;
+}
+
+void open_mine() {
+  if (! enabled)
+    return;
+  worker_counters_t& w = counters.mine();
+  begin_update(w);
+  w.leader_fd = -1;
+  for (int k = 0; k < nb_events; k++) {
+    w.slot[k] = -1;
+    w.fds[k] = -1;
+    w.pages[k] = NULL;
+  }
+#ifdef TARGET_LINUX
+  int nb_open = 0;
+  for (int k = 0; k < nb_events; k++) {
+    int fd = open_event(events[k], w.leader_fd);
+    if (fd < 0)
+      continue;
+    if (w.leader_fd < 0)
+      w.leader_fd = fd;
+    w.slot[k] = nb_open++;
+    w.fds[k] = fd;
+#ifdef HWCOUNTERS_RDPMC
+    void* page = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, fd, 0);
+    if (page != MAP_FAILED)
+      w.pages[k] = page;
+#endif
+  }
+#endif
+  w.phase = PHASE_WORKING;
+  memset(w.by_phase, 0, sizeof(counts_t));
+  w.is_open = true;
+  read_my_counts(w, w.phase_start);
+  end_update(w);
+}
+
+void close_mine() {
+  if (! enabled)
+    return;
+  worker_counters_t& w = counters.mine();
+  begin_update(w);
+  w.is_open = false;
+#ifdef TARGET_LINUX
+  for (int k = 0; k < nb_events; k++) {
+    if (w.pages[k] != NULL)
+      munmap(w.pages[k], sysconf(_SC_PAGESIZE));
+    if (w.fds[k] >= 0)
+      close(w.fds[k]);
+    w.pages[k] = NULL;
+    w.fds[k] = -1;
+  }
+#endif
+  w.leader_fd = -1;
+  end_update(w);
+}
+
+phase_t switch_phase(phase_t p) {
+  worker_counters_t& w = counters.mine();
+  phase_t previous = w.phase;
+  if (p == previous || ! w.is_open)
+    return previous;
+  uint64_t now[nb_events];
+  read_my_counts(w, now);
+  begin_update(w);
+  for (int k = 0; k < nb_events; k++) {
+    w.by_phase[previous][k] += now[k] - w.phase_start[k];
+    w.phase_start[k] = now[k];
+  }
+  w.phase = p;
+  end_update(w);
+  return previous;
+}
+
+/*---------------------------------------------------------------------*/
+
+/* Writes the counts of all the workers, from their start up to now.
+ * The counts of a worker are read after a consistent copy of its
+ * state, and before a check that the worker did not update the state
+ * in between, so that they are no smaller than its `phase_start`. */
+static void snapshot(counts_t dst) {
+  memset(dst, 0, sizeof(counts_t));
+  counters.for_each([&] (worker_id_t, worker_counters_t& w) {
+    worker_counters_t copy;
+    uint64_t now[nb_events];
+    while (true) {
+      uint64_t seq = w.seq.load(std::memory_order_acquire);
+      if (seq % 2 == 1)
+        continue;
+      copy.is_open = w.is_open;
+      copy.leader_fd = w.leader_fd;
+      memcpy(copy.slot, w.slot, sizeof(copy.slot));
+      copy.phase = w.phase;
+      memcpy(copy.phase_start, w.phase_start, sizeof(copy.phase_start));
+      memcpy(copy.by_phase, w.by_phase, sizeof(counts_t));
+      read_counts(copy, now);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (w.seq.load(std::memory_order_relaxed) == seq)
+        break;
+    }
+    for (int p = 0; p < NB_PHASES; p++)
+      for (int k = 0; k < nb_events; k++)
+        dst[p][k] += copy.by_phase[p][k];
+    if (copy.is_open)
+      for (int k = 0; k < nb_events; k++)
+        dst[copy.phase][k] += now[k] - copy.phase_start[k];
+  });
+}
+
+void enter_algo() {
+  if (enabled)
+    snapshot(window_start);
+}
+
+void exit_algo() {
+  if (enabled)
+    snapshot(window_end);
+}
+
+void dump(FILE* f) {
+  if (! enabled)
+    return;
+  for (int k = 0; k < nb_events; k++) {
+    uint64_t total = 0;
+    for (int p = 0; p < NB_PHASES; p++)
+      total += window_end[p][k] - window_start[p][k];
+    fprintf(f, "hw_%s\t%llu\n", events[k].name, (unsigned long long)total);
+  }
+  for (int p = 0; p < NB_PHASES; p++)
+    for (int k = 0; k < nb_events; k++)
+      fprintf(f, "hw_%s_%s\t%llu\n",
+              name_of_phase((phase_t)p).c_str(), events[k].name,
+              (unsigned long long)(window_end[p][k] - window_start[p][k]));
+}
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
@@ -0,0 +1,122 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file hwcounters.hpp
+ * \brief Per-worker hardware performance counters, broken down by
+ * scheduler phase
+ *
+ */
+
+#ifndef _PASL_HWCOUNTERS_H_
+#define _PASL_HWCOUNTERS_H_
+
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+
+namespace pasl {
+namespace util {
+namespace hwcounters {
+
+/***********************************************************************/
+
+/*! \brief Phases of a worker between which the counts are split
+ *
+ * A worker is working unless it is between `enter_wait()` and
+ * `exit_wait()` (waiting, which includes the acquisition of work by
+ * stealing), or in the `communicate()` method of its scheduler
+ * (communicating, which takes precedence over waiting).
+ */
+typedef enum {
+  PHASE_WORKING = 0,
+  PHASE_WAITING,
+  PHASE_COMMUNICATING,
+  NB_PHASES
+} phase_t;
+
+static inline std::string name_of_phase(phase_t p) {
+  switch (p) {
+    case PHASE_WORKING: return std::string("working");
+    case PHASE_WAITING: return std::string("waiting");
+    case PHASE_COMMUNICATING: return std::string("communicating");
+    default: return std::string("unknown");
+  }
+}
+
+//! True if the counters are in use (see `init()`)
+extern bool enabled;
+
+/*---------------------------------------------------------------------*/
+
+/*! \brief Initializes the module
+ *
+ * Command-line parameters:
+ *   - `-hwcounters <bool>` (default=false): turns on the counters
+ *
+ * The counters are cycles, instructions, last-level cache misses and
+ * dTLB load misses, sampled by `perf_event_open`. If the kernel
+ * refuses hardware events (for example, in a virtual machine, or with
+ * a restrictive `perf_event_paranoid`), the module falls back on
+ * software events: CPU clock, task clock, page faults and context
+ * switches. If even those are refused, the module stays disabled and
+ * prints a warning.
+ */
+void init();
+void destroy();
+
+//! Opens the counters of the calling worker
+void open_mine();
+//! Closes the counters of the calling worker
+void close_mine();
+
+/*! \brief Moves the calling worker to phase `p`
+ *  \return the phase that the worker was in
+ *
+ * Reads the counters by `rdpmc` where the kernel allows it, that is,
+ * for hardware events on x86-64; otherwise, costs one system call.
+ */
+phase_t switch_phase(phase_t p);
+
+static inline phase_t enter_phase(phase_t p) {
+  return enabled ? switch_phase(p) : PHASE_WORKING;
+}
+
+static inline void leave_phase(phase_t previous) {
+  if (enabled)
+    switch_phase(previous);
+}
+
+/*! \class phase_scope
+ *  \brief Keeps the calling worker in a phase until the end of the
+ *  scope
+ */
+class phase_scope {
+private:
+  phase_t previous;
+public:
+  phase_scope(phase_t p) : previous(enter_phase(p)) { }
+  ~phase_scope() { leave_phase(previous); }
+};
+
+/*---------------------------------------------------------------------*/
+
+/*! \brief Delimit the window that `dump()` reports on
+ *
+ * To be called by the main thread, while the workers may be running.
+ * The state of each worker is read under a sequence lock, so that the
+ * counts are consistent even if the worker switches phase meanwhile.
+ */
+void enter_algo();
+void exit_algo();
+
+//! Prints the counts of the last window, if the counters are in use
+void dump(FILE* f);
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_HWCOUNTERS_H_ */
@@ -38,7 +38,7 @@ namespace instrategy {
  *
  * \ingroup instrategy
  */
-class signature {
+class signature : public slab::allocated {
 public:
   
   virtual ~signature() { }
@@ -171,10 +171,11 @@ protected:
 
 public:
 
-  message() : counter(0) { }
+  // the forks of a join add their dependencies before `init()`
+  message() : master(util::worker::get_my_id()), counter(0) { }
 
   void init (thread_p t) {
-    master = util::worker::get_my_id();
+    assert(master == util::worker::get_my_id());
     common::init(t);
   }
   
@@ -5,6 +5,10 @@
  * \file logging.cpp
  */
 
+#include <queue>
+#include <unistd.h>
+#include <functional>
+
 #include "logging.hpp"
 #include "pcmdline.hpp"
 
@@ -19,10 +23,6 @@ recorder_t the_recorder;
 /*---------------------------------------------------------------------*/
 // LATER: move
 
-static inline void fwrite_double (FILE* f, double v) {
-  fwrite(&v, sizeof(v), 1, f);
-}
-
 static inline void fwrite_int64 (FILE* f, int64_t v) {
   fwrite(&v, sizeof(v), 1, f);
 }
@@ -30,55 +30,89 @@ static inline void fwrite_int64 (FILE* f, int64_t v) {
 /*---------------------------------------------------------------------*/
 
 
-event_t::event_t() {}
-
-void event_t::print_byte_descr(FILE* f) { }
-
-void event_t::print_text_descr(FILE* f) { }
-
-void event_t::record (microtime_t basetime) {
-  id = (int64_t) worker::get_my_id();
-  time = microtime::now() - basetime; // or (double) ticks::now()
-// TEMP
-/*
-  if (microtime::seconds(time) > 0.01) {
-    output ();
-    atomic::die("interrupted");
-  }
-*/
-    
+void ring_t::init(int64_t nb_words) {
+  int64_t capacity = 1;
+  while (capacity < nb_words)
+    capacity *= 2;
+  words = new int64_t[capacity];
+  mask = capacity - 1;
+  head.store(0);
+  tail.store(0);
+  nb_dropped = 0;
 }
 
-void event_t::print_byte_header (FILE* f) {
-  //fwrite_double (f, time);
-  fwrite_int64 (f, (int64_t) time);
-  fwrite_int64 (f, id);
-  fwrite_int64 (f, get_type());
+void ring_t::destroy() {
+  if (words != NULL)
+    delete [] words;
+  words = NULL;
 }
 
-void event_t::print_byte (FILE* f) { 
-  print_byte_header (f);
-  print_byte_descr (f);
-}
+/*---------------------------------------------------------------------*/
 
-void event_t::print_text_header (FILE* f) {
-  fprintf(f, "%lf\t%d\t%s\t", time, (int)id, get_name().c_str());
+static inline double time_of(const int64_t* record) {
+  return double_of_word(record[0]);
+}
+
+static inline event_type_t type_of(const int64_t* record) {
+  return (event_type_t) (record[1] & 0xffffffffl);
+}
+
+static inline int64_t nb_words_of(const int64_t* record) {
+  return record[1] >> 32;
+}
+
+static void print_text_descr(FILE* f, event_type_t type, const int64_t* w, int64_t n) {
+  switch (type) {
+    case THREAD_FORK:
+      fprintf(f, "%p\t%p\t%p", (void*) w[0], (void*) w[1], (void*) w[2]);
+      break;
+    case LOCALITY_START:
+    case LOCALITY_STOP:
+      fprintf(f, "%ld", (long) w[0]);
+      break;
+    case INTERRUPT:
+      fprintf(f,"%lf\t", double_of_word(w[0]));
+      break;
+    case ESTIM_NAME: {
+      std::string name;
+      for (int64_t i = 0; i < w[1]; i++)
+        name.push_back((char) w[2 + i]);
+      fprintf(f,"%p\t%s\t", (void*) w[0], name.c_str());
+      break;
+    }
+    case ESTIM_REPORT:
+      // warning: order switched
+      fprintf(f,"%p\t%ld\t%lf\t%lf\t", (void*) w[0], (long) w[1],
+              double_of_word(w[3]), double_of_word(w[4]));
+      break;
+    case ESTIM_UPDATE:
+      fprintf(f,"%p\t%lf\t", (void*) w[0], double_of_word(w[1]));
+      break;
+    case ESTIM_PREDICT: {
+      // warning: extra info printed
+      double time = double_of_word(w[2]);
+      double cst = time / w[1];
+      fprintf(f,"%p\t%ld\t                     \t%lf\t%lf\t", (void*) w[0], (long) w[1], cst, time);
+      break;
+    }
+    default:
+      if (n == 1) // thread events
+        fprintf(f, "%p", (void*) w[0]);
+      break;
+  }
 }
 
-void event_t::print_text (FILE* f) { 
-  print_text_header (f);
-  print_text_descr (f); 
+static void print_text(FILE* f, worker_id_t id, const int64_t* record) {
+  event_type_t type = type_of(record);
+  fprintf(f, "%lf\t%d\t%s\t", time_of(record), (int)id, name_of(type).c_str());
+  print_text_descr(f, type, record + record_header_nb_words, nb_words_of(record));
   fprintf (f, "\n");
 }
 
-double event_t::get_time() {
-  return time;
-}
-
 /*---------------------------------------------------------------------*/
 
-
-recorder_t::recorder_t() {
+recorder_t::recorder_t()
+  : byte_file(NULL), text_file(NULL), flusher_running(false) {
 }
 
 recorder_t::~recorder_t() {
@@ -113,9 +147,30 @@ void recorder_t::init() {
   if (pview) {
     tracking[PHASES] = true;
   }
+  int64_t ring_szb = cmdline::parse_or_default_int("log_ring_szb", 1<<22, false);
+  flush_period = cmdline::parse_or_default_double("log_flush_period", 10000., false);
+  for (int id = worker::undef; id < worker::get_nb(); id++)
+    rings_for[id].init(ring_szb / sizeof(int64_t));
+  staged.resize(worker::get_nb() + 1);
+  last_time.assign(worker::get_nb() + 1, 0.);
+  std::string byte_fname = cmdline::parse_or_default_string ("byte_log_file", "LOG_BIN");
+  byte_file = fopen(byte_fname.c_str(), "w");
+  if (text_mode) {
+    std::string text_fname = cmdline::parse_or_default_string ("text_log_file", "LOG");
+    text_file = fopen(text_fname.c_str(), "w");
+  }
+  bool tracking_any = false;
+  for (int k = 0; k < NUM_KIND_IDS; k++)
+    tracking_any = tracking_any || tracking[k];
+  flusher_should_exit.store(false);
+  flusher_running = tracking_any
+    && pthread_create(&flusher, NULL, flusher_loop, this) == 0;
 }
 
 void recorder_t::destroy() {
+  for (int id = worker::undef; id < worker::get_nb(); id++)
+    rings_for[id].destroy();
+  staged.clear();
 }
 
 void recorder_t::set_tracking_all(bool state) {
@@ -123,10 +178,6 @@ void recorder_t::set_tracking_all(bool state) {
     tracking[k] = state;
 }
 
-events_t& recorder_t::get_my_events() {
-  return events_for[worker::the_group.get_my_id_or_undef()];
-}
-
 bool recorder_t::is_tracked_kind(event_kind_t kind) {
   return tracking[kind];
 }
@@ -135,14 +186,32 @@ bool recorder_t::is_tracked(event_type_t type) {
   return tracking[kind_of_type(type)];
 }
 
-void recorder_t::add_nocheck(event_p event) {
-  event->record(basetime);
+void recorder_t::add_record(event_type_t type, const int64_t* payload, int64_t nb_words) {
+  int64_t record[record_header_nb_words + max_payload_nb_words];
+  worker_id_t id = worker::the_group.get_my_id_or_undef();
+  if (id == worker::undef)
+    undef_ring_lock.lock();
+  ring_t& ring = rings_for[id];
+  ring.begin_push();
+  record[0] = word_of_double((double) (microtime::now() - basetime));
+  record[1] = (int64_t) type | (nb_words << 32);
+  for (int64_t i = 0; i < nb_words; i++)
+    record[record_header_nb_words + i] = payload[i];
   if (real_time) {
     atomic::acquire_print_lock();
-    event->print_text(stdout);
+    print_text(stdout, id, record);
     atomic::release_print_lock();
   }
-  get_my_events().push_back (event);
+  ring.push(record, record_header_nb_words + nb_words);
+  if (id == worker::undef)
+    undef_ring_lock.unlock();
+}
+
+void recorder_t::add_nocheck(event_p event) {
+  int64_t payload[max_payload_nb_words];
+  int64_t nb_words = event->encode(payload);
+  add_record(event->get_type(), payload, nb_words);
+  delete event;
 }
 
 void recorder_t::add(event_p event) {
@@ -154,137 +223,176 @@ void recorder_t::add(event_p event) {
   }
 }
 
-static bool event_t_compare_time (event_p e1, event_p e2) {
-  return (e1->get_time() < e2->get_time());
-}
-
-void recorder_t::merge_and_sort() {
-  all_events.clear();
-  for (int id = worker::undef; id < worker::get_nb(); id++) {
-    events_t events = events_for[id];
-    for (std::vector<event_p>::iterator it = events.begin(); it != events.end(); it++)
-      all_events.push_back(*it);
-  }
-  std::stable_sort (all_events.begin(), all_events.end(), event_t_compare_time);
+void recorder_t::add_basic(event_type_t type) {
+  add_record(type, NULL, 0);
 }
 
-void recorder_t::dump_byte_to (FILE* f) {
-  for (std::vector<event_p>::iterator it = all_events.begin(); it != all_events.end(); it++)
-    (*it)->print_byte (f);
+void recorder_t::add_thread(event_type_t type, sched::thread_p thread) {
+  int64_t payload[1] = { (int64_t) thread };
+  add_record(type, payload, 1);
 }
 
-void recorder_t::dump_text_to (FILE* f) {
-  for (std::vector<event_p>::iterator it = all_events.begin(); it != all_events.end(); it++)
-    (*it)->print_text (f);
+void recorder_t::add_thread_fork(event_type_t type, sched::thread_p thread,
+                                 sched::thread_p threadL, sched::thread_p threadR) {
+  int64_t payload[3] = { (int64_t) thread, (int64_t) threadL, (int64_t) threadR };
+  add_record(type, payload, 3);
 }
 
-void recorder_t::dump_byte () {
-  std::string fname = cmdline::parse_or_default_string ("byte_log_file", "LOG_BIN");
-  FILE* f = fopen(fname.c_str(), "w");
-  this->dump_byte_to (f);
-  fclose (f);
+void recorder_t::write_record(worker_id_t id, const int64_t* record) {
+  event_type_t type = type_of(record);
+  fwrite_int64 (byte_file, (int64_t) time_of(record));
+  fwrite_int64 (byte_file, (int64_t) id);
+  fwrite_int64 (byte_file, (int64_t) type);
+  int64_t nb_byte_words = nb_byte_words_of(type, nb_words_of(record));
+  fwrite(record + record_header_nb_words, sizeof(int64_t), nb_byte_words, byte_file);
+  if (text_file != NULL)
+    print_text(text_file, id, record);
 }
 
-void recorder_t::dump_text () {
-  std::string fname = cmdline::parse_or_default_string ("text_log_file", "LOG");
-  FILE* f = fopen(fname.c_str(), "w");
-  this->dump_text_to (f);
-  fclose (f);    
+/* Drains the rings, then writes in time order the records that are
+ * older than `watermark`: the oldest time at which a thread may still
+ * record an event. The records of a ring are in time order, so that
+ * the next event of a ring is no older than its last record. If the
+ * producer of a ring is not recording an event when the flusher checks
+ * it, the next event is also no older than the time that the flusher
+ * read beforehand; otherwise, the bound is the time of the last record
+ * of the ring. When `final` holds, writes all records.
+ */
+void recorder_t::flush(bool final) {
+  double now = (double) (microtime::now() - basetime);
+  double watermark = now;
+  int nb_slots = (int) staged.size();
+  std::vector<size_t> pos(nb_slots, 0);
+  for (int k = 0; k < nb_slots; k++) {
+    std::vector<int64_t>& v = staged[k];
+    size_t nb_before = v.size();
+    ring_t& ring = rings_for[k - 1];
+    bool recording = ring.is_recording();
+    ring.pop_all(v);
+    if (v.size() > nb_before) {
+      // find the last record of the new ones
+      size_t i = nb_before;
+      double t = last_time[k];
+      while (i < v.size()) {
+        t = time_of(&v[i]);
+        i += record_header_nb_words + nb_words_of(&v[i]);
+      }
+      last_time[k] = t;
+    }
+    double bound = recording ? last_time[k] : now;
+    watermark = std::min(watermark, bound);
+  }
+  // k-way merge, by time then by worker id
+  typedef std::pair<double, int> key_type;
+  std::priority_queue<key_type, std::vector<key_type>, std::greater<key_type>> heads;
+  for (int k = 0; k < nb_slots; k++)
+    if (! staged[k].empty())
+      heads.push(key_type(time_of(&staged[k][0]), k));
+  while (! heads.empty()) {
+    key_type top = heads.top();
+    heads.pop();
+    if (! final && top.first >= watermark)
+      break;
+    int k = top.second;
+    const int64_t* record = &staged[k][pos[k]];
+    write_record(k - 1, record);
+    pos[k] += record_header_nb_words + nb_words_of(record);
+    if (pos[k] < staged[k].size())
+      heads.push(key_type(time_of(&staged[k][pos[k]]), k));
+  }
+  for (int k = 0; k < nb_slots; k++)
+    staged[k].erase(staged[k].begin(), staged[k].begin() + pos[k]);
+  fflush(byte_file);
+  if (text_file != NULL)
+    fflush(text_file);
+}
+
+void* recorder_t::flusher_loop(void* arg) {
+  recorder_t* recorder = (recorder_t*) arg;
+  while (! recorder->flusher_should_exit.load()) {
+    usleep((useconds_t) recorder->flush_period);
+    recorder->flush(false);
+  }
+  return NULL;
 }
 
 void recorder_t::output () {
-  merge_and_sort();
-  dump_byte();
-  if (text_mode)
-    dump_text();
-}
-
-/*---------------------------------------------------------------------*/
-
-void thread_event_t::print_byte_descr(FILE* f) {
-  fwrite_int64 (f, (int64_t) thread);
-}
-
-void thread_event_t::print_text_descr(FILE* f) {  
-  fprintf(f, "%p", thread);
+  if (flusher_running) {
+    flusher_should_exit.store(true);
+    pthread_join(flusher, NULL);
+    flusher_running = false;
+  }
+  if (byte_file == NULL)
+    return;
+  flush(true);
+  int64_t nb_dropped = 0;
+  for (int id = worker::undef; id < worker::get_nb(); id++)
+    nb_dropped += rings_for[id].get_nb_dropped();
+  if (nb_dropped > 0)
+    fprintf(stderr, "logging: dropped %ld events; increase -log_ring_szb\n", (long) nb_dropped);
+  fclose(byte_file);
+  byte_file = NULL;
+  if (text_file != NULL) {
+    fclose(text_file);
+    text_file = NULL;
+  }
 }
 
 /*---------------------------------------------------------------------*/
 
-void thread_fork_event_t::print_byte_descr(FILE* f) {
-  fwrite_int64 (f, (int64_t) thread);
-  fwrite_int64 (f, (int64_t) threadL);
-  fwrite_int64 (f, (int64_t) threadR);
-}
-
-void thread_fork_event_t::print_text_descr(FILE* f) {  
-  fprintf(f, "%p\t%p\t%p", thread, threadL, threadR);
+int64_t thread_event_t::encode(int64_t* words) {
+  words[0] = (int64_t) thread;
+  return 1;
 }
 
-/*---------------------------------------------------------------------*/
-
-void interrupt_event_t::print_byte_descr(FILE* f) {
-  fwrite_double (f, elapsed);
-}
-void interrupt_event_t::print_text_descr(FILE* f) {  
-  fprintf(f,"%lf\t", elapsed);
+int64_t thread_fork_event_t::encode(int64_t* words) {
+  words[0] = (int64_t) thread;
+  words[1] = (int64_t) threadL;
+  words[2] = (int64_t) threadR;
+  return 3;
 }
 
-/*---------------------------------------------------------------------*/
-
-void locality_event_t::print_byte_descr(FILE* f) {
+int64_t locality_event_t::encode(int64_t* words) {
   //! \todo only works if thread::locality_t is int64_t
-  fwrite_int64 (f, (int64_t) pos);
+  words[0] = (int64_t) pos;
+  return 1;
 }
 
-void locality_event_t::print_text_descr(FILE* f) {  
-  fprintf(f, "%ld", pos);
+int64_t interrupt_event_t::encode(int64_t* words) {
+  words[0] = word_of_double(elapsed);
+  return 1;
 }
 
-/*---------------------------------------------------------------------*/
-
-void estim_name_event_t::print_byte_descr(FILE* f) {
-  fwrite_int64 (f, (int64_t) estim);
-  int64_t len = (int64_t) name.length();
-  fwrite_int64 (f, len);
+int64_t estim_name_event_t::encode(int64_t* words) {
+  int64_t len = std::min((int64_t) name.length(), max_payload_nb_words - 2);
+  words[0] = (int64_t) estim;
+  words[1] = len;
   for (int64_t i = 0; i < len; i++)
-    fwrite_int64 (f, (int64_t) name[i]);
+    words[2 + i] = (int64_t) name[i];
+  return 2 + len;
 }
 
-void estim_name_event_t::print_text_descr(FILE* f) {  
-  fprintf(f,"%p\t%s\t", estim, name.c_str());
-}
-
-void estim_report_event_t::print_byte_descr(FILE* f) {
-  fwrite_int64 (f, (int64_t) estim);
-  fwrite_int64 (f, (int64_t) comp);
+int64_t estim_report_event_t::encode(int64_t* words) {
+  words[0] = (int64_t) estim;
+  words[1] = (int64_t) comp;
   // TODO: fix double bits: fwrite_double (f, elapsed); 
-  fwrite_int64 (f, (int64_t) (1000.0 * elapsed));
-  fwrite_double (f, newcst);
-}
-
-void estim_report_event_t::print_text_descr(FILE* f) {  
-  // warning: order switched
-  fprintf(f,"%p\t%ld\t%lf\t%lf\t", estim, (long)comp, newcst, elapsed);
+  words[2] = (int64_t) (1000.0 * elapsed);
+  words[3] = word_of_double(newcst);
+  words[4] = word_of_double(elapsed); // text log only
+  return 5;
 }
 
-void estim_update_event_t::print_byte_descr(FILE* f) {
-  fwrite_int64 (f, (int64_t) estim);
-  fwrite_double (f, newcst);
-}
-void estim_update_event_t::print_text_descr(FILE* f) {  
-  fprintf(f,"%p\t%lf\t", estim, newcst);
+int64_t estim_update_event_t::encode(int64_t* words) {
+  words[0] = (int64_t) estim;
+  words[1] = word_of_double(newcst);
+  return 2;
 }
 
-void estim_predict_event_t::print_byte_descr(FILE* f) {
-  fwrite_int64 (f, (int64_t) estim);
-  fwrite_int64 (f, (int64_t) comp);
-  fwrite_double (f, time);
-}
-void estim_predict_event_t::print_text_descr(FILE* f) {  
-  // warning: extra info printed
-  double cst = time / comp;
-  fprintf(f,"%p\t%ld\t                     \t%lf\t%lf\t", estim, (long)comp, cst, time);
+int64_t estim_predict_event_t::encode(int64_t* words) {
+  words[0] = (int64_t) estim;
+  words[1] = (int64_t) comp;
+  words[2] = word_of_double(time);
+  return 3;
 }
 
 /*---------------------------------------------------------------------*/
@@ -304,21 +412,19 @@ void log_event(event_p event) {
 void log_basic(event_type_t type) {
   if (! the_recorder.is_tracked(type))
     return;
-  // I don't think we want to be calling "new" here; it'd be more efficient
-  // to push the raw event value on the event buffer -- Mike
-  the_recorder.add_nocheck(new basic_event_t(type));
+  the_recorder.add_basic(type);
 }
 
 void log_thread(event_type_t type, sched::thread_p thread) {
   if (! the_recorder.is_tracked(type))
     return;
-  the_recorder.add_nocheck(new thread_event_t(type, thread));
+  the_recorder.add_thread(type, thread);
 }
 
 void log_thread_fork(event_type_t type, sched::thread_p thread, sched::thread_p threadL, sched::thread_p threadR) {
   if (! the_recorder.is_tracked(type))
     return;
-  the_recorder.add_nocheck(new thread_fork_event_t(type, thread, threadL, threadR));
+  the_recorder.add_thread_fork(type, thread, threadL, threadR);
 }
 
 
@@ -4,7 +4,7 @@
  *
  * \file logging.hpp
  * \brief Record logs about the load balancing algorithm during
- * the execution of the program, and dumps them at the end
+ * the execution of the program, and streams them to disk
  * in text format or in binary format.
  *
  */
@@ -15,9 +15,13 @@
 #include <string>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <assert.h>
+#include <pthread.h>
 
 #include "workerlocal.hpp"
 #include "classes.hpp"
@@ -142,59 +146,168 @@ static inline event_kind_t kind_of_type(event_type_t type) {
 }
 
 /*---------------------------------------------------------------------*/
-class event_t_comparison_t;
+/* Events
+ *
+ * An event is stored as a record of 64-bit words: its time (a double),
+ * its type along with the number of words of its payload, and then the
+ * payload itself. The payload holds the fields that follow the header
+ * of the event in the binary log, possibly followed by extra fields
+ * that are used only by the text log (see `nb_byte_words_of`).
+ */
 
-class event_t {
-private:
-  int64_t id;
-  double time;
+static const int64_t record_header_nb_words = 2;
+//! Maximal number of words of the payload of an event
+static const int64_t max_payload_nb_words = 64;
+
+static inline int64_t word_of_double(double v) {
+  int64_t w;
+  memcpy(&w, &v, sizeof(w));
+  return w;
+}
+
+static inline double double_of_word(int64_t w) {
+  double v;
+  memcpy(&v, &w, sizeof(v));
+  return v;
+}
+
+//! Number of words of the payload that go to the binary log
+static inline int64_t nb_byte_words_of(event_type_t type, int64_t nb_words) {
+  return (type == ESTIM_REPORT) ? nb_words - 1 : nb_words;
+}
 
+class event_t {
 public:
 
-  event_t();
+  virtual ~event_t() { }
 
   virtual event_type_t get_type () = 0;
 
   virtual std::string get_name () = 0;
 
-  virtual void print_byte_descr(FILE* f);
+  /*! Writes the payload of the event in `words`, which has room for
+   *  `max_payload_nb_words`, and returns the number of words written
+   */
+  virtual int64_t encode(int64_t* words) {
+    return 0;
+  }
+};
 
-  virtual void print_text_descr(FILE* f);
+typedef event_t* event_p;
 
-  virtual void record (microtime_t basetime);
+/*---------------------------------------------------------------------*/
 
-  virtual void print_byte_header (FILE* f);
+/*! \class ring_t
+ *  \brief Bounded single-producer single-consumer queue of event
+ *  records
+ *
+ * The producer is the worker that owns the ring; the consumer is the
+ * flusher. When the ring is full, new events are dropped, and counted.
+ *
+ * The producer raises a flag before it reads the time of an event, and
+ * lowers it once the event is in the ring, so that the flusher can tell
+ * whether an event older than the current time may still arrive.
+ */
+class ring_t {
+private:
+  int64_t* words;
+  int64_t mask;
+  std::atomic<int64_t> head __attribute__ ((aligned (64)));  // written by the consumer
+  std::atomic<int64_t> tail __attribute__ ((aligned (64)));  // written by the producer
+  std::atomic<bool> recording;                               // written by the producer
+  int64_t nb_dropped;
 
-  virtual void print_byte (FILE* f);
+public:
+  ring_t() : words(NULL), mask(0), head(0), tail(0), recording(false), nb_dropped(0) { }
 
-  virtual void print_text_header (FILE* f);
+  //! \param nb_words capacity, rounded up to a power of two
+  void init(int64_t nb_words);
+  void destroy();
 
-  virtual void print_text (FILE* f);
+  //! To be called by the producer before it reads the time of an event
+  void begin_push() {
+    recording.store(true);
+  }
 
-  double get_time();
-};
+  void push(const int64_t* record, int64_t nb_words) {
+    int64_t t = tail.load(std::memory_order_relaxed);
+    if (t + nb_words - head.load(std::memory_order_acquire) > mask + 1) {
+      nb_dropped++;
+    } else {
+      for (int64_t i = 0; i < nb_words; i++)
+        words[(t + i) & mask] = record[i];
+      tail.store(t + nb_words, std::memory_order_release);
+    }
+    recording.store(false, std::memory_order_release);
+  }
 
-typedef event_t* event_p;
+  //! Returns true if the producer is between `begin_push()` and `push()`
+  bool is_recording() const {
+    return recording.load();
+  }
+
+  //! Moves all the records of the ring to the back of `dst`
+  void pop_all(std::vector<int64_t>& dst) {
+    int64_t h = head.load(std::memory_order_relaxed);
+    int64_t t = tail.load(std::memory_order_acquire);
+    for (int64_t i = h; i < t; i++)
+      dst.push_back(words[i & mask]);
+    head.store(t, std::memory_order_release);
+  }
 
-typedef std::vector<event_p> events_t;
+  int64_t get_nb_dropped() const {
+    return nb_dropped;
+  }
+};
 
 /*---------------------------------------------------------------------*/
 
+/*! \class recorder_t
+ *  \brief Collects the events of all workers and streams them to the
+ *  log files
+ *
+ * Each worker appends its events to its own ring; the threads that
+ * are not workers share one more ring, which they take turns to fill
+ * under a lock. A flusher thread periodically drains the rings, merges
+ * the records by time, and appends to the log files the records that
+ * are older than the oldest event that any thread may still produce.
+ * Memory usage is thus bounded by the size of the rings, whatever the
+ * length of the run.
+ *
+ * Command-line parameters:
+ *   - `-log_ring_szb <int>` (default=4194304) size of each ring
+ *   - `-log_flush_period <double>` (default=10000) delay between two
+ *     flushes, in microseconds
+ */
 class recorder_t {
 private:
   bool real_time;
   bool text_mode;
   bool tracking[NUM_KIND_IDS];
 
-  // LATER: this vector should use the local_allocator
-  
-  typedef data::perworker::extra<events_t> wi_events_t;
-  wi_events_t events_for; 
-  events_t all_events;
+  typedef data::perworker::extra<ring_t> wi_rings_t;
+  wi_rings_t rings_for;
+  //! serializes the producers of `rings_for[worker::undef]`
+  std::mutex undef_ring_lock;
   microtime_t basetime;
 
-private:
-  events_t& get_my_events();
+  FILE* byte_file;
+  FILE* text_file;
+
+  //! records drained from the rings but not yet written, by worker
+  std::vector<std::vector<int64_t>> staged;
+  //! time of the last record drained from each ring
+  std::vector<double> last_time;
+  double flush_period;
+  bool flusher_running;
+  std::atomic<bool> flusher_should_exit;
+  pthread_t flusher;
+
+  static void* flusher_loop(void* arg);
+
+  void add_record(event_type_t type, const int64_t* payload, int64_t nb_words);
+  void flush(bool final);
+  void write_record(worker_id_t id, const int64_t* record);
 
 public:
 
@@ -212,20 +325,19 @@ public:
 
   bool is_tracked(event_type_t type);
 
+  //! Records the event, and deletes it
   void add_nocheck(event_p event);
 
   void add(event_p event);
 
-  void merge_and_sort();
-
-  void dump_byte_to (FILE* f);
-
-  void dump_text_to (FILE* f);
+  void add_basic(event_type_t type);
 
-  void dump_byte ();
+  void add_thread(event_type_t type, sched::thread_p thread);
 
-  void dump_text ();
+  void add_thread_fork(event_type_t type, sched::thread_p thread,
+                       sched::thread_p threadL, sched::thread_p threadR);
 
+  //! Stops the flusher and writes the remaining events
   void output ();
 
 };
@@ -252,8 +364,7 @@ protected:
 public:
   thread_event_t(event_type_t type, sched::thread_p thread) 
     : basic_event_t(type), thread(thread) {}
-  void print_byte_descr(FILE* f);
-  virtual void print_text_descr(FILE* f);
+  int64_t encode(int64_t* words);
 };
 
 /*---------------------------------------------------------------------*/
@@ -264,8 +375,7 @@ protected:
 public:
   thread_fork_event_t(event_type_t type, sched::thread_p thread, sched::thread_p threadL, sched::thread_p threadR) 
     : thread_event_t(type, thread), threadL(threadL), threadR(threadR) {}
-  void print_byte_descr(FILE* f);
-  virtual void print_text_descr(FILE* f);
+  int64_t encode(int64_t* words);
 };
 
 /*---------------------------------------------------------------------*/
@@ -277,8 +387,7 @@ public:
   //! type should be LOCALITY_START or LOCALITY_STOP
   locality_event_t(event_type_t type, pasl::data::locality_t pos)
     : basic_event_t(type), pos(pos) {}
-  void print_byte_descr(FILE* f);
-  virtual void print_text_descr(FILE* f);
+  int64_t encode(int64_t* words);
 };
 
 /*---------------------------------------------------------------------*/
@@ -289,8 +398,7 @@ protected:
 public:
   interrupt_event_t(double elapsed) 
     : basic_event_t(INTERRUPT), elapsed(elapsed) {}
-  void print_byte_descr(FILE* f);
-  void print_text_descr(FILE* f);
+  int64_t encode(int64_t* words);
 };
 
 /*---------------------------------------------------------------------*/
@@ -312,8 +420,8 @@ public:
   estim_name_event_t(void* estim, std::string name) 
     : estim_event_t(estim, ESTIM_NAME), name(name) {
     this->type = ESTIM_NAME; }
-  void print_byte_descr(FILE* f);
-  void print_text_descr(FILE* f);
+  //! Names longer than the payload allows are truncated
+  int64_t encode(int64_t* words);
 };
 
 class estim_report_event_t : public estim_event_t {
@@ -326,8 +434,7 @@ public:
     : estim_event_t(estim, ESTIM_REPORT), 
       comp(comp), elapsed(elapsed), newcst(newcst) {
     this->type = ESTIM_REPORT; }
-  void print_byte_descr(FILE* f);
-  void print_text_descr(FILE* f);
+  int64_t encode(int64_t* words);
 };
 
 class estim_update_event_t : public estim_event_t {
@@ -337,8 +444,7 @@ public:
   estim_update_event_t(void* estim, double newcst) 
     : estim_event_t(estim, ESTIM_UPDATE), newcst(newcst) {
       this->type = ESTIM_UPDATE;}
-  void print_byte_descr(FILE* f);
-  void print_text_descr(FILE* f);
+  int64_t encode(int64_t* words);
 };
 
 class estim_predict_event_t : public estim_event_t {
@@ -349,8 +455,7 @@ public:
   estim_predict_event_t(void* estim, int64_t comp, double time) 
     : estim_event_t(estim, ESTIM_PREDICT), comp(comp), time(time) {
     this->type = ESTIM_PREDICT;}
-  void print_byte_descr(FILE* f);
-  void print_text_descr(FILE* f);
+  int64_t encode(int64_t* words);
 };
 
 
@@ -6,6 +6,7 @@
  */
 
 #include "atomic.hpp"
+#include "pcmdline.hpp"
 #include "messagestrategy.hpp"
 #include "instrategy.hpp"
 #include "outstrategy.hpp"
@@ -88,6 +89,134 @@ void pcb::check() {
   target[my_id] = id;
 }
 
+/*---------------------------------------------------------------------*/
+/* Messagestrategy implemented with batches and ring buffers */
+
+// maximal number of messages that the receiver handles per pop
+static constexpr size_t max_nb_per_pop = 64;
+
+void batched_pcb::init() {
+  int nb_workers = util::worker::get_nb();
+  ring_capacity =
+    (size_t)util::cmdline::parse_or_default_int("msg_ring_capacity", 256, false);
+  nb_per_batch =
+    (size_t)std::max(1, util::cmdline::parse_or_default_int("msg_batch", 8, false));
+  for (worker_id_t id = 0; id < nb_workers; id++) {
+    for (worker_id_t tid = 0; tid < nb_workers; tid++) {
+      channel_t& c = channels[id][tid];
+      c.ring.store(NULL);
+      c.overflow.init();
+      c.nb_overflow_pushed = 0;
+      c.nb_overflow_popped.store(0);
+      outboxes[id][tid].reserve(nb_per_batch);
+    }
+  }
+  target.init(0);
+  nb_processed_per_round = std::min(nb_workers, 8); // LATER: take 8 as argument
+}
+
+void batched_pcb::destroy() {
+  int nb_workers = util::worker::get_nb();
+  for (worker_id_t id = 0; id < nb_workers; id++) {
+    for (worker_id_t tid = 0; tid < nb_workers; tid++) {
+      ring_t* ring = channels[id][tid].ring.load();
+      if (ring != NULL) {
+        ring->destroy();
+        ring->~ring_t();
+        util::machine::free_near_worker(ring);
+      }
+      channels[id][tid].overflow.destroy();
+    }
+  }
+}
+
+void batched_pcb::flush(worker_id_t id_source, worker_id_t id_target) {
+  outbox_t& outbox = outboxes[id_source][id_target];
+  if (outbox.empty())
+    return;
+  channel_t& c = channels[id_target][id_source];
+  ring_t* ring = c.ring.load(std::memory_order_relaxed);
+  if (ring == NULL) {
+    // the ring is aligned on a cache line, and read mostly by the target
+    ring = new (util::machine::alloc_near_worker(id_target, sizeof(ring_t))) ring_t();
+    ring->init(ring_capacity);
+    c.ring.store(ring, std::memory_order_release);
+  }
+  size_t nb = 0;
+  // the ring is used only once the receiver has emptied the linked PCB
+  if (c.nb_overflow_pushed == c.nb_overflow_popped.load(std::memory_order_acquire))
+    nb = ring->try_push_batch(outbox.data(), outbox.size());
+  for (size_t i = nb; i < outbox.size(); i++) {
+    c.overflow.push(outbox[i]);
+    c.nb_overflow_pushed++;
+    STAT_COUNT(MSG_OVERFLOW);
+  }
+  outbox.clear();
+}
+
+void batched_pcb::flush_all(worker_id_t id_source) {
+  std::vector<worker_id_t>& ids = dirty[id_source];
+  for (size_t i = 0; i < ids.size(); i++)
+    flush(id_source, ids[i]);
+  ids.clear();
+}
+
+void batched_pcb::send(worker_id_t id_target, message_t msg) {
+  worker_id_t id_source = util::worker::get_my_id();
+  outbox_t& outbox = outboxes[id_source][id_target];
+  if (outbox.empty())
+    dirty[id_source].push_back(id_target);
+  outbox.push_back(msg);
+  STAT_COUNT(MSG_SEND);
+  if (outbox.size() >= nb_per_batch)
+    flush(id_source, id_target);
+}
+
+void batched_pcb::check() {
+  int nb_workers = util::worker::get_nb();
+  if (nb_workers <= 1) 
+    return;
+  worker_id_t my_id = util::worker::get_my_id();
+  flush_all(my_id);
+  message_t batch[max_nb_per_pop];
+  int id = target[my_id];
+  for (int __cnt = 0; __cnt < nb_processed_per_round; __cnt++) {
+    id = (id + 1) % nb_workers;
+    if (id == my_id) 
+      continue;
+    channel_t& c = channels[my_id][id];
+    // the messages in the ring are older than the ones in the linked PCB
+    ring_t* ring = c.ring.load(std::memory_order_acquire);
+    size_t nb;
+    if (ring != NULL)
+      while ((nb = ring->try_pop_batch(batch, max_nb_per_pop)) > 0)
+        for (size_t i = 0; i < nb; i++)
+          handle_message(batch[i]);
+    size_t nb_popped = 0;
+    message_t msg;
+    while (c.overflow.try_pop(msg)) {
+      handle_message(msg);
+      nb_popped++;
+    }
+    if (nb_popped > 0)
+      c.nb_overflow_popped.fetch_add(nb_popped, std::memory_order_release);
+  }
+  target[my_id] = id;
+}
+
+/*---------------------------------------------------------------------*/
+
+messagestrategy* create_messagestrategy() {
+  std::string s =
+    util::cmdline::parse_or_default_string("messagestrategy", "batched", false);
+  if (s == "batched")
+    return new batched_pcb();
+  else if (s == "linked")
+    return new pcb();
+  util::atomic::die("bogus message strategy %s\n", s.c_str());
+  return NULL;
+}
+
 } // end namespace
 } // end namespace
 } // end namespace
@@ -12,6 +12,7 @@
 
 #include <algorithm>
 #include <queue>
+#include <vector>
 
 #include "worker.hpp"
 #include "classes.hpp"
@@ -56,6 +57,14 @@ protected:
   virtual void handle_message(message_t msg);
 public:
   virtual ~messagestrategy() { }
+  /* The per-worker arrays of the strategies are aligned on a cache
+   * line, which the plain `new` of C++14 does not honor. */
+  static void* operator new(size_t szb) {
+    return util::machine::alloc_near_worker(util::worker::undef, szb);
+  }
+  static void operator delete(void* p) {
+    util::machine::free_near_worker(p);
+  }
   virtual void init() = 0;
   virtual void destroy() = 0;
   //! Sends a message \a msg to worker with id \a target.
@@ -170,6 +179,75 @@ public:
   void check();
 };
 
+/*! \class batched_pcb
+ *  \ingroup messagestrategy
+ *  \brief A message strategy that uses P(P-1) bounded ring buffers,
+ *  and that sends and receives messages in batches.
+ *
+ * A message is first appended to the outbox that the sender keeps
+ * for the target. The outbox moves to the ring of the pair of workers
+ * once it holds `-msg_batch` messages, or else at the next call to
+ * `check()` on the sender. The receiver drains each ring in batches.
+ * The ring of a pair is allocated by the sender on its first flush,
+ * so that pairs of workers that never communicate cost no memory.
+ *
+ * When a ring is full, the sender falls back on a linked PCB for the
+ * pair. The sender keeps using the linked PCB until the receiver has
+ * emptied it, so that the messages of a pair arrive in the order in
+ * which they were sent.
+ *
+ * Command-line parameters:
+ *   - `-msg_ring_capacity <int>` (default=256): messages per ring
+ *   - `-msg_batch <int>` (default=8): messages per outbox; 1 sends
+ *     each message right away
+ */
+class batched_pcb : public messagestrategy {
+private:
+
+  typedef data::pcb::ring<message_t> ring_t;
+  typedef data::pcb::linked<message_t> overflow_t;
+
+  typedef struct {
+    std::atomic<ring_t*> ring;
+    overflow_t overflow;
+    size_t nb_overflow_pushed;                  // sender side
+    std::atomic<size_t> nb_overflow_popped;     // receiver side
+  } channel_t;
+
+  typedef data::perworker::array<channel_t> channel_vector_t;
+  typedef data::perworker::array<channel_vector_t> channel_matrix_t;
+  typedef std::vector<message_t> outbox_t;
+  typedef data::perworker::array<outbox_t> outbox_vector_t;
+  typedef data::perworker::array<outbox_vector_t> outbox_matrix_t;
+  typedef data::perworker::array<std::vector<worker_id_t>> dirty_t;
+  typedef data::perworker::array<int> target_t;
+
+  channel_matrix_t channels;   // channels[receiver][sender]
+  outbox_matrix_t outboxes;    // outboxes[sender][receiver]
+  dirty_t dirty;               // receivers with a nonempty outbox
+  target_t target;
+
+  int nb_processed_per_round;
+  size_t ring_capacity;
+  size_t nb_per_batch;
+
+  void flush(worker_id_t id_source, worker_id_t id_target);
+  void flush_all(worker_id_t id_source);
+
+public:
+  void init();
+  void destroy();
+  void send(worker_id_t target, message_t msg);
+  void check();
+};
+
+/*! \brief Creates the message strategy given by `-messagestrategy`
+ *
+ *   - `batched` (default): `batched_pcb`
+ *   - `linked`: `pcb`
+ */
+messagestrategy* create_messagestrategy();
+
 /***********************************************************************/
 
 } // end namespace
@@ -9,6 +9,9 @@
 
 #include <utility>
 #include <functional>
+#include <type_traits>
+#include <new>
+#include <vector>
 
 #if defined(USE_CILK_RUNTIME)
 #include <cilk/cilk.h>
@@ -19,6 +22,7 @@
 #include "threaddag.hpp"
 #include "control.hpp"
 #include "atomic.hpp"
+#include "reducer.hpp"
 
 #ifndef _PASL_NATIVE_H_
 #define _PASL_NATIVE_H_
@@ -33,6 +37,28 @@ namespace ucxt = util::control;
 
 /*---------------------------------------------------------------------*/
 
+/*! \class latent_frame
+ *  \brief Fork point that runs sequentially unless the heartbeat
+ *  promotes it (see `heartbeat_mode`)
+ *
+ * Latent frames live on the call stack of the thread that runs them,
+ * which keeps them in a list ordered from the oldest to the newest.
+ */
+class latent_frame {
+public:
+  latent_frame* older;
+  latent_frame* newer;
+
+  virtual ~latent_frame() { }
+
+  /*! Turns part of the work that remains in the frame into a new
+   * thread; returns false if there is nothing left to promote
+   */
+  virtual bool promote() = 0;
+};
+
+/*---------------------------------------------------------------------*/
+
 class multishot : public thread {
 protected:
 
@@ -53,6 +79,17 @@ protected:
   char* stack;
   //! CPU context of this thread
   context_type cxt;
+  //! future that this thread waits for, once it is suspended
+  future_p forcing;
+  //! oldest and newest latent fork points of this thread
+  latent_frame* latent_oldest;
+  latent_frame* latent_newest;
+  //! views of the reducers for the strand that this thread runs
+  reducer::view_map* views;
+  //! views of a thread that ran in parallel, to be merged at the join
+  reducer::view_map* joining_views;
+  //! where this thread leaves its views when it completes, or null
+  reducer::view_map** views_dst;
 
   void swap_with_scheduler() {
     context::swap(context::addr(cxt), ucxt::my_cxt(), notaptr);
@@ -86,6 +123,8 @@ protected:
     assert(t != nullptr);
     assert(t != (multishot_p)notaptr);
     t->run();
+    if (t->views_dst != nullptr)
+      *t->views_dst = t->views;
     // terminate thread by exiting to scheduler
     exit_to_scheduler();
   }
@@ -93,19 +132,40 @@ protected:
 public:
 
   multishot()
-  : thread(), stack(nullptr)  { }
+  : thread(), stack(nullptr), forcing(nullptr),
+    latent_oldest(nullptr), latent_newest(nullptr),
+    views(nullptr), joining_views(nullptr), views_dst(nullptr) { }
 
   ~multishot() {
     if (stack == nullptr)
       return;
     if (stack == notownstackptr)
       return;
-    free(stack);
+    ucxt::stack_free(stack);
     stack = nullptr;
   }
 
   virtual void run() = 0;
 
+  bool has_started() {
+    return stack != nullptr;
+  }
+
+  /* Called by the scheduler after this thread returned control to
+   * it. A thread that waits for a future registers with the future
+   * only at this point: were it to register before suspending, the
+   * thread of the future could complete on another worker and resume
+   * this thread while its call stack is still in use.
+   */
+  void reset_caches() {
+    if (forcing == nullptr)
+      return;
+    future_p future = forcing;
+    forcing = nullptr;
+    threaddag::join_with(this, instrategy::unary_new());
+    future->add(this);
+  }
+
   // schedule this thread and then return control to scheduler
   void yield() {
     threaddag::continue_with(this);
@@ -117,18 +177,73 @@ public:
     yield();
   }
 
+  // merges the views left by the thread that joins with this thread
+  void join_views() {
+    views = reducer::merge(views, joining_views);
+    joining_views = nullptr;
+  }
+
   void finish(multishot_p thread) {
-    instrategy::distributed* dist = new instrategy::distributed(this);
-    threaddag::unary_fork_join(thread, this, dist);
+    instrategy_p in = threaddag::new_finish_instrategy(this);
+    // this thread is suspended until `thread` completes, so that they can share views
+    thread->views = views;
+    thread->views_dst = &joining_views;
+    threaddag::unary_fork_join(thread, this, in);
+    prepare_and_swap_with_scheduler();
+    join_views();
+  }
+
+  void push_latent(latent_frame* f) {
+    f->older = latent_newest;
+    f->newer = nullptr;
+    if (latent_newest == nullptr)
+      latent_oldest = f;
+    else
+      latent_newest->newer = f;
+    latent_newest = f;
+  }
+
+  void remove_latent(latent_frame* f) {
+    if (f->older == nullptr)
+      latent_oldest = f->newer;
+    else
+      f->older->newer = f->newer;
+    if (f->newer == nullptr)
+      latent_newest = f->older;
+    else
+      f->newer->older = f->older;
+  }
+
+  /* Promotes the oldest latent fork point that has work left, and then
+   * hands control back to the scheduler, so that the new thread becomes
+   * visible to thieves.
+   */
+  void promote_oldest() {
+    for (latent_frame* f = latent_oldest; f != nullptr; f = f->newer) {
+      if (f->promote()) {
+        STAT_COUNT(THREAD_PROMOTE);
+        yield();
+        return;
+      }
+    }
+  }
+
+  // suspend this thread until the thread of `future` completes
+  void force(future_p future) {
+    forcing = future;
     prepare_and_swap_with_scheduler();
   }
 
   void fork2(multishot_p thread0, multishot_p thread1) {
     LOG_THREAD_FORK(this, thread0, thread1);
     prepare();
+    // thread0 continues the strand of this thread; thread1 does too, unless stolen
+    thread0->views = views;
+    thread1->views_dst = &joining_views;
     threaddag::binary_fork_join(thread0, thread1, this);
     if (context::capture<multishot*>(context::addr(cxt))) {
       //      util::atomic::aprintf("steal happened: executing join continuation\n");
+      join_views();
       return;
     }
     scheduler_p sched = threaddag::my_sched();
@@ -139,7 +254,12 @@ public:
     assert(sched == threaddag::my_sched());
     // sched is popping thread0
     // run begin of sched->exec(thread0) until thread0->exec()
-    thread0->run();
+    if (thread0->is_cancelled()) {
+      STAT_COUNT(THREAD_CANCEL);
+    } else {
+      thread0->run();
+    }
+    views = thread0->views;
     sched = threaddag::my_sched();
     // if thread1 was not stolen, then it can run in the same stack as parent
     if (! sched->local_has() || sched->local_peek() != thread1) {
@@ -152,19 +272,27 @@ public:
     assert(sched == threaddag::my_sched());
     assert(thread1->stack == nullptr);
     thread1->stack = notownstackptr;
+    thread1->views = views;
     thread1->swap_with_scheduler();
     //    util::atomic::aprintf("%d %d this=%p thread0=%p thread1=%p\n",id,util::worker::get_my_id(),this, thread0, thread1);
     assert(sched == threaddag::my_sched());
     //    printf("ran %p and %p locally\n",thread0,thread1);
     // run end of sched->exec() starting after thread0->exec()
     // run begin of sched->exec(thread1) until thread1->exec()
-    thread1->run();
+    if (thread1->is_cancelled()) {
+      STAT_COUNT(THREAD_CANCEL);
+    } else {
+      thread1->run();
+    }
+    views = thread1->views;
     swap_with_scheduler();
     // run end of sched->exec() starting after thread1->exec()
   }
 
   friend class sched::scheduler::_private;
   friend class ucxt::context;
+  friend class latent_frame_base;
+  friend reducer::view_map*& reducer::my_views();
 };
 
 /*---------------------------------------------------------------------*/
@@ -209,6 +337,152 @@ static inline int my_deque_size() {
 #endif
 }
 
+/*---------------------------------------------------------------------*/
+/* Heartbeat mode
+ *
+ * In heartbeat mode (`-heartbeat <period>`, in microseconds), `fork2`
+ * and `parallel_for` create no thread by themselves: they push a
+ * latent fork point and run sequentially. Every heartbeat period,
+ * a worker promotes the oldest latent fork point of the thread that
+ * it runs into a thread that other workers can steal. The number of
+ * threads created is thus proportional to the number of heartbeats,
+ * regardless of `loop_cutoff` and of the cutoffs of the callers.
+ */
+
+extern bool heartbeat_mode;
+
+// polling point of the heartbeat
+static inline void heartbeat_poll() {
+  if (threaddag::my_sched()->heartbeat())
+    my_thread()->promote_oldest();
+}
+
+/* Links the frame to the calling thread on construction, and unlinks
+ * it on destruction; the threads created by promotion join back into
+ * the frame through futures that the frame forces in `join()`.
+ */
+class latent_frame_base : public latent_frame {
+protected:
+  multishot* owner;
+
+public:
+  //! future of a promoted thread, where the thread leaves its views
+  class promoted_future : public outstrategy::future_cas {
+  public:
+    reducer::view_map* views;
+    promoted_future() : views(nullptr) { }
+  };
+
+  // returns a future whose thread runs `body`
+  template <class Body>
+  promoted_future* spawn(const Body& body) {
+    promoted_future* f = new promoted_future;
+    multishot* thread = new_multishot_by_lambda(body);
+    thread->views_dst = &f->views;
+    threaddag::create_future(thread, f);
+    return f;
+  }
+
+  // the promoted thread must come after all the other threads joined so far
+  void join(promoted_future* f) {
+    if (! f->thread_finished())
+      my_thread()->force(f);
+    multishot* thread = my_thread();
+    thread->views = reducer::merge(thread->views, f->views);
+    delete f;
+  }
+
+  latent_frame_base() : owner(my_thread()) {
+    owner->push_latent(this);
+  }
+
+  ~latent_frame_base() {
+    unlink();
+  }
+
+  void unlink() {
+    if (owner == nullptr)
+      return;
+    owner->remove_latent(this);
+    owner = nullptr;
+  }
+};
+
+template <class Exp2>
+class latent_fork2 : public latent_frame_base {
+public:
+  const Exp2& exp2;
+  promoted_future* promoted;
+
+  latent_fork2(const Exp2& exp2) : exp2(exp2), promoted(nullptr) { }
+
+  bool promote() {
+    if (promoted != nullptr)
+      return false;
+    promoted = spawn(exp2);
+    return true;
+  }
+};
+
+template <class Exp1, class Exp2>
+void heartbeat_fork2(const Exp1& exp1, const Exp2& exp2) {
+  latent_fork2<Exp2> frame(exp2);
+  heartbeat_poll();
+  exp1();
+  frame.unlink();
+  if (frame.promoted == nullptr) {
+    if (! my_thread()->is_cancelled())
+      exp2();
+  } else {
+    frame.join(frame.promoted);
+  }
+}
+
+template <class Number, class Body>
+class latent_loop : public latent_frame_base {
+public:
+  Number lo;
+  Number hi;
+  const Body& body;
+  std::vector<promoted_future*> promoted;
+
+  latent_loop(Number lo, Number hi, const Body& body)
+  : lo(lo), hi(hi), body(body) { }
+
+  // gives away the upper half of the iterations that are left
+  bool promote();
+
+  void run() {
+    while (lo < hi) {
+      Number i = lo++;
+      body(i);
+      heartbeat_poll();
+    }
+    unlink();
+    // each promotion gives away iterations that precede those of the previous one
+    for (size_t k = promoted.size(); k > 0; k--)
+      join(promoted[k - 1]);
+  }
+};
+
+template <class Number, class Body>
+void heartbeat_parallel_for(Number lo, Number hi, const Body& body) {
+  latent_loop<Number, Body> frame(lo, hi, body);
+  frame.run();
+}
+
+template <class Number, class Body>
+bool latent_loop<Number, Body>::promote() {
+  if (hi - lo < 2)
+    return false;
+  Number mid = lo + (hi - lo) / 2;
+  Number h = hi;
+  const Body& b = body;
+  promoted.push_back(spawn([mid, h, &b] { heartbeat_parallel_for(mid, h, b); }));
+  hi = mid;
+  return true;
+}
+
 /*---------------------------------------------------------------------*/
 
 template <class Exp1, class Exp2>
@@ -221,6 +495,10 @@ void fork2(const Exp1& exp1, const Exp2& exp2) {
   exp2();
   cilk_sync;
 #else
+  if (heartbeat_mode) {
+    heartbeat_fork2(exp1, exp2);
+    return;
+  }
   my_thread()->fork2(new_multishot_by_lambda(exp1),
                      new_multishot_by_lambda(exp2));
 #endif
@@ -245,6 +523,154 @@ static inline void yield() {
   thread->yield();
 }
 
+/*---------------------------------------------------------------------*/
+/* Cancellation
+ *
+ * A cancellable scope covers all the threads that are created, directly
+ * or transitively, by the body of the scope. Once the scope is
+ * cancelled, the threads of the scope that have not started are
+ * dropped, both by `fork2` and by the scheduler, which still releases
+ * their join points. The threads that run keep running, unless they
+ * poll `is_cancelled()`.
+ */
+
+//! True if a cancellable scope that encloses the calling thread was cancelled
+static inline bool is_cancelled() {
+  return my_thread()->is_cancelled();
+}
+
+//! Cancels the innermost cancellable scope of the calling thread
+static inline void cancel() {
+  cancellation::token* token = my_thread()->cancel_token;
+  if (token == nullptr)
+    util::atomic::die("cancel() called outside of a cancellable scope");
+  token->cancel();
+}
+
+/*! Runs `body()` in a new cancellable scope, nested in the scope of the
+ * calling thread, if any; returns true if the scope was cancelled.
+ *
+ * The token of the scope lives on the stack of the calling thread: all
+ * the threads of the scope must complete before `body()` returns, which
+ * is the case with `fork2`, `parallel_for` and `finish`, but requires
+ * the futures that `body()` spawns to be forced, or destroyed, in
+ * `body()`. Forcing a future whose thread was dropped is an error.
+ */
+template <class Body>
+bool cancellable(const Body& body) {
+  multishot* thread = my_thread();
+  cancellation::token token(thread->cancel_token);
+  thread->cancel_token = &token;
+  body();
+  assert(my_thread() == thread);
+  thread->cancel_token = token.parent;
+  return token.is_cancelled_here();
+}
+
+/*---------------------------------------------------------------------*/
+/* Futures */
+
+/*! \class future
+ *  \brief Handle on a value of type `T` that is computed by a thread
+ *  created by `spawn_future`
+ *
+ * The value is stored in the outstrategy of that thread, which is
+ * allocated together with the value, in one block. `force()` returns
+ * the value, after suspending the calling thread until the value is
+ * ready if need be. A handle can be moved but not copied; its
+ * destructor forces the future if it was not forced already.
+ */
+template <class T>
+class future {
+private:
+
+  class cell_type : public outstrategy::future_cas {
+  public:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type value;
+    bool has_value;
+
+    cell_type() : has_value(false) { }
+
+    ~cell_type() {
+      if (has_value)
+        get().~T();
+    }
+
+    T& get() {
+      return *(T*)&value;
+    }
+  };
+
+  cell_type* cell;
+
+  future(cell_type* cell) : cell(cell) { }
+
+  template <class Body>
+  friend future<decltype(std::declval<Body>()())> spawn_future(const Body& body);
+
+public:
+
+  future() : cell(nullptr) { }
+
+  future(future&& other) : cell(other.cell) {
+    other.cell = nullptr;
+  }
+
+  future& operator=(future&& other) {
+    std::swap(cell, other.cell);
+    return *this;
+  }
+
+  future(const future&) = delete;
+  future& operator=(const future&) = delete;
+
+  ~future() {
+    if (cell == nullptr)
+      return;
+    // waits without reading the value, which a cancelled thread may not have set
+    if (! cell->thread_finished())
+      my_thread()->force(cell);
+    delete cell;
+  }
+
+  //! Returns true if the value is ready
+  bool ready() const {
+    assert(cell != nullptr);
+    return cell->thread_finished();
+  }
+
+  T& force() {
+    assert(cell != nullptr);
+    if (! cell->thread_finished())
+      my_thread()->force(cell);
+    assert(cell->has_value);
+    return cell->get();
+  }
+
+};
+
+/*! Returns a future whose value is the result of `body()`, which is
+ * computed by a new thread. The calling thread keeps running.
+ */
+template <class Body>
+future<decltype(std::declval<Body>()())> spawn_future(const Body& body) {
+  using value_type = decltype(body());
+  using future_type = future<value_type>;
+  typename future_type::cell_type* cell = new typename future_type::cell_type;
+#if defined(SEQUENTIAL_ELISION) || defined(USE_CILK_RUNTIME)
+  new (&cell->value) value_type(body());
+  cell->has_value = true;
+  cell->finished();
+#else
+  multishot* thread = new_multishot_by_lambda([cell, body] {
+    new (&cell->value) value_type(body());
+    cell->has_value = true;
+  });
+  threaddag::create_future(thread, cell);
+#endif
+  return future_type(cell);
+}
+
 template <class Body, class State, class Size_input, class Fork_input, class Set_in_env>
 class parallel_while_base : public multishot {
 public:
@@ -283,6 +709,7 @@ public:
 
   thread_p split(size_t) {
     self_type* t = new self_type(*this);
+    t->cancel_token = cancel_token;
     fork_input(state, t->state);
     t->set_instrategy(instrategy::ready_new());
     t->set_outstrategy(outstrategy::unary_new());
@@ -622,6 +1049,10 @@ void parallel_for(Number lo, Number hi, const Body& body) {
     body(i);
     */
 #else
+  if (heartbeat_mode) {
+    heartbeat_parallel_for(lo, hi, body);
+    return;
+  }
   struct { } output;
   using output_type = typeof(output);
   auto join = [] (output_type,output_type) { };
@@ -643,6 +1074,10 @@ void parallel_for1(Number lo, Number hi, const Body& body) {
     body(i);
     */
 #else
+  if (heartbeat_mode) {
+    heartbeat_parallel_for(lo, hi, body);
+    return;
+  }
   struct { } output;
   using range_type = std::pair<Number, Number>;
   auto cutoff = [] (range_type r) {
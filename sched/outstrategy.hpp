@@ -55,7 +55,7 @@ namespace outstrategy {
  *
  * \ingroup outstrategy
  */
-class signature {
+class signature : public slab::allocated {
 public:
 
   //! Adds the given thread `td` to the list of out-going edges
@@ -323,7 +323,76 @@ public:
     return completed;
   }
 };
-  
+
+/*---------------------------------------------------------------------*/
+
+/*! \class future_cas
+ *  \brief An instance of the outstrategy `future` that is based on
+ *  compare-and-swap.
+ *
+ * The threads that force the future are pushed on a lock-free stack,
+ * which the thread of the future detaches in one step when it
+ * completes. Unlike `future_message`, no worker has to poll for
+ * messages in order for the waiting threads to be released. Only
+ * eager futures are supported.
+ *
+ * \ingroup outstrategy future
+ */
+class future_cas : public future {
+protected:
+
+  class waiter_type : public slab::allocated {
+  public:
+    thread_p td;
+    waiter_type* next;
+  };
+
+  //! Stack of waiting threads, or `completed_tag()`
+  std::atomic<waiter_type*> waiters;
+
+  static waiter_type* completed_tag() {
+    return (waiter_type*)1;
+  }
+
+public:
+
+  future_cas() : future(false), waiters(NULL) { }
+
+  virtual void add(thread_p td) {
+    waiter_type* w = new waiter_type;
+    w->td = td;
+    waiter_type* head = waiters.load();
+    while (head != completed_tag()) {
+      w->next = head;
+      if (waiters.compare_exchange_weak(head, w))
+        return;
+    }
+    delete w;
+    decr_dependencies(td);
+  }
+
+  //! The future itself is deallocated by its owner, not here
+  virtual void finished() {
+    waiter_type* w = waiters.exchange(completed_tag());
+    while (w != NULL) {
+      waiter_type* next = w->next;
+      decr_dependencies(w->td);
+      delete w;
+      w = next;
+    }
+  }
+
+  virtual void copy_edgelist(edgelist_t& vec) {
+    waiter_type* w = waiters.load();
+    for (; w != NULL && w != completed_tag(); w = w->next)
+      vec.push_back(w->td);
+  }
+
+  virtual bool thread_finished() {
+    return waiters.load() == completed_tag();
+  }
+};
+
 /*---------------------------------------------------------------------*/
   
 const long NOOP_TAG = 1;
@@ -0,0 +1,291 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file pipeline.hpp
+ * \brief Pipelines of native threads with bounded stages
+ *
+ */
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "native.hpp"
+
+#ifndef _PASL_SCHED_PIPELINE_H_
+#define _PASL_SCHED_PIPELINE_H_
+
+/***********************************************************************/
+
+namespace pasl {
+namespace sched {
+namespace native {
+
+/*---------------------------------------------------------------------*/
+
+/*! \class pipeline
+ *  \brief Runs a stream of items through a sequence of stages
+ *
+ * The first stage, the input, fills in the items one after the other,
+ * until it returns false. Each of the next stages runs on every item,
+ * after the previous stage is done with that item, in one of the modes:
+ *   - `serial_in_order`: on one item at a time, in the order of input
+ *   - `serial_out_of_order`: on one item at a time, in any order
+ *   - `parallel`: on any number of items at a time
+ *
+ * At most `max_in_flight` items are in the pipeline at a time: the
+ * input of an item waits for the last stage to be done with the item
+ * that came `max_in_flight` items earlier. The items are stored in
+ * `max_in_flight` slots, which are reused, so that the memory used by
+ * the pipeline is bounded, and so are the buffers of the items, which
+ * keep their capacity from one item to the next.
+ *
+ * Every stage of every item is a native thread, so that stage bodies
+ * may fork in turn. The thread of stage `k` of an item is connected,
+ * through the `future_cas` events that record the completion of the
+ * stages, to stage `k-1` of the same item and, if stage `k` is serial
+ * in order, to stage `k` of the previous item. The events, rather than
+ * the threads, carry the edges, because an edge may be added after the
+ * thread that it starts from has completed.
+ *
+ * A serial stage that runs out of order does not need such an edge:
+ * the items that are ready for the stage are queued, and the thread
+ * that finds no other thread draining the queue drains it.
+ */
+template <class Item>
+class pipeline {
+public:
+
+  typedef enum {
+    serial_in_order,
+    serial_out_of_order,
+    parallel
+  } mode_type;
+
+  using item_type = Item;
+  using input_type = std::function<bool (Item&)>;
+  using body_type = std::function<void (Item&)>;
+
+private:
+
+  using event_type = outstrategy::future_cas;
+
+  class stage_type {
+  public:
+    mode_type mode;
+    body_type body;
+    // items waiting for a serial out-of-order stage, by index
+    std::mutex pending_lock;
+    std::deque<long> pending;
+    bool draining;
+
+    stage_type(mode_type mode, const body_type& body)
+    : mode(mode), body(body), draining(false) { }
+  };
+
+  const long max_in_flight;
+  std::vector<stage_type*> stages;
+  input_type input;
+  std::vector<Item> items;
+  //! `events[s][k-1]`: completion of stage `k` by the item in slot `s`
+  std::vector<std::vector<event_type*>> events;
+  /* completion of the input of the last two items: the event of the
+   * next input is created while the current input runs, even when
+   * there is only one slot */
+  event_type* input_events[2];
+  //! thread that waits for all the items, and its completion
+  thread_p end;
+  event_type* end_event;
+  long nb_items;
+
+  long slot_of(long i) const {
+    return i % max_in_flight;
+  }
+
+  long last_stage() const {
+    return (long)stages.size();
+  }
+
+  //! Completion of stage `k` (0 is the input) by item `i`
+  event_type*& event_of(long i, long k) {
+    if (k == 0)
+      return input_events[i % 2];
+    return events[slot_of(i)][k - 1];
+  }
+
+  static void hold(thread_p t) {
+    instrategy::delta(t->in, t, +1l);
+  }
+
+  static void release(thread_p t) {
+    instrategy::delta(t->in, t, -1l);
+  }
+
+  //! Same as `threaddag::add_dependency`, from the completion of `event`
+  static void add_dependency(event_type* event, thread_p t) {
+    instrategy::delta(t->in, t, +1l);
+    event->add(t);
+  }
+
+  /* Creates, and deletes, the events of a slot only once the item that
+   * last used the slot is done with them: no thread can be waiting for
+   * them, or still adding edges to them.
+   */
+  static void renew(event_type*& event) {
+    delete event;
+    event = new event_type;
+  }
+
+  template <class Body>
+  static thread_p new_node(const Body& body, outstrategy_p out) {
+    thread_p t = new_multishot_by_lambda(body);
+    t->set_instrategy(instrategy::fetch_add_new());
+    t->set_outstrategy(out);
+    hold(t);
+    return t;
+  }
+
+  static void start(thread_p t) {
+    threaddag::add_thread(t);
+    release(t);
+  }
+
+  void add_input_node(long i) {
+    event_type*& event = event_of(i, 0);
+    renew(event);
+    thread_p t = new_node([this, i] { run_input(i); }, event);
+    if (i > 0)
+      add_dependency(event_of(i - 1, 0), t);
+    if (i >= max_in_flight && last_stage() > 0)
+      add_dependency(event_of(i - max_in_flight, last_stage()), t);
+    add_dependency(event, end);
+    start(t);
+  }
+
+  void add_stage_node(long i, long k) {
+    stage_type& stage = *stages[k - 1];
+    bool out_of_order = (stage.mode == serial_out_of_order);
+    outstrategy_p out = out_of_order ? outstrategy::noop_new() : event_of(i, k);
+    thread_p t = new_node([this, i, k] { run_stage(i, k); }, out);
+    add_dependency(event_of(i, k - 1), t);
+    // with one slot, the previous item is done before this one is input
+    if (stage.mode == serial_in_order && i > 0 && max_in_flight > 1)
+      add_dependency(event_of(i - 1, k), t);
+    start(t);
+  }
+
+  void run_input(long i) {
+    if (! input(items[slot_of(i)])) {
+      nb_items = i;
+      return;
+    }
+    for (long k = 1; k <= last_stage(); k++)
+      renew(event_of(i, k));
+    for (long k = 1; k <= last_stage(); k++)
+      add_stage_node(i, k);
+    add_dependency(event_of(i, last_stage()), end);
+    add_input_node(i + 1);
+  }
+
+  void run_stage(long i, long k) {
+    stage_type& stage = *stages[k - 1];
+    if (stage.mode == serial_out_of_order)
+      drain(i, k);
+    else
+      stage.body(items[slot_of(i)]);
+  }
+
+  void drain(long i, long k) {
+    stage_type& stage = *stages[k - 1];
+    std::unique_lock<std::mutex> guard(stage.pending_lock);
+    stage.pending.push_back(i);
+    if (stage.draining)
+      return;
+    stage.draining = true;
+    while (! stage.pending.empty()) {
+      long j = stage.pending.front();
+      stage.pending.pop_front();
+      guard.unlock();
+      stage.body(items[slot_of(j)]);
+      event_of(j, k)->finished();
+      guard.lock();
+    }
+    stage.draining = false;
+  }
+
+  void run_sequential() {
+    Item& item = items[0];
+    for (nb_items = 0; input(item); nb_items++)
+      for (stage_type* stage : stages)
+        stage->body(item);
+  }
+
+public:
+
+  pipeline(long max_in_flight)
+  : max_in_flight(std::max(1l, max_in_flight)), end(nullptr),
+    end_event(nullptr), nb_items(0) {
+    input_events[0] = input_events[1] = nullptr;
+  }
+
+  pipeline(const pipeline&) = delete;
+  pipeline& operator=(const pipeline&) = delete;
+
+  ~pipeline() {
+    for (stage_type* stage : stages)
+      delete stage;
+  }
+
+  //! Appends a stage that runs `body(item)` on every item
+  void add_stage(mode_type mode, const body_type& body) {
+    stages.push_back(new stage_type(mode, body));
+  }
+
+  /*! Runs the pipeline on the items that `input(item)` fills in, until
+   * `input` returns false; returns once all the stages are done with
+   * all the items.
+   */
+  void run(const input_type& input) {
+    this->input = input;
+    items.assign(max_in_flight, Item());
+#if defined(SEQUENTIAL_ELISION) || defined(USE_CILK_RUNTIME)
+    run_sequential();
+#else
+    events.assign(max_in_flight, std::vector<event_type*>(last_stage(), nullptr));
+    end_event = new event_type;
+    end = new_node([] { }, end_event);
+    threaddag::add_thread(end);
+    add_input_node(0);
+    release(end);
+    if (! end_event->thread_finished())
+      my_thread()->force(end_event);
+    for (std::vector<event_type*>& slot : events)
+      for (event_type* event : slot)
+        delete event;
+    events.clear();
+    for (event_type*& event : input_events) {
+      delete event;
+      event = nullptr;
+    }
+    delete end_event;
+    end_event = nullptr;
+    end = nullptr;
+#endif
+  }
+
+  //! Number of items that went through the last run
+  long get_nb_items() const {
+    return nb_items;
+  }
+
+};
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_SCHED_PIPELINE_H_ */
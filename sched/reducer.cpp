@@ -0,0 +1,90 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file reducer.cpp
+ *
+ */
+
+#include <mutex>
+
+#include "reducer.hpp"
+#include "native.hpp"
+
+namespace pasl {
+namespace sched {
+namespace reducer {
+
+/***********************************************************************/
+
+view_map::~view_map() {
+  for (view_base* v : views)
+    delete v;
+}
+
+void view_map::insert(int id, view_base* v) {
+  if (id >= (int)views.size())
+    views.resize(id + 1, nullptr);
+  assert(views[id] == nullptr);
+  views[id] = v;
+}
+
+void view_map::merge(view_map& right) {
+  int nb = (int)right.views.size();
+  if (nb > (int)views.size())
+    views.resize(nb, nullptr);
+  for (int id = 0; id < nb; id++) {
+    view_base* r = right.views[id];
+    if (r == nullptr)
+      continue;
+    right.views[id] = nullptr;
+    if (views[id] == nullptr) {
+      views[id] = r;
+    } else {
+      views[id]->reduce(r);
+      delete r;
+    }
+  }
+}
+
+view_map* merge(view_map* left, view_map* right) {
+  if (right == nullptr || right == left)
+    return left;
+  if (left == nullptr)
+    return right;
+  left->merge(*right);
+  delete right;
+  return left;
+}
+
+view_map*& my_views() {
+  return native::my_thread()->views;
+}
+
+/*---------------------------------------------------------------------*/
+/* Identifiers, which index the view maps, are recycled so that the
+ * maps stay small. */
+
+static std::mutex ids_lock;
+static std::vector<int> free_ids;
+static int nb_ids = 0;
+
+int new_id() {
+  std::lock_guard<std::mutex> guard(ids_lock);
+  if (free_ids.empty())
+    return nb_ids++;
+  int id = free_ids.back();
+  free_ids.pop_back();
+  return id;
+}
+
+void delete_id(int id) {
+  std::lock_guard<std::mutex> guard(ids_lock);
+  free_ids.push_back(id);
+}
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
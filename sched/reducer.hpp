@@ -0,0 +1,279 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file reducer.hpp
+ * \brief Reducer objects (hyperobjects) for native threads
+ *
+ */
+
+#include <cassert>
+#include <vector>
+#include <limits>
+#include <sstream>
+#include <ostream>
+
+#ifndef _PASL_SCHED_REDUCER_H_
+#define _PASL_SCHED_REDUCER_H_
+
+/***********************************************************************/
+
+namespace pasl {
+namespace sched {
+namespace reducer {
+
+/*---------------------------------------------------------------------*/
+/* Views
+ *
+ * A strand is a sequence of instructions that runs without any parallel
+ * branch in between, such as the body of a thread up to its first
+ * `fork2`, together with the first branch of the `fork2` and the
+ * continuation of the `fork2` when no branch was stolen. Each strand
+ * accesses its own view of a reducer. The views of a strand are kept
+ * in a `view_map` that the native thread which runs the strand points
+ * to (see `native::multishot`).
+ *
+ * The map is created the first time the strand accesses a reducer; the
+ * views in it are created the first time the strand accesses each
+ * reducer, starting from the identity of the monoid. A strand thus
+ * creates views only if it was stolen. When a stolen branch joins, its
+ * views are merged into the views of the branch on its left, in the
+ * order of the sequential execution, so that the monoid needs to be
+ * associative, but not commutative.
+ */
+
+class view_base {
+public:
+  virtual ~view_base() { }
+  //! Combines `this` with `right`, in this order, into `this`
+  virtual void reduce(view_base* right) = 0;
+};
+
+class view_map {
+private:
+
+  //! views indexed by the identifier of their reducer; null if none
+  std::vector<view_base*> views;
+
+public:
+
+  ~view_map();
+
+  view_base* find(int id) const {
+    return (id < (int)views.size()) ? views[id] : nullptr;
+  }
+
+  void insert(int id, view_base* v);
+
+  //! Removes the view of reducer `id` without deallocating it
+  void remove(int id) {
+    if (id < (int)views.size())
+      views[id] = nullptr;
+  }
+
+  //! Moves the views of `right` into this map, reducing with the views in this map
+  void merge(view_map& right);
+
+};
+
+/*! \brief Merges `right`, which is deallocated, into `left`, and
+ *  returns the result
+ *
+ * Either map may be null, and both may be the same map, in which case
+ * there is nothing to merge.
+ */
+view_map* merge(view_map* left, view_map* right);
+
+//! Returns the map of the strand of the calling thread
+view_map*& my_views();
+
+//! Returns an identifier not in use by any other reducer
+int new_id();
+//! Releases an identifier
+void delete_id(int id);
+
+/*---------------------------------------------------------------------*/
+/* Reducers */
+
+/*! \class reducer
+ *  \brief Variable whose updates by parallel strands are combined by a
+ *  monoid
+ *
+ * The monoid is an object that provides:
+ *   - `value_type`
+ *   - `void identity(value_type& v) const`: sets `v`, which is default
+ *     constructed, to the identity of the monoid
+ *   - `void reduce(value_type& left, value_type& right) const`: sets
+ *     `left` to the combination of `left` with `right`, in this order
+ *
+ * The strand that constructs a reducer owns its leftmost view, which
+ * `get()` returns once all the branches that accessed the reducer have
+ * joined. The other strands access their view with `view()`, which
+ * costs a lookup in the view map of the strand.
+ *
+ * Only the branches of `fork2` (and thus of `parallel_for`, `combine`
+ * and `forkjoin`), the body of `finish` and the threads promoted by
+ * heartbeat mode take part in the reduction: the updates made by a
+ * thread created by `async` or `spawn_future` are lost.
+ */
+template <class Monoid>
+class reducer {
+public:
+
+  using monoid_type = Monoid;
+  using value_type = typename Monoid::value_type;
+
+private:
+
+  class view_type : public view_base {
+  public:
+    const Monoid& monoid;
+    value_type value;
+
+    view_type(const Monoid& monoid) : monoid(monoid) { }
+
+    void reduce(view_base* right) {
+      monoid.reduce(value, ((view_type*)right)->value);
+    }
+  };
+
+  const int id;
+  Monoid monoid;
+  view_type leftmost;
+
+public:
+
+  reducer(const Monoid& monoid = Monoid())
+  : id(new_id()), monoid(monoid), leftmost(this->monoid) {
+    this->monoid.identity(leftmost.value);
+    view_map*& views = my_views();
+    if (views == nullptr)
+      views = new view_map;
+    views->insert(id, &leftmost);
+  }
+
+  reducer(const value_type& v, const Monoid& monoid = Monoid())
+  : reducer(monoid) {
+    leftmost.value = v;
+  }
+
+  reducer(const reducer&) = delete;
+  reducer& operator=(const reducer&) = delete;
+
+  // to be called by the strand that constructed the reducer
+  ~reducer() {
+    view_map* views = my_views();
+    assert(views != nullptr && views->find(id) == &leftmost);
+    views->remove(id);
+    delete_id(id);
+  }
+
+  //! Returns the view of the calling strand
+  value_type& view() {
+    view_map*& views = my_views();
+    if (views == nullptr)
+      views = new view_map;
+    view_base* v = views->find(id);
+    if (v == nullptr) {
+      view_type* w = new view_type(monoid);
+      monoid.identity(w->value);
+      views->insert(id, w);
+      v = w;
+    }
+    return ((view_type*)v)->value;
+  }
+
+  //! Returns the leftmost view
+  value_type& get() {
+    return leftmost.value;
+  }
+
+  void set(const value_type& v) {
+    leftmost.value = v;
+  }
+
+};
+
+/*---------------------------------------------------------------------*/
+/* Monoids */
+
+namespace monoid {
+
+template <class T>
+class sum {
+public:
+  using value_type = T;
+  void identity(T& v) const { v = T(0); }
+  void reduce(T& left, T& right) const { left += right; }
+};
+
+template <class T>
+class min {
+public:
+  using value_type = T;
+  void identity(T& v) const { v = std::numeric_limits<T>::max(); }
+  void reduce(T& left, T& right) const { if (right < left) left = right; }
+};
+
+template <class T>
+class max {
+public:
+  using value_type = T;
+  void identity(T& v) const { v = std::numeric_limits<T>::lowest(); }
+  void reduce(T& left, T& right) const { if (left < right) left = right; }
+};
+
+//! Appends the right container to the left one (e.g., `pcontainer::bag`)
+template <class Container>
+class concat {
+public:
+  using value_type = Container;
+  void identity(Container& v) const { }
+  void reduce(Container& left, Container& right) const { left.concat(right); }
+};
+
+//! Buffers the text written by a strand, in the order of the sequential execution
+class ostream {
+public:
+  using value_type = std::ostringstream;
+  void identity(std::ostringstream& v) const { }
+  void reduce(std::ostringstream& left, std::ostringstream& right) const {
+    left << right.str();
+  }
+};
+
+} // end namespace
+
+template <class T>
+using sum = reducer<monoid::sum<T>>;
+
+template <class T>
+using min = reducer<monoid::min<T>>;
+
+template <class T>
+using max = reducer<monoid::max<T>>;
+
+template <class Container>
+using concat = reducer<monoid::concat<Container>>;
+
+/*! \class ostream
+ *  \brief Writes to `out`, on destruction, the text written to the
+ *  views of the reducer, in the order of the sequential execution
+ */
+class ostream : public reducer<monoid::ostream> {
+private:
+  std::ostream& out;
+public:
+  ostream(std::ostream& out) : out(out) { }
+  ~ostream() {
+    out << get().str();
+  }
+};
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_SCHED_REDUCER_H_ */
@@ -2,6 +2,7 @@
 #include "tls.hpp"
 #include "scheduler.hpp"
 #include "messagestrategy.hpp"
+#include "hwcounters.hpp"
 
 namespace pasl {
 namespace sched {
@@ -21,14 +22,18 @@ bool _private::stay() {
 
 void _private::init() { 
   controller_t::init();
-  //add_periodic(messagestrategy::the_messagestrategy);
+  if (messagestrategy::the_messagestrategy != NULL)
+    add_background(messagestrategy::the_messagestrategy);
   current_thread = nullptr;
   should_communicate = false;
+  util::hwcounters::open_mine();
 }
 
 void _private::destroy() {
+  util::hwcounters::close_mine();
   controller_t::destroy();
-  //rem_periodic(messagestrategy::the_messagestrategy);
+  if (messagestrategy::the_messagestrategy != NULL)
+    rem_background(messagestrategy::the_messagestrategy);
 }
 
 void _private::new_launch() {
@@ -41,11 +46,13 @@ void _private::enter_wait() {
   STAT_COUNT(ENTER_WAIT);
  // STAT_IDLE_ONLY(date_enter_wait = ticks::now());
    STAT_IDLE_ONLY(date_enter_wait = util::microtime::now());
+  util::hwcounters::enter_phase(util::hwcounters::PHASE_WAITING);
   util::worker::controller_t::enter_wait();
 }
   
 void _private::exit_wait() {
   util::worker::controller_t::exit_wait();
+  util::hwcounters::enter_phase(util::hwcounters::PHASE_WORKING);
   //STAT_IDLE(add_to_idle_time(ticks::seconds_since(date_enter_wait)));
   //debug: atomic::aprintf("%f\n", microtime::seconds_since(date_enter_wait));
   STAT_IDLE(add_to_idle_time(util::microtime::seconds_since(date_enter_wait)));
@@ -78,7 +85,13 @@ void _private::exec(thread_p t) {
   if (interrupt_was_blocked)
     check_on_interrupt();
   allow_interrupt = true;
-  t->exec();
+  /* a thread of a cancelled scope that has not started is dropped;
+   * its outstrategy still runs below, to release its join point */
+  if (t->is_cancelled() && ! t->has_started()) {
+    STAT_COUNT(THREAD_CANCEL);
+  } else {
+    t->exec();
+  }
   allow_interrupt = false;
 #ifdef TRACK_LOCALITY
   LOG_EVENT(LOCALITY, new util::logging::locality_event_t(logging::LOCALITY_STOP, t->locality.hi));
@@ -95,6 +108,9 @@ void _private::exec(thread_p t) {
 }
 
 void _private::add_thread(thread_p t) {
+  // a new thread belongs to the cancellable scope of its creator
+  if (t->cancel_token == nullptr && current_thread != nullptr)
+    t->cancel_token = current_thread->cancel_token;
   instrategy::init(t->in, t);
   LOG_THREAD(THREAD_CREATE, t);
   STAT_COUNT(THREAD_CREATE);
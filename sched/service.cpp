@@ -0,0 +1,185 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file service.cpp
+ *
+ */
+
+#include <pthread.h>
+
+#include "service.hpp"
+#include "threaddag.hpp"
+#include "native.hpp"
+#include "machine.hpp"
+
+namespace pasl {
+namespace sched {
+namespace service {
+
+/***********************************************************************/
+
+void handle::wait() {
+  while (! done.load()) {
+    int key = completed.prepare_wait();
+    if (done.load()) {
+      completed.cancel_wait();
+      return;
+    }
+    completed.commit_wait(key, 1000.);
+  }
+}
+
+/* The eventcount is aligned on a cache line, which the plain `new` of
+ * C++14 does not honor. */
+handle* handle::create() {
+  void* p = util::machine::alloc_near_worker(util::worker::undef, sizeof(handle));
+  return new (p) handle();
+}
+
+/* The waiter may see `done` and release its reference before the
+ * notification, which is why the completer holds a reference of its
+ * own until then. */
+void handle::complete() {
+  done.store(true);
+  completed.notify_all();
+  release();
+}
+
+void handle::release() {
+  if (nb_refs.fetch_sub(1) > 1)
+    return;
+  this->~handle();
+  util::machine::free_near_worker(this);
+}
+
+/*---------------------------------------------------------------------*/
+/* Submission queue */
+
+/* Allocated with the global `operator new`, and not with the slab
+ * allocator, because the submitting OS thread need not be a worker. */
+typedef struct request_struct {
+  std::function<void()> body;
+  handle_p h;
+  struct request_struct* next;
+} request_type;
+
+/* Multiple-producer single-consumer queue: producers push on a
+ * lock-free stack, and the consumer (worker 0) detaches the whole
+ * stack in one step and reverses it, so that the requests start in
+ * submission order. */
+class injection_queue {
+private:
+  std::atomic<request_type*> head;
+
+public:
+  injection_queue() : head(NULL) { }
+
+  void push(request_type* r) {
+    r->next = head.load();
+    while (! head.compare_exchange_weak(r->next, r));
+  }
+
+  request_type* pop_all() {
+    request_type* r = head.exchange(NULL);
+    request_type* reversed = NULL;
+    while (r != NULL) {
+      request_type* next = r->next;
+      r->next = reversed;
+      reversed = r;
+      r = next;
+    }
+    return reversed;
+  }
+
+  bool empty() const {
+    return head.load() == NULL;
+  }
+};
+
+static injection_queue the_queue;
+static std::atomic<long> nb_in_flight;
+static std::atomic<bool> stopping;
+static pthread_t service_thread;
+
+/*---------------------------------------------------------------------*/
+
+//! Outstrategy of a root task
+class completion : public outstrategy::common {
+private:
+  handle_p h;
+
+public:
+  completion(handle_p h) : h(h) { }
+
+  void add(thread_p) {
+    util::atomic::die("completion: a root task has no out edges");
+  }
+
+  void finished() {
+    nb_in_flight--;
+    h->complete();
+    common::finished();
+  }
+};
+
+//! Periodic check of worker 0 that starts the submitted root tasks
+class injector : public util::worker::periodic_t {
+public:
+  void check() {
+    request_type* r = the_queue.pop_all();
+    while (r != NULL) {
+      request_type* next = r->next;
+      std::function<void()> body = r->body;
+      thread_p t = native::new_multishot_by_lambda([body] { body(); });
+      t->set_instrategy(instrategy::ready_new());
+      t->set_outstrategy(new completion(r->h));
+      threaddag::add_thread(t);
+      delete r;
+      r = next;
+    }
+    if (stopping.load() && the_queue.empty() && nb_in_flight.load() == 0) {
+      threaddag::my_sched()->rem_periodic(this);
+      util::worker::the_group.request_exit_worker0();
+    }
+  }
+};
+
+static injector the_injector;
+
+static void* service_main(void*) {
+  threaddag::init();
+  threaddag::my_sched()->add_periodic(&the_injector);
+  util::worker::the_group.run_worker0();
+  threaddag::destroy();
+  return NULL;
+}
+
+/*---------------------------------------------------------------------*/
+
+void start() {
+  nb_in_flight.store(0);
+  stopping.store(false);
+  if (pthread_create(&service_thread, NULL, service_main, NULL) != 0)
+    util::atomic::die("service: failed to create the service thread\n");
+}
+
+void stop() {
+  stopping.store(true);
+  pthread_join(service_thread, NULL);
+}
+
+handle_p submit(const std::function<void()>& body) {
+  request_type* r = new request_type;
+  r->body = body;
+  r->h = handle::create();
+  nb_in_flight++;
+  the_queue.push(r);
+  return r->h;
+}
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
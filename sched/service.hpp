@@ -0,0 +1,99 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file service.hpp
+ * \brief Persistent scheduler that accepts root tasks from any
+ * OS thread
+ *
+ */
+
+#ifndef _PASL_SCHED_SERVICE_H_
+#define _PASL_SCHED_SERVICE_H_
+
+#include <atomic>
+#include <functional>
+
+#include "futex.hpp"
+
+namespace pasl {
+namespace sched {
+namespace service {
+
+/***********************************************************************/
+
+/*! \class handle
+ *  \brief Completion handle of a root task
+ *
+ * A handle is shared by the caller of `submit()` and by the worker
+ * that completes the root task, each of which holds one reference and
+ * drops it by `release()`; the last one to do so frees the handle.
+ * The caller must not use the handle after its own `release()`, but
+ * may release it at any time, e.g., before the root task completes.
+ */
+class handle {
+private:
+  std::atomic<bool> done;
+  std::atomic<int> nb_refs;
+  util::futex::eventcount completed;
+
+public:
+  handle() : done(false), nb_refs(2) { }
+
+  //! Returns a new handle, whose two references are held by its caller
+  static handle* create();
+
+  bool is_done() const {
+    return done.load();
+  }
+
+  //! Blocks the calling OS thread until the root task completes
+  void wait();
+
+  //! To be called once, by the worker that completes the root task
+  void complete();
+
+  //! Drops one reference; frees the handle if it was the last one
+  void release();
+};
+
+typedef handle* handle_p;
+
+/*---------------------------------------------------------------------*/
+
+/*! \brief Starts the workers, which stay up until `stop()`
+ *
+ * The scheduler is initialized by a new OS thread, which becomes
+ * worker 0 and runs the scheduler loop until `stop()`. The command
+ * line must have been set beforehand (see `util::cmdline::set`).
+ *
+ * Command-line parameters are those of `threaddag::init()`. Worker 0
+ * polls the submission queue every `-delta` microseconds, and does
+ * not park while the service is up.
+ */
+void start();
+
+/*! \brief Waits for the root tasks that were submitted to complete,
+ *  then tears down the scheduler
+ *
+ * Must not be called concurrently with `submit()`.
+ */
+void stop();
+
+/*! \brief Submits a root task, which runs `body` on a native thread
+ *
+ * Thread safe and lock free; may be called by any OS thread, PASL
+ * worker or not. Root tasks that are in flight at the same time run
+ * concurrently and share the workers.
+ * \return the handle of the root task, of which the caller must drop
+ * its reference by `release()`
+ */
+handle_p submit(const std::function<void()>& body);
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_SCHED_SERVICE_H_ */
@@ -0,0 +1,123 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file slab.cpp
+ *
+ */
+
+#include <stdlib.h>
+#include <new>
+
+#include "slab.hpp"
+#include "pcmdline.hpp"
+#include "stats.hpp"
+
+namespace pasl {
+namespace sched {
+namespace slab {
+
+/***********************************************************************/
+
+/* Precedes each block; its size preserves the 16-byte alignment of
+ * the object that follows. */
+typedef struct {
+  worker_id_t owner;
+  int64_t size_class; // -1 for objects obtained from operator new
+} header_type;
+
+static_assert(sizeof(header_type) == slab::block_granularity_szb,
+              "bogus slab header size");
+
+static inline header_type* header_of(void* p) {
+  return (header_type*)p - 1;
+}
+
+/*---------------------------------------------------------------------*/
+
+// the free lists start empty because `the_slab` has static storage
+slab::slab() : enabled(false), chunk_szb(0) { }
+
+void slab::init() {
+  enabled = util::cmdline::parse_or_default_bool("slab", true, false);
+  chunk_szb = (size_t) util::cmdline::parse_or_default_int("slab_chunk_szb", 1<<16, false);
+  if (chunk_szb < max_block_szb + sizeof(header_type))
+    util::atomic::die("slab: chunk size %ld is too small\n", (long)chunk_szb);
+}
+
+void slab::destroy() {
+  enabled = false;
+}
+
+void* slab::alloc_from_chunk(cache_type& c, size_class_type& sc, size_t block_szb) {
+  if (sc.bump + block_szb > sc.bump_end) {
+    char* chunk = (char*)malloc(chunk_szb);
+    if (chunk == NULL)
+      throw std::bad_alloc();
+    c.chunks.push_back(chunk);
+    sc.bump = chunk;
+    sc.bump_end = chunk + chunk_szb;
+  }
+  void* b = sc.bump;
+  sc.bump += block_szb;
+  return b;
+}
+
+void* slab::alloc(size_t szb) {
+  worker_id_t my_id = util::worker::get_my_id();
+  size_t block_szb = sizeof(header_type) + szb;
+  header_type* h;
+  if (! enabled || my_id == util::worker::undef || block_szb > max_block_szb) {
+    h = (header_type*)::operator new(block_szb);
+    h->owner = util::worker::undef;
+    h->size_class = -1;
+    return h + 1;
+  }
+  int64_t k = (block_szb - 1) / block_granularity_szb;
+  block_szb = (k + 1) * block_granularity_szb;
+  cache_type& c = caches[my_id];
+  size_class_type& sc = c.classes[k];
+  if (sc.local == NULL && sc.remote.load() != NULL)
+    sc.local = sc.remote.exchange(NULL);
+  if (sc.local != NULL) {
+    STAT_COUNT(SLAB_HIT);
+    h = (header_type*)sc.local;
+    sc.local = sc.local->next;
+  } else {
+    STAT_COUNT(SLAB_MISS);
+    h = (header_type*)alloc_from_chunk(c, sc, block_szb);
+  }
+  h->owner = my_id;
+  h->size_class = k;
+  return h + 1;
+}
+
+void slab::free(void* p) {
+  if (p == NULL)
+    return;
+  header_type* h = header_of(p);
+  if (h->size_class < 0) {
+    ::operator delete(h);
+    return;
+  }
+  size_class_type& sc = caches[h->owner].classes[h->size_class];
+  free_block_type* b = (free_block_type*)h;
+  if (h->owner == util::worker::get_my_id()) {
+    b->next = sc.local;
+    sc.local = b;
+  } else {
+    STAT_COUNT(SLAB_REMOTE_FREE);
+    free_block_type* head = sc.remote.load();
+    do {
+      b->next = head;
+    } while (! sc.remote.compare_exchange_weak(head, b));
+  }
+}
+
+slab the_slab;
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
@@ -0,0 +1,124 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file slab.hpp
+ * \brief Per-worker slab allocator for threads, instrategies and
+ * outstrategies
+ *
+ */
+
+#ifndef _PASL_SCHED_SLAB_H_
+#define _PASL_SCHED_SLAB_H_
+
+#include <atomic>
+#include <vector>
+
+#include "workerlocal.hpp"
+
+namespace pasl {
+namespace sched {
+namespace slab {
+
+/***********************************************************************/
+
+/*! \class slab
+ *  \brief Allocator of the small, short-lived objects of the scheduler
+ *
+ * Each worker owns one free list per size class (multiples of 16
+ * bytes, up to `max_block_szb`). Blocks are carved from chunks that
+ * the worker obtains from `malloc`. A block freed by its owner goes
+ * back to the owner's free list; a block freed by another worker is
+ * pushed on the remote-free list of the owner, which the owner takes
+ * over in one step when its own list runs dry. Each block is preceded
+ * by a 16-byte header that records its owner and its size class.
+ *
+ * Larger objects, and objects allocated by threads that are not
+ * workers, go to the global `operator new`. Chunks are kept until the
+ * process exits, so that objects that outlive `destroy()` can still
+ * be freed.
+ *
+ * Command-line parameters:
+ *   - `-slab <bool>` (default=1) if false, all objects go to the
+ *      global `operator new`
+ *   - `-slab_chunk_szb <int>` (default=65536)
+ *
+ * Compiling with `-DDISABLE_SLAB` removes the allocator altogether,
+ * which is useful to track memory errors with external tools.
+ */
+class slab {
+public:
+
+  static constexpr int block_granularity_szb = 16;
+  static constexpr int max_block_szb = 1024;
+  static constexpr int nb_size_classes = max_block_szb / block_granularity_szb;
+
+private:
+
+  typedef struct free_block_struct {
+    struct free_block_struct* next;
+  } free_block_type;
+
+  typedef struct {
+    free_block_type* local;                // accessed by the owner only
+    std::atomic<free_block_type*> remote;  // blocks freed by other workers
+    char* bump;                            // remaining space in the last chunk
+    char* bump_end;
+  } size_class_type;
+
+  typedef struct {
+    size_class_type classes[nb_size_classes];
+    std::vector<char*> chunks;
+  } cache_type;
+
+  data::perworker::extra<cache_type> caches;
+
+  bool enabled;
+  size_t chunk_szb;
+
+  void* alloc_from_chunk(cache_type& c, size_class_type& sc, size_t block_szb);
+
+public:
+
+  slab();
+
+  void init();
+  void destroy();
+
+  void* alloc(size_t szb);
+  void free(void* p);
+
+};
+
+extern slab the_slab;
+
+/*---------------------------------------------------------------------*/
+
+/*! \class allocated
+ *  \brief Routes the allocations of the objects of the derived
+ *  classes to `the_slab`
+ *
+ * Classes that derive from this one must be deleted through a
+ * pointer to a base class that has a virtual destructor, so that
+ * `operator delete` applies to the whole object.
+ */
+class allocated {
+public:
+#ifndef DISABLE_SLAB
+  void* operator new (size_t size) {
+    return the_slab.alloc(size);
+  }
+
+  void operator delete (void* p) {
+    the_slab.free(p);
+  }
+#endif
+};
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_SCHED_SLAB_H_ */
@@ -0,0 +1,300 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file snzi.hpp
+ * \brief Scalable non-zero indicator (SNZI) and the corresponding
+ * in- and outstrategies
+ *
+ */
+
+#ifndef _PASL_SCHED_SNZI_H_
+#define _PASL_SCHED_SNZI_H_
+
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+#include "instrategy.hpp"
+#include "outstrategy.hpp"
+
+namespace pasl {
+namespace data {
+namespace snzi {
+
+/***********************************************************************/
+
+/*! \class tree
+ *  \brief Scalable non-zero indicator
+ *
+ * Implements the hierarchical SNZI of Ellen, Lev, Luchangco and Moir
+ * (PODC 2007), on a complete binary tree stored in heap layout: node
+ * 1 is the root, and the children of node `i` are `2i` and `2i+1`.
+ * Each worker arrives at its own leaf, so that concurrent arrivals and
+ * departures on distinct leaves touch distinct cache lines; a node
+ * arrives at or departs from its parent only when its own surplus
+ * changes from zero to nonzero or back. The root is a plain counter.
+ *
+ * A departure must be made from the node at which the matching
+ * arrival was made, although not necessarily by the same worker.
+ */
+class tree {
+public:
+
+  typedef int node_id_type;
+
+  static const node_id_type root_id = 1;
+
+private:
+
+  /* The state of a non-root node packs a version number (high 32 bits)
+   * and a counter in units of one half (low 32 bits), so that the
+   * intermediate value 1/2 of the original algorithm is represented
+   * by 1. */
+  typedef uint64_t state_type;
+  static const uint64_t half = 1;
+  static const uint64_t one = 2;
+
+  typedef struct {
+    std::atomic<state_type> state;
+    int padding[56/4];
+  } node_type;
+
+  typedef struct {
+    std::atomic<int64_t> surplus;
+    int padding[56/4];
+  } root_type;
+
+  root_type root;
+  node_type* nodes;
+  int nb_leaves;
+
+  static uint64_t counter_of(state_type x) {
+    return x & 0xffffffffull;
+  }
+
+  static uint64_t version_of(state_type x) {
+    return x >> 32;
+  }
+
+  static state_type make(uint64_t counter, uint64_t version) {
+    return ((version & 0xffffffffull) << 32) | counter;
+  }
+
+  static node_id_type parent_of(node_id_type id) {
+    return id / 2;
+  }
+
+  bool cas(node_id_type id, state_type old_state, state_type new_state) {
+    return nodes[id].state.compare_exchange_strong(old_state, new_state);
+  }
+
+public:
+
+  /*! \param nb_workers number of workers; the tree gets the smallest
+   *  power of two not less than `nb_workers` leaves
+   */
+  tree(int nb_workers) {
+    nb_leaves = 1;
+    while (nb_leaves < nb_workers)
+      nb_leaves *= 2;
+    root.surplus.store(0);
+    nodes = NULL;
+    if (nb_leaves == 1)
+      return;
+    // each node on its own cache line, which `new` does not ensure
+    void* p = NULL;
+    if (posix_memalign(&p, 64, 2 * nb_leaves * sizeof(node_type)) != 0)
+      util::atomic::die("snzi: out of memory\n");
+    nodes = (node_type*)p;
+    for (int i = 0; i < 2 * nb_leaves; i++) {
+      new (&nodes[i]) node_type;
+      nodes[i].state.store(make(0, 0));
+    }
+  }
+
+  ~tree() {
+    if (nodes != NULL)
+      free(nodes);
+  }
+
+  //! Returns the leaf to be used by the given worker
+  node_id_type leaf_of(worker_id_t id) const {
+    if (nb_leaves == 1)
+      return root_id;
+    if (id == util::worker::undef)
+      id = 0;
+    return nb_leaves + (node_id_type)(id % nb_leaves);
+  }
+
+  void arrive(node_id_type id) {
+    if (id == root_id) {
+      root.surplus++;
+      return;
+    }
+    bool succ = false;
+    int nb_undo_arrivals = 0;
+    while (! succ) {
+      state_type x = nodes[id].state.load();
+      if (counter_of(x) >= one) {
+        if (cas(id, x, make(counter_of(x) + one, version_of(x))))
+          succ = true;
+      } else if (counter_of(x) == 0) {
+        state_type y = make(half, version_of(x) + 1);
+        if (cas(id, x, y)) {
+          succ = true;
+          x = y;
+        }
+      }
+      if (counter_of(x) == half) {
+        arrive(parent_of(id));
+        if (! cas(id, x, make(one, version_of(x))))
+          nb_undo_arrivals++;
+      }
+    }
+    while (nb_undo_arrivals > 0) {
+      depart(parent_of(id));
+      nb_undo_arrivals--;
+    }
+  }
+
+  //! Returns true if the surplus of the whole tree dropped to zero
+  bool depart(node_id_type id) {
+    if (id == root_id)
+      return root.surplus.fetch_sub(1) == 1;
+    while (true) {
+      state_type x = nodes[id].state.load();
+      assert(counter_of(x) >= one);
+      if (cas(id, x, make(counter_of(x) - one, version_of(x)))) {
+        if (counter_of(x) == one)
+          return depart(parent_of(id));
+        return false;
+      }
+    }
+  }
+
+  bool is_nonzero() const {
+    return root.surplus.load() > 0;
+  }
+
+};
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+
+namespace sched {
+namespace instrategy {
+
+/***********************************************************************/
+
+/*! \class snzi
+ *  \brief The join counter is a scalable non-zero indicator.
+ *
+ * Suited to threads with a high fan-in, such as the continuation of a
+ * `finish` block: the threads that join into the continuation arrive
+ * at the leaf of the worker that creates them (see `arrive()`), and
+ * their outstrategy departs from the same leaf on completion (see
+ * `outstrategy::snzi_edge`). Dependencies that are added by `delta()`,
+ * and not by `arrive()`, go directly to the root.
+ *
+ * \ingroup instrategy
+ */
+class snzi : public common {
+protected:
+
+  data::snzi::tree tree;
+
+public:
+
+  typedef data::snzi::tree::node_id_type node_id_type;
+
+  snzi() : tree(util::worker::get_nb()) { }
+
+  void check(thread_p t) {
+    if (! tree.is_nonzero())
+      start(t);
+  }
+
+  void delta(thread_p t, int64_t d) {
+    for (; d > 0; d--)
+      tree.arrive(data::snzi::tree::root_id);
+    for (; d < 0; d++)
+      if (tree.depart(data::snzi::tree::root_id))
+        start(t);
+  }
+
+  //! Adds one dependency, and returns the node to depart from
+  node_id_type arrive() {
+    node_id_type id = tree.leaf_of(util::worker::get_my_id());
+    tree.arrive(id);
+    return id;
+  }
+
+  //! Removes the dependency that arrived at node `id`
+  void depart(thread_p t, node_id_type id) {
+    if (tree.depart(id))
+      start(t);
+  }
+
+  //! Returns `in` as an SNZI instrategy, or NULL if it is not one
+  static snzi* of(instrategy_p in) {
+    if (in == NULL || extract_tag(in) != 0)
+      return NULL;
+    return dynamic_cast<snzi*>(in);
+  }
+
+};
+
+/***********************************************************************/
+
+} // end namespace
+
+namespace outstrategy {
+
+/***********************************************************************/
+
+/*! \class snzi_edge
+ *  \brief Outstrategy of a thread that joins into a thread whose
+ *  instrategy is `instrategy::snzi`
+ *
+ * Remembers the SNZI node at which the thread arrived.
+ *
+ * \ingroup outstrategy
+ */
+class snzi_edge : public common {
+protected:
+
+  instrategy::snzi* in;
+  thread_p target;
+  instrategy::snzi::node_id_type node;
+
+public:
+
+  snzi_edge(instrategy::snzi* in, thread_p target,
+            instrategy::snzi::node_id_type node)
+    : in(in), target(target), node(node) { }
+
+  void add(thread_p td) {
+    util::atomic::die("snzi_edge: the target is fixed at creation");
+  }
+
+  void finished() {
+    in->depart(target, node);
+    common::finished();
+  }
+
+  void copy_edgelist(edgelist_t& vec) {
+    vec.push_back(target);
+  }
+
+};
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_SCHED_SNZI_H_ */
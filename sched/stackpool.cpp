@@ -0,0 +1,115 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file stackpool.cpp
+ *
+ */
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include "stackpool.hpp"
+#include "control.hpp"
+#include "pcmdline.hpp"
+#include "stats.hpp"
+
+namespace pasl {
+namespace sched {
+namespace stackpool {
+
+/***********************************************************************/
+
+stackpool::stackpool()
+  : enabled(false), stack_szb(util::control::thread_stack_szb),
+    guard_szb(0), cache_depth(0), high_water(0) { }
+
+void stackpool::init() {
+  enabled = util::cmdline::parse_or_default_bool("stack_pool", true, false);
+  size_t page_szb = (size_t) sysconf(_SC_PAGESIZE);
+  size_t szb = (size_t) util::cmdline::parse_or_default_int("stack_szb",
+                                         util::control::thread_stack_szb, false);
+  // round up to a whole number of pages
+  stack_szb = ((szb + page_szb - 1) / page_szb) * page_szb;
+  guard_szb = page_szb;
+  cache_depth = util::cmdline::parse_or_default_int("stack_cache_depth", 64, false);
+  high_water = util::cmdline::parse_or_default_int("stack_high_water", 8, false);
+  high_water = std::min(high_water, cache_depth);
+}
+
+void stackpool::destroy() {
+  caches.for_each([&] (worker_id_t, caches_type& c) {
+    for (char* stack : c.hot)
+      unmap_stack(stack);
+    for (char* stack : c.cold)
+      unmap_stack(stack);
+    c.hot.clear();
+    c.cold.clear();
+  });
+}
+
+char* stackpool::map_stack() {
+  size_t szb = guard_szb + stack_szb;
+  void* p = mmap(NULL, szb, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED)
+    util::atomic::die("stackpool: failed to map a stack of %ld bytes\n", (long)szb);
+  // stacks grow down, so the guard page goes at the lowest address
+  if (mprotect(p, guard_szb, PROT_NONE) != 0)
+    util::atomic::die("stackpool: failed to protect guard page\n");
+  return (char*)p + guard_szb;
+}
+
+void stackpool::unmap_stack(char* stack) {
+  munmap(stack - guard_szb, guard_szb + stack_szb);
+}
+
+void stackpool::trim_stack(char* stack) {
+  madvise(stack, stack_szb, MADV_DONTNEED);
+}
+
+char* stackpool::alloc() {
+  if (! enabled)
+    return (char*)malloc(stack_szb);
+  caches_type& c = caches.mine();
+  cache_type* src = (! c.hot.empty()) ? &c.hot : &c.cold;
+  if (src->empty()) {
+    STAT_COUNT(STACK_ALLOC);
+    return map_stack();
+  }
+  STAT_COUNT(STACK_REUSE);
+  char* stack = src->back();
+  src->pop_back();
+  return stack;
+}
+
+void stackpool::free(char* stack) {
+  if (! enabled) {
+    ::free(stack);
+    return;
+  }
+  caches_type& c = caches.mine();
+  if ((int)c.hot.size() < high_water) {
+    c.hot.push_back(stack);
+  } else if ((int)(c.hot.size() + c.cold.size()) < cache_depth) {
+    STAT_COUNT(STACK_TRIM);
+    trim_stack(stack);
+    c.cold.push_back(stack);
+  } else {
+    unmap_stack(stack);
+  }
+}
+
+size_t stackpool::get_stack_szb() const {
+  return stack_szb;
+}
+
+stackpool the_stackpool;
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
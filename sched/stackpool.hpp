@@ -0,0 +1,91 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file stackpool.hpp
+ * \brief Per-worker pools of call stacks for multishot threads
+ *
+ */
+
+#ifndef _PASL_SCHED_STACKPOOL_H_
+#define _PASL_SCHED_STACKPOOL_H_
+
+#include <vector>
+
+#include "workerlocal.hpp"
+
+namespace pasl {
+namespace sched {
+namespace stackpool {
+
+/***********************************************************************/
+
+/*! \class stackpool
+ *  \brief Allocator of the call stacks of multishot threads
+ *
+ * Each stack is obtained from `mmap` and sits right above a guard
+ * page, so that a stack overflow faults instead of corrupting
+ * neighboring memory. The OS commits the pages of a fresh stack
+ * lazily, on first touch.
+ *
+ * Each worker caches the stacks that it frees. The cache has two
+ * levels: the first `high_water` stacks are kept as they are; the
+ * following ones, up to a total of `cache_depth` stacks, have their
+ * pages returned to the OS with `madvise(MADV_DONTNEED)` (we say that
+ * they are trimmed). Stacks that do not fit in the cache are
+ * unmapped. Allocation prefers untrimmed stacks.
+ *
+ * Command-line parameters:
+ *   - `-stack_pool <bool>` (default=1) if false, stacks are
+ *      allocated by `malloc`
+ *   - `-stack_szb <int>` (default=`util::control::thread_stack_szb`)
+ *   - `-stack_cache_depth <int>` (default=64)
+ *   - `-stack_high_water <int>` (default=8)
+ */
+class stackpool {
+private:
+
+  using cache_type = std::vector<char*>;
+
+  typedef struct {
+    cache_type hot;   // stacks whose pages are possibly committed
+    cache_type cold;  // trimmed stacks
+  } caches_type;
+
+  data::perworker::extra<caches_type> caches;
+
+  bool enabled;
+  size_t stack_szb;
+  size_t guard_szb;
+  int cache_depth;
+  int high_water;
+
+  char* map_stack();
+  void unmap_stack(char* stack);
+  void trim_stack(char* stack);
+
+public:
+
+  stackpool();
+
+  void init();
+  void destroy();
+
+  //! Returns the lowest address of a stack of `get_stack_szb()` bytes
+  char* alloc();
+  //! Releases a stack obtained from `alloc()`
+  void free(char* stack);
+
+  size_t get_stack_szb() const;
+
+};
+
+extern stackpool the_stackpool;
+
+/***********************************************************************/
+
+} // end namespace
+} // end namespace
+} // end namespace
+
+#endif /*! _PASL_SCHED_STACKPOOL_H_ */
@@ -27,6 +27,8 @@ void stats_data_t::reset() {
   waiting_time = 0.0;
   sequential_time = 0.0;
   spinning_time = 0.0;
+  parked_time = 0.0;
+  wakeup_latency = 0.0;
   for (int i = 0; i < NB_STATS; i++)
     counters[i] = 0;
 }
@@ -52,6 +54,14 @@ void stats_private_t::add_to_spinning_time(double elapsed) {
   data.spinning_time += elapsed;
 }
 
+void stats_private_t::add_to_parked_time(double elapsed) {
+  data.parked_time += elapsed;
+}
+
+void stats_private_t::add_to_wakeup_latency(double elapsed) {
+  data.wakeup_latency += elapsed;
+}
+
 /*---------------------------------------------------------------------*/
 
 stats_t::stats_t() { 
@@ -83,6 +93,8 @@ void stats_t::sum() {
     for (/*stat_type_t*/ int stat_type = 0; stat_type < NB_STATS; stat_type++)
       total_data.counters[stat_type] += local_data.counters[stat_type];
     total_data.spinning_time += local_data.spinning_time;
+    total_data.parked_time += local_data.parked_time;
+    total_data.wakeup_latency += local_data.wakeup_latency;
   }
   double cumulated_time = launch_duration * nb_workers;
   total_idle_time = total_data.waiting_time;
@@ -95,12 +107,27 @@ void stats_t::sum() {
     average_sequentialized = 1000000. * total_data.sequential_time / nb_measured_run; 
   else
     average_sequentialized = -1.;
+  // fraction of the cumulated time that idle workers spent burning cycles
+  total_parked_time = total_data.parked_time;
+  idle_cpu = (total_idle_time - total_parked_time) / cumulated_time;
+  uint64_t nb_unpark = total_data.counters[UNPARK];
+  if (nb_unpark > 0)
+    average_wakeup_latency = total_data.wakeup_latency / nb_unpark;
+  else
+    average_wakeup_latency = -1.;
+  uint64_t nb_slab_alloc = total_data.counters[SLAB_HIT] + total_data.counters[SLAB_MISS];
+  if (nb_slab_alloc > 0)
+    slab_hit_rate = (double) total_data.counters[SLAB_HIT] / nb_slab_alloc;
+  else
+    slab_hit_rate = -1.;
 }
 
 // assumes sums have been computed
 void stats_t::print_idle(FILE* f) {
   // fprintf(f, "total_idle_time %.3lf\n", total_idle_time);
   fprintf(f, "utilization %.4lf\n", utilization);
+  if (total_parked_time > 0.)
+    fprintf(f, "idle_cpu %.4lf\n", idle_cpu);
 }
 
 void stats_t::print(FILE* f) {
@@ -128,6 +155,33 @@ void stats_t::print(FILE* f) {
               (long)total_data.counters[i]);
     }
   }
+  if (total_data.counters[PARK] > 0) {
+    fprintf(f, "total_parked_time\t%.3lf\n", total_parked_time);
+    fprintf(f, "idle_cpu\t%.4lf\n", idle_cpu);
+    fprintf(f, "average_wakeup_latency\t%.3lf\n", average_wakeup_latency);
+  }
+  if (slab_hit_rate >= 0.)
+    fprintf(f, "slab_hit_rate\t%.4lf\n", slab_hit_rate);
+  if (total_data.counters[STEAL_FAIL] > 0 && total_data.counters[THREAD_SEND] > 0)
+    fprintf(f, "steal_fail_per_steal\t%.3lf\n",
+            (double) total_data.counters[STEAL_FAIL] / total_data.counters[THREAD_SEND]);
+  if (cmdline::parse_or_default_bool("stats_per_worker", false, false))
+    print_per_worker(f);
+}
+
+// prints, for each worker, the counters that are not zero
+void stats_t::print_per_worker(FILE* f) {
+  int64_t nb_workers = worker::get_nb();
+  for (int64_t id = worker::undef; id < nb_workers; id++) {
+    stats_data_t& local_data = stats[id].data;
+    for (int i = 0; i < NB_STATS; i++) {
+      if (local_data.counters[i] == 0)
+        continue;
+      fprintf(f, "worker_%ld_%s\t%ld\n", (long)id,
+              name_of_type((stat_type_t) i).c_str(),
+              (long)local_data.counters[i]);
+    }
+  }
 }
 
 void stats_t::dump(FILE* f) {
@@ -183,6 +237,15 @@ void stats_t::add_to_spinning_time(double elapsed) {
   get_my_stats().add_to_spinning_time(elapsed);
 }
 
+void stats_t::add_to_parked_time(double elapsed) {
+  if (launch_finished) return;
+  get_my_stats().add_to_parked_time(elapsed);
+}
+
+void stats_t::add_to_wakeup_latency(double elapsed) {
+  get_my_stats().add_to_wakeup_latency(elapsed);
+}
+
 /*---------------------------------------------------------------------*/
 
 stats_t the_stats;
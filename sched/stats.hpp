@@ -37,6 +37,7 @@ typedef enum {
   THREAD_RECOVER,
   THREAD_SPLIT,
   MSG_SEND,
+  MSG_OVERFLOW,
   COMMUNICATE,
   INTERRUPT,
   ENTER_WAIT,
@@ -55,6 +56,23 @@ typedef enum {
   WAITED_TO_COMPLETE_OFFER,
   WATCH,
   // end fencefree
+  PARK,
+  UNPARK,
+  STACK_ALLOC,
+  STACK_REUSE,
+  STACK_TRIM,
+  STEAL_L3,
+  STEAL_NODE,
+  STEAL_REMOTE,
+  THREAD_STEAL_BATCH,
+  SLAB_HIT,
+  SLAB_MISS,
+  SLAB_REMOTE_FREE,
+  HEARTBEAT,
+  THREAD_PROMOTE,
+  STEAL_FAIL,
+  DEACTIVATE,
+  THREAD_CANCEL,
   NB_STATS,
 } stat_type_t;
 
@@ -67,6 +85,7 @@ static inline std::string name_of_type(stat_type_t type) {
     case THREAD_RECOVER: return std::string("thread_recover");
     case THREAD_SPLIT: return std::string("thread_split");
     case MSG_SEND: return std::string("msg_send");
+    case MSG_OVERFLOW: return std::string("msg_overflow");
     case COMMUNICATE: return std::string("communicate");
     case INTERRUPT: return std::string("interrupt");
     case ENTER_WAIT: return std::string("enter_wait");
@@ -83,6 +102,23 @@ static inline std::string name_of_type(stat_type_t type) {
     case RACE_RESOLUTION: return std::string("race_resolution");
     case WATCH: return std::string("watch");
     case WAITED_TO_COMPLETE_OFFER: return std::string("waited_to_complete_offer");
+    case PARK: return std::string("park");
+    case UNPARK: return std::string("unpark");
+    case STACK_ALLOC: return std::string("stack_alloc");
+    case STACK_REUSE: return std::string("stack_reuse");
+    case STACK_TRIM: return std::string("stack_trim");
+    case STEAL_L3: return std::string("steal_l3");
+    case STEAL_NODE: return std::string("steal_node");
+    case STEAL_REMOTE: return std::string("steal_remote");
+    case THREAD_STEAL_BATCH: return std::string("thread_steal_batch");
+    case SLAB_HIT: return std::string("slab_hit");
+    case SLAB_MISS: return std::string("slab_miss");
+    case SLAB_REMOTE_FREE: return std::string("slab_remote_free");
+    case HEARTBEAT: return std::string("heartbeat");
+    case THREAD_PROMOTE: return std::string("thread_promote");
+    case STEAL_FAIL: return std::string("steal_fail");
+    case DEACTIVATE: return std::string("deactivate");
+    case THREAD_CANCEL: return std::string("thread_cancel");
     default: return std::string("unknown");
   }
 }
@@ -95,6 +131,8 @@ public:
   double waiting_time;
   double sequential_time;
   double spinning_time;
+  double parked_time;
+  double wakeup_latency; // microseconds, summed over UNPARK events
 
 public:
   stats_data_t();
@@ -117,6 +155,8 @@ public:
   void add_to_sequential_time(double elapsed);
   void add_to_idle_time(double elapsed);
   void add_to_spinning_time(double elapsed);
+  void add_to_parked_time(double elapsed);
+  void add_to_wakeup_latency(double elapsed);
 };
 
 /*---------------------------------------------------------------------*/
@@ -139,6 +179,10 @@ private:
   double relative_non_seq;
   double average_sequentialized;
   double total_spinning_time;
+  double total_parked_time;
+  double idle_cpu;
+  double average_wakeup_latency;
+  double slab_hit_rate;
 
 public:
   stats_t();
@@ -148,6 +192,7 @@ public:
   void sum();
   void print(FILE* f);
   void print_idle(FILE* f);
+  void print_per_worker(FILE* f);
   void dump(FILE* f);
   stats_private_t& get_my_stats();
   void enter_launch();
@@ -157,6 +202,8 @@ public:
 
   void add_to_idle_time(double elapsed);
   void add_to_spinning_time(double elapsed);
+  void add_to_parked_time(double elapsed);
+  void add_to_wakeup_latency(double elapsed);
 
   // TODO: get rid of these functions by having the STAT macros to call get_my_stat
   void count(stat_type_t type);
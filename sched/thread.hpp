@@ -11,6 +11,8 @@
 #include "localityrange.hpp"
 #include "stats.hpp"
 #include "atomic.hpp"
+#include "slab.hpp"
+#include "cancellation.hpp"
 
 #ifndef _PASL_SCHED_THREAD_H_
 #define _PASL_SCHED_THREAD_H_
@@ -24,7 +26,7 @@ namespace sched {
  *  \brief The basic interface of a thread.
  *  \ingroup thread
  */
-class thread {
+class thread : public slab::allocated {
 public: //! \todo ideally, would be protected
   
   //! instrategy for detecting readiness of the thread
@@ -36,6 +38,11 @@ public: //! \todo ideally, would be protected
   //! true, if this thread should not be deallocated
   bool should_not_deallocate;
   
+  /*! token of the innermost cancellable scope that encloses this
+   * thread, or null; inherited from the thread that creates this one
+   */
+  cancellation::token* cancel_token;
+  
 #ifdef TRACK_LOCALITY
   //! index representing the locality of the thread in the DAG
   data::locality_range_t locality;
@@ -49,7 +56,7 @@ public:
   
   thread(bool should_not_deallocate = false)
   : in(NULL), out(NULL),
-  should_not_deallocate(should_not_deallocate) { }
+  should_not_deallocate(should_not_deallocate), cancel_token(NULL) { }
   
   virtual ~thread() { }
   
@@ -70,6 +77,25 @@ public:
   virtual void run() = 0;
   ///@}
   
+  /** @name Cancellation */
+  
+  ///@{
+  //! True if the scope that encloses the thread has been cancelled
+  bool is_cancelled() const {
+    return cancel_token != NULL && cancel_token->is_cancelled();
+  }
+  
+  /*! \brief Returns true if the body of the thread has been entered
+   *
+   * The scheduler may drop a cancelled thread only if it has not
+   * started. Threads that save their state across several calls to
+   * `exec()`, such as native threads, must override this method.
+   */
+  virtual bool has_started() {
+    return false;
+  }
+  ///@}
+  
   /** @name thread-splitting components (optional) */
   
   ///@{
@@ -119,7 +145,11 @@ public:
   //! Replaces the default "new" operator with ours
   void* operator new (size_t size) {
     STAT_COUNT(THREAD_ALLOC);
+#ifdef DISABLE_SLAB
     return ::operator new(size);
+#else
+    return slab::the_slab.alloc(size);
+#endif
   }
   
   virtual void set_should_not_deallocate(bool should_not_deallocate) {
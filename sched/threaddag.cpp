@@ -15,8 +15,11 @@
 #include "scheduler.hpp"
 #include "workstealing.hpp"
 #include "native.hpp"
+#include "stackpool.hpp"
 #include "instrategy.hpp"
+#include "snzi.hpp"
 #include "outstrategy.hpp"
+#include "hwcounters.hpp"
 
 
 /***********************************************************************/
@@ -39,12 +42,25 @@ util::control::context::context_pointer my_cxt() {
   return context::addr(cxts.mine().cxt);
 }
 
+char* stack_alloc() {
+  return sched::stackpool::the_stackpool.alloc();
+}
+
+void stack_free(char* stack) {
+  sched::stackpool::the_stackpool.free(stack);
+}
+
+size_t stack_szb() {
+  return sched::stackpool::the_stackpool.get_stack_szb();
+}
+
 } // end namespace
 } // end namespace
 
 namespace sched {
 namespace native {
   int loop_cutoff;
+  bool heartbeat_mode;
 
 char multishot::dummy1;
 char multishot::dummy2;
@@ -63,8 +79,22 @@ namespace threaddag {
 /*---------------------------------------------------------------------*/
 /* Defaults for in- and out-strategies */
 
-typedef enum { FETCH_ADD, OPTIMISIC, MESSAGE /*, FENCEFREE_INSTRATEGY */ } instrategy_class_t;
+typedef enum { FETCH_ADD, OPTIMISIC, MESSAGE, SNZI, DISTRIBUTED /*, FENCEFREE_INSTRATEGY */ } instrategy_class_t;
 instrategy_class_t instrategy_class_forkjoin;
+static instrategy_class_t instrategy_class_finish;
+
+static instrategy_class_t instrategy_class_of_string(std::string s) {
+  if (s == "fetch_add")
+    return FETCH_ADD;
+  else if (s == "message")
+    return MESSAGE;
+  else if (s == "snzi")
+    return SNZI;
+  else if (s == "distributed")
+    return DISTRIBUTED;
+  util::atomic::die("bogus instrategy %s\n", s.c_str());
+  return FETCH_ADD;
+}
 
 instrategy_p new_forkjoin_instrategy() {
   instrategy_p in = NULL;
@@ -72,12 +102,24 @@ instrategy_p new_forkjoin_instrategy() {
     //case OPTIMISIC: in = new instrategy::optimistic(); break;
     case FETCH_ADD: in = instrategy::fetch_add_new(); break;
     case MESSAGE: in = new instrategy::message(); break;
+    case SNZI: in = new instrategy::snzi(); break;
     //case FENCEFREE_INSTRATEGY: in = fencefree::select_instrategy(); break;
     default: util::atomic::die("bogus instrategy");
   }
   return in;
 }
 
+instrategy_p new_finish_instrategy(thread_p cont) {
+  instrategy_p in = NULL;
+  switch (instrategy_class_finish) {
+    case DISTRIBUTED: in = new instrategy::distributed(cont); break;
+    case SNZI: in = new instrategy::snzi(); break;
+    case FETCH_ADD: in = instrategy::fetch_add_new(); break;
+    default: util::atomic::die("bogus instrategy");
+  }
+  return in;
+}
+
 typedef enum { UNARY, FENCEFREE_OUTSTRATEGY } outstrategy_class_t;
 static outstrategy_class_t outstrategy_class_forkjoin;
 
@@ -106,6 +148,7 @@ static int init_general_purpose() {
   int nb_workers = util::cmdline::parse_or_default_int("proc", 1, true);
 #endif
   native::loop_cutoff = util::cmdline::parse_or_default_int("loop_cutoff", 10000);
+  native::heartbeat_mode = util::cmdline::parse_or_default_double("heartbeat", 0.) > 0.;
   std::string htmodestr =
     util::cmdline::parse_or_default_string("hyperthreading", "useall", false);
   util::machine::hyperthreading_mode_t htmode = util::machine::htmode_of_string(htmodestr);
@@ -132,15 +175,22 @@ static void init_basic(int nb_workers) {
   bool no0 = util::cmdline::parse_or_default_bool("no0", false, false);
   util::machine::the_bindpolicy.init(nbpe, no0, nb_workers);
   util::machine::the_numa.init(nb_workers);
+  util::machine::the_proximity.init(nb_workers);
   util::worker::the_group.init(nb_workers, &util::machine::the_bindpolicy);
+  stackpool::the_stackpool.init();
+  slab::the_slab.init();
   LOG_ONLY(util::logging::the_recorder.init());
   STAT_IDLE_ONLY(util::stats::the_stats.init());
+  util::hwcounters::init();
 }
 
 static void destroy_basic() {
   LOG_ONLY(util::logging::output());
   LOG_ONLY(util::logging::the_recorder.destroy());
+  util::hwcounters::destroy();
   data::estimator::destroy();
+  stackpool::the_stackpool.destroy();
+  slab::the_slab.destroy();
   util::machine::the_bindpolicy.destroy();
   util::machine::destroy();
 }
@@ -148,7 +198,14 @@ static void destroy_basic() {
 static void init_scheduler() {
   std::string schedulerstr =
   util::cmdline::parse_or_default_string("scheduler", "workstealing", false);
-  instrategy_class_forkjoin = FETCH_ADD;
+  instrategy_class_forkjoin = instrategy_class_of_string(
+    util::cmdline::parse_or_default_string("forkjoin_instrategy", "fetch_add", false));
+  instrategy_class_finish = instrategy_class_of_string(
+    util::cmdline::parse_or_default_string("finish_instrategy", "distributed", false));
+  if (instrategy_class_forkjoin == DISTRIBUTED)
+    util::atomic::die("distributed instrategy is supported only by finish\n");
+  if (instrategy_class_finish == MESSAGE)
+    util::atomic::die("message instrategy is not supported by finish\n");
   outstrategy_class_forkjoin = UNARY;
   if (schedulerstr.compare("workstealing") == 0) {
     std::string tsetstr = util::cmdline::parse_or_default_string("threadset", "cas_ri", false);
@@ -179,13 +236,16 @@ static void destroy_scheduler() {
 }
 
 static void init_messagestrategy() {
-  messagestrategy::the_messagestrategy = new messagestrategy::pcb();
+  messagestrategy::the_messagestrategy = messagestrategy::create_messagestrategy();
   messagestrategy::the_messagestrategy->init();
 }
 
 static void destroy_messagestrategy() {
+  if (messagestrategy::the_messagestrategy == NULL)
+    return;
   messagestrategy::the_messagestrategy->destroy();
   delete messagestrategy::the_messagestrategy;
+  messagestrategy::the_messagestrategy = NULL;
 }
 
 void init() {
@@ -193,6 +253,7 @@ void init() {
   init_basic(nb_workers);
 #ifndef USE_CILK_RUNTIME
   init_scheduler();
+  init_messagestrategy();
 #endif
   util::callback::init();
 #ifdef USE_CILK_RUNTIME
@@ -240,6 +301,7 @@ void destroy() {
   return;
 #endif
   destroy_scheduler();
+  destroy_messagestrategy();
   destroy_basic();
 }
 
@@ -258,6 +320,14 @@ int get_my_id() {
   return (int) util::worker::get_my_id();
 }
 
+void set_nb_active_workers(int nb) {
+  util::worker::the_group.set_nb_active(nb);
+}
+
+int get_nb_active_workers() {
+  return util::worker::the_group.get_nb_active();
+}
+
 /*---------------------------------------------------------------------*/
 /* Basic operations */
 
@@ -298,8 +368,20 @@ static void fork(thread_p thread, thread_p cont, instrategy_p in, outstrategy_p
   add_thread(thread);
 }
 
+/* the thread arrives at the SNZI of `cont` on the leaf of the calling
+ * worker, and its outstrategy records that leaf */
+static void fork_snzi(thread_p thread, thread_p cont, instrategy::snzi* in) {
+  thread->set_instrategy(instrategy::ready_new());
+  thread->set_outstrategy(new outstrategy::snzi_edge(in, cont, in->arrive()));
+  add_thread(thread);
+}
+
 void fork(thread_p thread, thread_p cont, branch_t branch) {
-  fork(thread, cont, instrategy::ready_new(), new_forkjoin_outstrategy(branch));
+  instrategy::snzi* in = instrategy::snzi::of(cont->in);
+  if (in != NULL)
+    fork_snzi(thread, cont, in);
+  else
+    fork(thread, cont, instrategy::ready_new(), new_forkjoin_outstrategy(branch));
 }
 
 void fork(thread_p thread, thread_p cont) {
@@ -345,6 +427,12 @@ future_p create_future(thread_p thread, bool lazy) {
   return future;
 }
 
+void create_future(thread_p thread, future_p future) {
+  thread->set_instrategy(instrategy::ready_new());
+  thread->set_outstrategy(future);
+  add_thread(thread);
+}
+
 void force_future(future_p future, thread_p cont, instrategy_p in) {
   if (future->thread_finished()) {
     continue_with(cont);
@@ -375,8 +463,7 @@ void finish(thread_p thread, thread_p cont, instrategy_p in) {
 }
 
 void finish(thread_p thread, thread_p cont) {
-  instrategy_p in = new instrategy::distributed(cont);
-  finish(thread, cont, in);
+  finish(thread, cont, new_finish_instrategy(cont));
 }
 
 /*---------------------------------------------------------------------*/
@@ -36,6 +36,18 @@ int get_nb_workers();
  */
 int get_my_id();
 
+/*! \brief Changes the number of workers that look for work to `nb`,
+ *  clamped to `[1, get_nb_workers()]`
+ *
+ * May be called at any time after `init()`, by any OS thread, also
+ * while a computation runs. The deactivated workers finish or give
+ * away the threads that they hold, then park until they are activated
+ * again; see `util::worker::group_t::set_nb_active()`.
+ */
+void set_nb_active_workers(int nb);
+//! Returns the number of workers that are active
+int get_nb_active_workers();
+
 /** @} */
 /*---------------------------------------------------------------------*/
 /** \defgroup entry Initialization and teardown
@@ -198,6 +210,11 @@ void binary_fork_join(thread_p thread1, thread_p thread2, thread_p cont);
  */
 
 future_p create_future(thread_p thread, bool lazy);
+/*! Same as above, except that the future is eager and that its
+ * outstrategy is the given `future`, which is typically an instance
+ * of `future_cas` allocated by the caller.
+ */
+void create_future(thread_p thread, future_p future);
 void force_future(future_p future, thread_p cont, instrategy_p in);
 void force_future(future_p future, thread_p cont);
 void delete_future(future_p future);
@@ -215,7 +232,8 @@ void delete_future(future_p future);
  * More precisely,
  * 1. instrategy of `thread` is `ready`
  * 2. outstrategy of `thread` is `unary` pointing on `cont`
- * 2. instrategy of `cont` is as specified by `in` or else `distributed`
+ * 2. instrategy of `cont` is as specified by `in` or else by the
+ *    result of calling `new_finish_instrategy()`
  */
 
 void async(thread_p thread, thread_p cont);
@@ -227,7 +245,16 @@ void finish(thread_p thread, thread_p cont);
 /** @} */
 /*---------------------------------------------------------------------*/
   
+/*! \brief Returns a new instrategy for the join point of a fork-join,
+ *  as selected by `-forkjoin_instrategy` (`fetch_add`, the default,
+ *  `snzi` or `message`)
+ */
 instrategy_p new_forkjoin_instrategy();
+/*! \brief Returns a new instrategy for the continuation `cont` of a
+ *  `finish` block, as selected by `-finish_instrategy` (`distributed`,
+ *  the default, `snzi` or `fetch_add`)
+ */
+instrategy_p new_finish_instrategy(thread_p cont);
 outstrategy_p new_forkjoin_outstrategy(branch_t branch);
   
 void change_factory(util::worker::controller_factory_t* factory);
@@ -8,6 +8,7 @@
 
 #include <math.h>
 
+#include <algorithm>
 #include <iostream>
 //#include <chrono>
 //#include <thread>
@@ -15,6 +16,8 @@
 #include "atomic.hpp"
 #include "workstealing.hpp"
 #include "barrier.hpp"
+#include "hwcounters.hpp"
+#include "machine.hpp"
 #include "pcmdline.hpp"
 
 namespace pasl {
@@ -26,15 +29,114 @@ namespace workstealing {
 threadset_shared::threadset_shared() {
   nb_tries_per_communicate =
     util::cmdline::parse_or_default_int("nb_tries_per_communicate", 1, false);
+  park = util::cmdline::parse_or_default_bool("park", false, false);
+  nb_failed_steals_before_park =
+    util::cmdline::parse_or_default_int("park_after", 64, false);
+  nb_unparks_per_push =
+    util::cmdline::parse_or_default_int("unparks_per_push", 1, false);
+  park_timeout = util::cmdline::parse_or_default_double("park_timeout", 1000.0, false);
+  max_park_timeout =
+    util::cmdline::parse_or_default_double("max_park_timeout", 100000.0, false);
+  parked.init();
+  date_of_last_unpark.store(util::ticks::now());
 }
 
 threadset_shared::~threadset_shared() {
 }
 
+void threadset_private::init() {
+  scheduler::_private::init();
+  _victim_selector = create_victim_selector();
+  _victim_selector->init(this);
+  _heartbeat = create_heartbeat_alarm(this);
+  nb_failed_steals = 0;
+  next_park_timeout = tshared->park_timeout;
+}
+
+void threadset_private::destroy() {
+  // release the workers that are still parked, so that they can exit
+  if (tshared->park)
+    tshared->parked.notify_all();
+  delete _victim_selector;
+  if (_heartbeat != NULL)
+    delete _heartbeat;
+  scheduler::_private::destroy();
+}
+
 bool threadset_private::stay_in_acquire() {
   return scheduler::_private::stay() && ! local_has();
 }
 
+// parked time is reported along with the idle time of the wait phase
+void threadset_private::exit_wait() {
+  scheduler::_private::exit_wait();
+  STAT_IDLE(add_to_parked_time(parked_time));
+  parked_time = 0.;
+}
+
+void threadset_private::steal_failed() {
+  if (! tshared->park)
+    return;
+  // a worker that holds periodic checks (e.g., the termination check
+  // of a finish block) must keep running them
+  if (! periodic_set.empty())
+    return;
+  nb_failed_steals++;
+  if (nb_failed_steals < tshared->nb_failed_steals_before_park)
+    return;
+  nb_failed_steals = 0;
+  park();
+}
+
+void threadset_private::steal_succeeded() {
+  nb_failed_steals = 0;
+  next_park_timeout = tshared->park_timeout;
+}
+
+bool threadset_private::should_deactivate() {
+  return ! util::worker::the_group.is_active_worker(my_id) && periodic_set.empty();
+}
+
+void threadset_private::park() {
+  if (should_deactivate()) {
+    STAT_COUNT(DEACTIVATE);
+    STAT_IDLE_ONLY(microtime_t date_enter_park = util::microtime::now());
+    util::worker::the_group.park_while_inactive(my_id);
+    STAT_IDLE_ONLY(parked_time += util::microtime::seconds_since(date_enter_park));
+    return;
+  }
+  util::futex::eventcount& parked = tshared->parked;
+  int key = parked.prepare_wait();
+  if (! stay_in_acquire()) {
+    parked.cancel_wait();
+    return;
+  }
+  STAT_COUNT(PARK);
+  STAT_IDLE_ONLY(microtime_t date_enter_park = util::microtime::now());
+  bool notified = parked.commit_wait(key, next_park_timeout);
+  STAT_IDLE_ONLY(parked_time += util::microtime::seconds_since(date_enter_park));
+  if (notified) {
+    STAT_COUNT(UNPARK);
+    STAT(add_to_wakeup_latency(util::ticks::microseconds_since(tshared->date_of_last_unpark.load())));
+    next_park_timeout = tshared->park_timeout;
+  } else {
+    next_park_timeout = std::min(2.0 * next_park_timeout, tshared->max_park_timeout);
+  }
+}
+
+void threadset_private::unpark() {
+  if (! tshared->park)
+    return;
+  if (! tshared->parked.has_waiters())
+    return;
+  // wake up thieves only if there is a thread that they could steal,
+  // or that a deactivated worker would give away
+  if (! remote_has() && ! (local_has() && should_deactivate()))
+    return;
+  tshared->date_of_last_unpark.store(util::ticks::now());
+  tshared->parked.notify(tshared->nb_unparks_per_push);
+}
+
 /*---------------------------------------------------------------------*/
 
 class alarm_by_ticks : public alarm {
@@ -42,14 +144,15 @@ private:
   ticks_t last_communicate;
 
 public:
-  void init(util::worker::controller_p controller) {
+  void init(util::worker::controller_p controller, double period) {
     this->controller = controller;
+    this->period = period;
     last_communicate = util::ticks::now();
   }
 
   bool ready() {
     double delay = util::ticks::microseconds_since(last_communicate);
-    return (delay > util::worker::delta);
+    return (delay > period);
   }
 
   void reset() {
@@ -68,13 +171,14 @@ private:
     // pick x uniformy distributed in [0,1)
     double x = (double) (controller->myrand()) / ((double) (RAND_MAX));
     // use a formula to predict time to next event (Knuth 3.4.1)
-    delay_to_next_communicate = - log(x) * ((double) util::worker::delta);
+    delay_to_next_communicate = - log(x) * period;
     //atomic::aprintf("delay %lf\n", delay_to_next_communicate);
   }
 
 public:
-  void init(util::worker::controller_p controller) {
+  void init(util::worker::controller_p controller, double period) {
     this->controller = controller;
+    this->period = period;
     last_communicate = util::ticks::now();
     pick_delay_to_next_communicate();
   }
@@ -104,6 +208,182 @@ alarm* create_alarm() {
   return alarm;
 }
 
+alarm* create_heartbeat_alarm(util::worker::controller_p controller) {
+  double period = util::cmdline::parse_or_default_double("heartbeat", 0., false);
+  if (period <= 0.)
+    return NULL;
+  alarm* heartbeat = create_alarm();
+  heartbeat->init(controller, period);
+  return heartbeat;
+}
+
+bool heartbeat_rang(alarm* heartbeat) {
+  if (heartbeat == NULL || ! heartbeat->ready())
+    return false;
+  heartbeat->reset();
+  STAT_COUNT(HEARTBEAT);
+  return true;
+}
+
+/*---------------------------------------------------------------------*/
+
+class victim_selector_uniform : public victim_selector {
+public:
+  void init(util::worker::controller_p controller) {
+    this->controller = controller;
+  }
+
+  worker_id_t select() {
+    return controller->random_other();
+  }
+};
+
+/*---------------------------------------------------------------------*/
+
+/* Picks a victim on a remote NUMA node with probability
+ * `remote_steal_probability`; otherwise, picks a victim that shares
+ * an L3 cache with probability `l3_steal_probability` and a victim
+ * that shares only the NUMA node with the remaining probability.
+ * A level with no workers, or whose workers are all parked because
+ * they were deactivated, defers to the next level outward.
+ */
+class victim_selector_hierarchical : public victim_selector {
+private:
+  typedef util::machine::proximity_level_t level_t;
+  double remote_steal_probability;
+  double l3_steal_probability;
+  const std::vector<worker_id_t>* peers[util::machine::NB_PROXIMITY_LEVELS];
+
+  // returns a number uniformly distributed in [0,1)
+  double random_unit() {
+    return (double) controller->myrand() / 4294967296.;
+  }
+
+  worker_id_t random_peer(const std::vector<worker_id_t>& set) {
+    return set[controller->myrand() % set.size()];
+  }
+
+  /* returns a peer in `set` that is not parked, or -1 if the tries,
+   * whose number is bounded as in `random_other`, all hit parked peers
+   */
+  worker_id_t random_unparked_peer(const std::vector<worker_id_t>& set) {
+    util::worker::group_t& group = util::worker::the_group;
+    worker_id_t id = random_peer(set);
+    if (group.get_nb_active() == util::worker::get_nb())
+      return id;
+    for (size_t nb_tries = 0; nb_tries < set.size() && group.is_parked(id); nb_tries++)
+      id = random_peer(set);
+    return group.is_parked(id) ? -1 : id;
+  }
+
+public:
+  void init(util::worker::controller_p controller) {
+    this->controller = controller;
+    remote_steal_probability =
+      util::cmdline::parse_or_default_double("remote_steal_probability", 0.1, false);
+    l3_steal_probability =
+      util::cmdline::parse_or_default_double("l3_steal_probability", 0.5, false);
+    worker_id_t my_id = controller->get_id();
+    for (int level = 0; level < util::machine::NB_PROXIMITY_LEVELS; level++)
+      peers[level] = &util::machine::the_proximity.peers_of(my_id, (level_t)level);
+  }
+
+  worker_id_t select() {
+    int level;
+    if (random_unit() < remote_steal_probability)
+      level = util::machine::PROXIMITY_REMOTE;
+    else if (random_unit() < l3_steal_probability)
+      level = util::machine::PROXIMITY_L3;
+    else
+      level = util::machine::PROXIMITY_NODE;
+    for (; level < util::machine::NB_PROXIMITY_LEVELS; level++) {
+      if (peers[level]->empty())
+        continue;
+      worker_id_t id = random_unparked_peer(*peers[level]);
+      if (id >= 0)
+        return id;
+    }
+    return controller->random_other();
+  }
+};
+
+/*---------------------------------------------------------------------*/
+
+/* With probability `adaptive_steal_randomness`, picks a victim
+ * uniformly at random, so that every worker keeps being probed;
+ * otherwise, draws two victims uniformly at random and picks the one
+ * with the higher score. The score of a victim is its work hint times
+ * the recent success rate of the attempts on it, which decays by a
+ * factor of `steal_history_decay` at each new attempt. A victim with
+ * no hint counts as having one unit of work.
+ */
+class victim_selector_adaptive : public victim_selector {
+private:
+  double randomness;
+  double decay;
+  std::vector<double> success_rate;
+  work_hint_fct hint_of;
+
+  double random_unit() {
+    return (double) controller->myrand() / 4294967296.;
+  }
+
+  double score_of(worker_id_t id) {
+    int hint = hint_of ? hint_of(id) : -1;
+    double work = (hint < 0) ? 1. : (double) hint;
+    return work * (0.1 + success_rate[id]);
+  }
+
+public:
+  void init(util::worker::controller_p controller) {
+    this->controller = controller;
+    randomness =
+      util::cmdline::parse_or_default_double("adaptive_steal_randomness", 0.25, false);
+    decay =
+      util::cmdline::parse_or_default_double("steal_history_decay", 0.25, false);
+    success_rate.assign(util::worker::get_nb(), 0.5);
+  }
+
+  void set_work_hints(const work_hint_fct& hint_of) {
+    this->hint_of = hint_of;
+  }
+
+  worker_id_t select() {
+    worker_id_t id1 = controller->random_other();
+    if (random_unit() < randomness)
+      return id1;
+    worker_id_t id2 = controller->random_other();
+    return (score_of(id2) > score_of(id1)) ? id2 : id1;
+  }
+
+  void steal_outcome(worker_id_t id, bool success) {
+    success_rate[id] += decay * ((success ? 1. : 0.) - success_rate[id]);
+  }
+};
+
+/*---------------------------------------------------------------------*/
+
+victim_selector* create_victim_selector() {
+  std::string s =
+    util::cmdline::parse_or_default_string("victim_selection", "uniform", false);
+  if (s == "uniform")
+    return new victim_selector_uniform();
+  else if (s == "hierarchical")
+    return new victim_selector_hierarchical();
+  else if (s == "adaptive")
+    return new victim_selector_adaptive();
+  util::atomic::die("bogus victim selection policy %s\n", s.c_str());
+  return NULL;
+}
+
+void count_steal(worker_id_t id1, worker_id_t id2) {
+  switch (util::machine::the_proximity.level_between(id1, id2)) {
+    case util::machine::PROXIMITY_L3: STAT_COUNT(STEAL_L3); break;
+    case util::machine::PROXIMITY_NODE: STAT_COUNT(STEAL_NODE); break;
+    default: STAT_COUNT(STEAL_REMOTE); break;
+  }
+}
+
 /*---------------------------------------------------------------------*/
 /* CAS-based sender-initiated work stealing */
 
@@ -124,14 +404,14 @@ cas_si_shared::~cas_si_shared() {
 
 void cas_si_private::init() {
   allow_interrupt = false;
-  scheduler::_private::init();
+  threadset_private::init();
   _alarm = create_alarm();
-  _alarm->init(this);
+  _alarm->init(this, util::worker::delta);
 }
 
 void cas_si_private::destroy() {
   delete _alarm;
-  scheduler::_private::destroy();
+  threadset_private::destroy();
 }
 
 void cas_si_private::acquire() {
@@ -142,11 +422,16 @@ void cas_si_private::acquire() {
       if (! stay_in_acquire()) {
         cancel_acquire();
         return;
-      } else
+      } else if (should_deactivate()) {
+        park();
+      } else {
         util::worker::controller_t::yield();
+        steal_failed();
+      }
     } else {
       thread_p thread = (thread_p) shared->states[my_id].load();
       shared->states[my_id].store(WORKING);
+      steal_succeeded();
       remote_push(thread);
       LOG_THREAD(THREAD_SEND, thread);
       STAT_COUNT(THREAD_SEND);
@@ -171,21 +456,43 @@ void cas_si_private::cancel_acquire() {
   }
 }
 
+/* withdraws from the set of waiting workers, so that no sender can
+ * make an offer to this worker while it is parked
+ */
+void cas_si_private::park() {
+  cas_si_shared::state_t orig = WAITING;
+  if (! shared->states[my_id].compare_exchange_strong(orig, WORKING))
+    return; // an offer is on its way
+  threadset_private::park();
+  shared->states[my_id].store(WAITING);
+}
+
 void cas_si_private::communicate() {
   LOG_BASIC(COMMUNICATE);
   STAT_COUNT(COMMUNICATE);
   if (nb_workers < 2) return;
-  if (! remote_has()) return;
+  if (! donate_has()) return;
+  // entered only now, so that a call with nothing to do costs no reads
+  util::hwcounters::phase_scope phase(util::hwcounters::PHASE_COMMUNICATING);
   _alarm->reset();
   should_communicate = false;
+  // the last thread of a deactivated worker goes to an active worker
+  bool to_active_only = ! remote_has();
   for (int nb_tries = 0; nb_tries < shared->nb_tries_per_communicate; nb_tries++) {
-    worker_id_t id = random_other();
-    if (shared->states[id].load() != WAITING) continue;
+    worker_id_t id = _victim_selector->select();
+    if (to_active_only && ! util::worker::the_group.is_active_worker(id))
+      continue;
+    if (shared->states[id].load() != WAITING) {
+      _victim_selector->steal_outcome(id, false);
+      continue;
+    }
     thread_p orig = WAITING;
     bool s = shared->states[id].compare_exchange_strong(orig, INCOMING);
+    _victim_selector->steal_outcome(id, s);
     if (! s) continue;
     else {
-      shared->states[id].store(remote_pop());
+      shared->states[id].store(donate_pop());
+      STAT_ONLY(count_steal(my_id, id));
       return;
     }
   }
@@ -219,7 +526,7 @@ void cas_si_private::check() {
   
 bool cas_si_private::should_call_communicate() {
   for (int nb_tries = 0; nb_tries < shared->nb_tries_per_communicate; nb_tries++) {
-    worker_id_t id = random_other();
+    worker_id_t id = _victim_selector->select();
     if (shared->states[id].load() == WAITING)
       return true;
   }
@@ -246,8 +553,10 @@ void cas_si_private::check_on_interrupt() {
 //! \todo: factorize code!
 
 cas_ri_shared::cas_ri_shared() : threadset_shared::threadset_shared() {
-  for (worker_id_t id = 0; id < util::worker::get_nb(); id++)
-    requests[id].store(REQUEST_WAITING);
+  for (worker_id_t id = 0; id < util::worker::get_nb(); id++) {
+    requests[id].request.store(REQUEST_WAITING);
+    requests[id].work_hint.store(0);
+  }
   answers.init(ANSWER_REJECT);
 }
 
@@ -259,13 +568,30 @@ cas_ri_shared::~cas_ri_shared() {
 
 void cas_ri_private::init() {
   allow_interrupt = false;
-  scheduler::_private::init();
+  threadset_private::init();
   last_communicate = util::ticks::now();
-  my_request_ptr = & (shared->requests[my_id]);
+  my_request_ptr = & (shared->requests[my_id].request);
+  my_work_hint_ptr = & (shared->requests[my_id].work_hint);
+  last_work_hint = 0;
+  _victim_selector->set_work_hints([this] (worker_id_t id) {
+    return shared->requests[id].work_hint.load(std::memory_order_relaxed);
+  });
+}
+
+// stores the hint only when it changes, which is rare since it is on a log scale
+void cas_ri_private::publish_work_hint() {
+  int hint = 0;
+  if (donate_has())
+    for (size_t n = nb_threads(); n > 0; n /= 2)
+      hint++;
+  if (hint == last_work_hint)
+    return;
+  last_work_hint = hint;
+  my_work_hint_ptr->store(hint, std::memory_order_relaxed);
 }
 
 void cas_ri_private::destroy() {
-  scheduler::_private::destroy();
+  threadset_private::destroy();
 }
 
 void cas_ri_private::reject() { // TODO: rename this to reject_and_block
@@ -306,45 +632,64 @@ void cas_ri_private::acquire() {
   // TODO: writes in answer_ptr should be "store" function calls
 
   thread_p thread = NULL;
+  worker_id_t id;
   answer_t* answer_ptr = & (shared->answers[my_id]);
   while (true) {
     scheduler::_private::check_periodic();
     if (! stay_in_acquire())
       goto cleanup;
+    // no thief can post a request while the slot is blocked
+    if (should_deactivate()) {
+      park();
+      continue;
+    }
 
     // may yield here
     sleep_in_acquire(1);
 
     *answer_ptr = ANSWER_WAITING;
-    worker_id_t id = random_other();
-    if (shared->requests[id].load() != REQUEST_WAITING){
+    id = _victim_selector->select();
+    if (shared->requests[id].request.load() != REQUEST_WAITING){
+      STAT_COUNT(STEAL_FAIL);
+      _victim_selector->steal_outcome(id, false);
+      steal_failed();
       continue;
     }
     request_t orig = REQUEST_WAITING;
-    bool s = shared->requests[id].compare_exchange_strong(orig, my_id);
-    if (! s)
+    bool s = shared->requests[id].request.compare_exchange_strong(orig, my_id);
+    if (! s) {
+      STAT_COUNT(STEAL_FAIL);
+      _victim_selector->steal_outcome(id, false);
+      steal_failed();
       continue;
+    }
 
     while (*answer_ptr == ANSWER_WAITING) {
       sleep_in_acquire(1); // may yield here as well
       //util::atomic::print([&] { std::cout << "***waiting answer " << my_id << std::endl; });
       if (! stay_in_acquire()) {
-        shared->requests[id].store(REQUEST_WAITING);
+        shared->requests[id].request.store(REQUEST_WAITING);
         goto cleanup;
       }
     }
     //util::atomic::aprintf("reception from %d to %d\n", my_id, id);
 
     if (*answer_ptr == ANSWER_REJECT){
+      STAT_COUNT(STEAL_FAIL);
+      _victim_selector->steal_outcome(id, false);
+      steal_failed();
       continue;
     }
     thread = (thread_p) *answer_ptr;
     break;
   }
+  _victim_selector->steal_outcome(id, true);
+  steal_succeeded();
   remote_push(thread);
   //! \todo: thread_receive event?
   LOG_THREAD(THREAD_SEND, thread);
   STAT_COUNT(THREAD_SEND);
+  STAT_ONLY(count_steal(my_id, id));
 
   cleanup:
   unblock();
@@ -366,8 +711,11 @@ void cas_ri_private::communicate() {
   request_t j = my_request_ptr->load();
   if (j == REQUEST_WAITING)
     return;
-  if (remote_has()) {
-    shared->answers[j] = remote_pop();
+  // entered only now, so that a call with nothing to do costs no reads
+  util::hwcounters::phase_scope phase(util::hwcounters::PHASE_COMMUNICATING);
+  // the thieves are active workers, since deactivated workers park instead
+  if (donate_has()) {
+    shared->answers[j] = donate_pop();
   } else {
     shared->answers[j] = ANSWER_REJECT;
   }
@@ -401,6 +749,7 @@ void cas_ri_private::run() {
 }
 
 void cas_ri_private::wait() {
+  publish_work_hint();
   enter_wait();
   acquire();
   exit_wait();
@@ -408,6 +757,7 @@ void cas_ri_private::wait() {
 
 void cas_ri_private::check() {
   communicate();
+  publish_work_hint();
 
   //! \todo Problem if calls to check_periodic!
 
@@ -438,21 +788,27 @@ void cas_ri_interrupt_private::acquire() {
   while (true) {
     if (! stay_in_acquire())
       goto cleanup;
+    if (should_deactivate()) {
+      reject();
+      park();
+      unblock();
+      continue;
+    }
 
     // may yield here
     *answer_ptr = ANSWER_WAITING;
-    worker_id_t id = random_other();
-    if (shared->requests[id].load() != REQUEST_WAITING)
+    worker_id_t id = _victim_selector->select();
+    if (shared->requests[id].request.load() != REQUEST_WAITING)
       continue;
     worker_id_t orig = REQUEST_WAITING;
-    bool s = shared->requests[id].compare_exchange_strong(orig, my_id);
+    bool s = shared->requests[id].request.compare_exchange_strong(orig, my_id);
     if (! s)
       continue;
 
     while (*answer_ptr == ANSWER_WAITING) {
       communicate();
       if (! stay_in_acquire()) {
-        shared->requests[id].store(REQUEST_WAITING);
+        shared->requests[id].request.store(REQUEST_WAITING);
         goto cleanup;
       }
     }
@@ -579,7 +935,10 @@ bool chase_lev_deque::cas_top (int64_t old_val, int64_t new_val) {
   return top.compare_exchange_strong(ov, new_val);
 }
 
-void chase_lev_deque::init(int64_t init_capacity) {
+void chase_lev_deque::init(int64_t init_capacity, int64_t batch_max) {
+  assert(batch_max >= 1);
+  this->batch_max = batch_max;
+  reclaimed.resize(batch_max);
   capacity.store(init_capacity);
   buf = new_buffer(capacity.load());
   bottom.store(0l);
@@ -623,23 +982,59 @@ thread_p chase_lev_deque::pop_front() {
   return item;
 }
 
+/* A thief claims the cells [t, t+n) by moving the top from t to t+n,
+ * where n <= batch_max. As in the single-item case, the owner can
+ * take cell b without synchronization only if no thief can claim it,
+ * that is, if b >= t + batch_max. Otherwise, the owner claims all the
+ * cells [t, b] with a single CAS on the top and then pushes back the
+ * cells [t, b), of which there are fewer than batch_max: it copies them
+ * after the top, which leaves the deque empty to thieves until a single
+ * store of the bottom publishes them all. With batch_max = 1, this is
+ * the original protocol.
+ */
 thread_p chase_lev_deque::pop_back() {
-  int64_t b = bottom.load() - 1;
-  bottom.store(b);
-  // requires fence store-load
-  int64_t t = top.load();
-  if (b < t) {
-    bottom.store(t);
-    return NULL;
-  }
-  thread_p item = cb_get (buf, capacity.load(), b);
-  if (b > t)
+  while (true) {
+    int64_t b = bottom.load() - 1;
+    bottom.store(b);
+    // requires fence store-load
+    int64_t t = top.load();
+    if (b < t) {
+      bottom.store(t);
+      return NULL;
+    }
+    thread_p item = cb_get (buf, capacity.load(), b);
+    if (b - t >= batch_max)
+      return item;
+    if (! cas_top (t, b + 1)) {
+      // a thief took some of the cells; try again with the new top
+      bottom.store(b + 1);
+      continue;
+    }
+    int64_t nb_others = b - t;
+    int64_t cap = capacity.load();
+    for (int64_t i = 0; i < nb_others; i++)
+      reclaimed[i] = cb_get (buf, cap, t + i);
+    for (int64_t i = 0; i < nb_others; i++)
+      cb_put (buf, cap, b + 1 + i, reclaimed[i]);
+    // requires fence store-store
+    bottom.store(b + 1 + nb_others);
     return item;
-  if (! cas_top (t, t + 1)) {
-    item = NULL;
   }
-  bottom.store(t + 1);
-  return item;
+}
+
+int64_t chase_lev_deque::pop_front_half(thread_p* dst) {
+  int64_t t = top.load();
+  // requires fence load-load
+  int64_t b = bottom.load();
+  if (t >= b)
+    return 0;
+  int64_t n = std::min(std::max((b - t) / 2, (int64_t)1), batch_max);
+  for (int64_t i = 0; i < n; i++)
+    dst[i] = cb_get (buf, capacity.load(), t + i);
+  // requires fence load-store
+  if (! cas_top (t, t + n))
+    return -1;
+  return n;
 }
 
 size_t chase_lev_deque::nb_threads() {
@@ -654,18 +1049,32 @@ shared_deques_shared::shared_deques_shared() {
   //  scheduler::_shared();
   deques.init(NULL);
   creation_barrier.init(util::worker::get_nb());
+  steal_half = util::cmdline::parse_or_default_bool("steal_half", false, false);
+  steal_half_max = util::cmdline::parse_or_default_int("steal_half_max", 32, false);
 }
 
 shared_deques_shared::~shared_deques_shared() {
 }
 
 void shared_deques_private::init() {
-  my_deque.init(1024l);
+  int64_t batch_max = _shared->steal_half ? _shared->steal_half_max : 1;
+  my_deque.init(1024l, batch_max);
+  my_stolen.resize(batch_max);
   scheduler::_private::init();
+  _victim_selector = create_victim_selector();
+  _victim_selector->init(this);
+  _victim_selector->set_work_hints([this] (worker_id_t id) {
+    chase_lev_deque* deque = _shared->deques[id];
+    return (deque == NULL) ? -1 : (int)deque->nb_threads();
+  });
+  _heartbeat = create_heartbeat_alarm(this);
   _shared->deques[util::worker::get_my_id()] = &my_deque;
 }
 
 void shared_deques_private::destroy() {
+  delete _victim_selector;
+  if (_heartbeat != NULL)
+    delete _heartbeat;
   scheduler::_private::destroy();
 }
 
@@ -678,7 +1087,7 @@ void shared_deques_private::flush() {
 
 void shared_deques_private::run() {
   if (!initialized)
-    _shared->creation_barrier.wait();
+    _shared->creation_barrier.wait(util::worker::get_my_id());
   initialized = true;
   while (stay()) {
     flush();
@@ -707,17 +1116,46 @@ void shared_deques_private::acquire() {
   int nb_tries = 0;
   while (stay()) {
     check();
-    worker_id_t id_target = random_other();
+    // thieves do not wait on the owner of a deque, so that the worker
+    // can park as soon as its deque is empty
+    if (! util::worker::the_group.is_active_worker(my_id) && periodic_set.empty()) {
+      if (my_deque.nb_threads() > 0)
+        return;
+      STAT_COUNT(DEACTIVATE);
+      util::worker::the_group.park_while_inactive(my_id);
+      continue;
+    }
+    worker_id_t id_target = _victim_selector->select();
     chase_lev_deque* target = _shared->deques[id_target];
-    thread_p thread = target->pop_front();
+    int64_t nb_stolen = 1;
+    thread_p thread;
+    if (_shared->steal_half) {
+      nb_stolen = target->pop_front_half(&my_stolen[0]);
+      if (nb_stolen == 0)
+        thread = STEAL_RES_EMPTY;
+      else if (nb_stolen < 0)
+        thread = STEAL_RES_ABORT;
+      else
+        thread = my_stolen[0];
+    } else {
+      thread = target->pop_front();
+      my_stolen[0] = thread;
+    }
     if (thread == STEAL_RES_EMPTY) {
       LOG_BASIC(STEAL_FAIL);
+      STAT_COUNT(STEAL_FAIL);
+      _victim_selector->steal_outcome(id_target, false);
     } else if (thread == STEAL_RES_ABORT) {
       LOG_BASIC(STEAL_ABORT);
     } else {
       LOG_BASIC(STEAL_SUCCESS);
+      _victim_selector->steal_outcome(id_target, true);
       STAT_COUNT(THREAD_SEND);
-      my_deque.push_back(thread);
+      STAT_ONLY(count_steal(my_id, id_target));
+      for (int64_t i = 0; i < nb_stolen; i++)
+        my_deque.push_back(my_stolen[i]);
+      for (int64_t i = 1; i < nb_stolen; i++)
+        STAT_COUNT(THREAD_STEAL_BATCH);
       return;
     }
     nb_tries++;
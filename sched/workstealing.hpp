@@ -10,9 +10,11 @@
 #define _WORKSTEALING_H_
 
 #include <math.h>
+#include <functional>
 
 #include "classes.hpp"
 #include "container.hpp"
+#include "futex.hpp"
 #include "scheduler.hpp"
 
 /*! \defgroup workstealing Work stealing
@@ -34,6 +36,77 @@ class threadset_private;
 typedef threadset_private* threadset_private_p;
 typedef threadset_shared* threadset_shared_p;
 
+/*---------------------------------------------------------------------*/
+/* Victim selection interface */
+/* to be used to pick the worker to steal from (or, in sender-initiated
+ * work stealing, the worker to send a thread to) */
+
+/*! \brief Returns a hint of the amount of work that a worker can give
+ *  away, as published by that worker, or -1 if there is no hint
+ *
+ * Hints are only compared with each other; zero means no work.
+ */
+typedef std::function<int(worker_id_t)> work_hint_fct;
+
+class victim_selector {
+protected:
+  util::worker::controller_p controller;
+
+public:
+  virtual ~victim_selector() { }
+  virtual void init(util::worker::controller_p controller) = 0;
+  //! Returns the id of a worker other than the calling worker
+  virtual worker_id_t select() = 0;
+  //! Reports whether the attempt on the worker `id` that was last selected succeeded
+  virtual void steal_outcome(worker_id_t id, bool success) { }
+  //! Gives access to the work hints of the scheduler, if it has any
+  virtual void set_work_hints(const work_hint_fct& hint_of) { }
+};
+
+/*! \brief Creates the victim selector given by `-victim_selection`
+ *
+ *   - `uniform` (default): all other workers are equally likely
+ *   - `hierarchical`: workers that share an L3 cache or a NUMA node
+ *     with the caller are preferred (see `util::machine::proximity`)
+ *   - `adaptive`: workers that published more work, and from which
+ *     recent attempts succeeded, are preferred
+ */
+victim_selector* create_victim_selector();
+
+//! Counts a thread migration in the stats, by proximity level
+void count_steal(worker_id_t id1, worker_id_t id2);
+
+/*---------------------------------------------------------------------*/
+/* Alarm interface */
+/* to be used by sender initiated to schedule calls to communicate(),
+ * and by all workers to produce the heartbeat */
+
+class alarm {
+protected:
+  util::worker::controller_p controller;
+  //! average delay between two rings, in microseconds
+  double period;
+
+public:
+  virtual ~alarm() { }
+  virtual void init(util::worker::controller_p controller, double period) = 0;
+  virtual bool ready() = 0;
+  virtual void reset() = 0;
+};
+
+alarm* create_alarm();
+
+/*! \brief Creates the alarm that produces the heartbeat of the calling
+ *  worker, or returns NULL if heartbeat mode is disabled
+ *
+ *   - `-heartbeat <double>` (default=0) the period of the heartbeat,
+ *     in microseconds; 0 disables heartbeat mode
+ */
+alarm* create_heartbeat_alarm(util::worker::controller_p controller);
+
+//! Returns true, and rearms the alarm, if `heartbeat` rang
+bool heartbeat_rang(alarm* heartbeat);
+
 /*---------------------------------------------------------------------*/
 
 // LATER: find a better name instead of threadset
@@ -45,22 +118,84 @@ protected:
    */
   int nb_tries_per_communicate;
 
+  /** @name Parking of idle workers
+   *
+   * When parking is enabled (`-park 1`), a worker that fails
+   * `nb_failed_steals_before_park` consecutive steal attempts
+   * suspends itself on the eventcount `parked`. A worker that makes
+   * a new thread ready wakes up at most `nb_unparks_per_push` parked
+   * workers. Because the thief cannot observe the private deques of
+   * the other workers, a wakeup may be missed; the sleep is therefore
+   * bounded by `park_timeout` microseconds, which doubles on every
+   * consecutive timeout up to `max_park_timeout`.
+   */
+  ///@{
+  bool park;
+  int nb_failed_steals_before_park;
+  int nb_unparks_per_push;
+  double park_timeout;
+  double max_park_timeout;
+  util::futex::eventcount parked;
+  //! date of the last notification, used to measure wakeup latency
+  std::atomic<ticks_t> date_of_last_unpark;
+  ///@}
+
 public:
   threadset_shared();
   ~threadset_shared();
+
+friend class threadset_private;
 };
 
 /*---------------------------------------------------------------------*/
 
 class threadset_private : public scheduler::_private {
 protected:
+  threadset_shared* tshared;
+  victim_selector* _victim_selector;
+  alarm* _heartbeat;
+  int nb_failed_steals;
+  double next_park_timeout;
+  //! time spent parked during the current wait phase (seconds)
+  double parked_time;
+
   bool stay_in_acquire();
+  void exit_wait();
+
+  //! To be called by the thief each time a steal attempt fails
+  void steal_failed();
+  //! To be called by the thief once it obtains a thread
+  void steal_succeeded();
+  /*! \brief Suspends the calling worker until notification or timeout,
+   *  or, if the worker was deactivated, until it is activated again
+   */
+  virtual void park();
+  /*! \brief Returns true if the calling worker was deactivated (see
+   *  `util::worker::group_t::set_nb_active()`) and should park
+   *
+   * A worker that holds periodic checks keeps running them instead.
+   */
+  bool should_deactivate();
+  //! Wakes up parked workers, if any
+  void unpark();
 
   virtual void add_to_pool_of_ready_threads(thread_p t) {
     local_push(t);
+    unpark();
   }
 
 public:
+  threadset_private(threadset_shared* tshared)
+    : tshared(tshared), _victim_selector(NULL), _heartbeat(NULL), nb_failed_steals(0),
+      next_park_timeout(0.), parked_time(0.) { }
+
+  void init();
+  void destroy();
+
+  bool heartbeat() {
+    return heartbeat_rang(_heartbeat);
+  }
+
   virtual void acquire() = 0;
   virtual void communicate() = 0;
   virtual void wait() = 0;
@@ -100,6 +235,9 @@ protected:
   */
 
 public:
+  private_deque(threadset_shared* tshared)
+    : threadset_private(tshared) { }
+
   inline size_t nb_threads() {
     return my_ready_threads.size();
   }
@@ -184,6 +322,18 @@ public:
     }
   }
 
+  /* A deactivated worker gives away even its last ready thread, e.g.,
+   * a thread that yields, so that it can run out of work and park */
+  inline bool donate_has() {
+    return remote_has() || (local_has() && should_deactivate());
+  }
+
+  inline thread_p donate_pop() {
+    if (remote_has())
+      return remote_pop();
+    return my_ready_threads.pop_front();
+  }
+
   inline thread_p try_local_pop() {
     if (local_has())
       return local_pop();
@@ -195,27 +345,11 @@ public:
 
   virtual void add_to_pool_of_ready_threads(thread_p t) {
     local_push(t);
+    unpark();
   }
 
 };
 
-/*---------------------------------------------------------------------*/
-/* Alarm interface */
-/* to be used by sender initiated to schedule calls to communicate() */
-
-class alarm {
-protected:
-  util::worker::controller_p controller;
-
-public:
-  virtual ~alarm() { }
-  virtual void init(util::worker::controller_p controller) = 0;
-  virtual bool ready() = 0;
-  virtual void reset() = 0;
-};
-
-alarm* create_alarm();
-
 /*---------------------------------------------------------------------*/
 /* CAS-based sender-initiated work stealing */
 
@@ -240,9 +374,10 @@ protected:
 
   void cancel_acquire();
   void check();
+  void park();
 
 public:
-  cas_si_private(cas_si_shared* shared) : shared(shared) {}
+  cas_si_private(cas_si_shared* shared) : private_deque(shared), shared(shared) {}
   void init();
   void destroy();
   void run();
@@ -268,10 +403,19 @@ static const request_t REQUEST_WAITING = -1;
 static const request_t REQUEST_BLOCKED = -2;
 
 
+/* The slot in which thieves post their requests to a worker; the
+ * worker also publishes there a hint of the amount of work that it
+ * can give away: zero if none, otherwise one plus the binary logarithm
+ * of the number of its ready threads. */
+typedef struct {
+  std::atomic<request_t> request;
+  std::atomic<int> work_hint;
+} request_slot_t;
+
 class cas_ri_shared : public threadset_shared {
 protected:
   data::perworker::array<answer_t> answers;
-  data::perworker::array<std::atomic<request_t>> requests;
+  data::perworker::array<request_slot_t> requests;
 
 public:
   cas_ri_shared();
@@ -289,9 +433,12 @@ protected:
   void sleep_in_acquire(double nb_microseconds);
   bool time_to_communicate();
   std::atomic<request_t>* my_request_ptr;
+  std::atomic<int>* my_work_hint_ptr;
+  int last_work_hint;
+  void publish_work_hint();
 
 public:
-  cas_ri_private(cas_ri_shared* shared) : shared(shared) {}
+  cas_ri_private(cas_ri_shared* shared) : private_deque(shared), shared(shared) {}
   void init();
   void destroy();
   void run();
@@ -329,7 +476,7 @@ public:
   cas_ri_interrupt_private(cas_ri_interrupt_shared* shared) : cas_ri_private(shared) {}
 
   void check_on_interrupt();
-  bool should_be_interrupted() { return shared->requests[my_id] != REQUEST_WAITING; }
+  bool should_be_interrupted() { return shared->requests[my_id].request != REQUEST_WAITING; }
   void check();
   void acquire();
 
@@ -349,6 +496,8 @@ protected:
   std::atomic<int64_t> capacity;  // maximum number of elements
   std::atomic<int64_t> bottom;    // index of the first unused cell
   std::atomic<int64_t> top;       // index of the last used cell
+  int64_t batch_max;              // maximum number of threads per steal
+  std::vector<thread_p> reclaimed; // buffer for the pushes back of pop_back()
 
   static thread_p cb_get (buffer_t buf, int64_t capacity, int64_t i);
   static void cb_put (buffer_t buf, int64_t capacity, int64_t i, thread_p x);
@@ -362,13 +511,26 @@ protected:
   bool cas_top (int64_t old_val, int64_t new_val);
 
 public:
-  chase_lev_deque() : buf(NULL), bottom(0l), top(0l) {
+  chase_lev_deque() : buf(NULL), bottom(0l), top(0l), batch_max(1l) {
     capacity.store(0l);
   }
-  void init(int64_t init_capacity);
+  /*! \param batch_max the maximum number of threads that
+   *  `pop_front_half()` may take at once; the owner pays a CAS
+   *  whenever it pops one of the last `batch_max` threads
+   */
+  void init(int64_t init_capacity, int64_t batch_max = 1l);
   void destroy();
   void push_back(thread_p item);
   thread_p pop_front();
+  /*! \brief Steals half of the threads, but at most `batch_max`, with
+   *  a single CAS
+   *
+   *  The stolen threads are written to `dst`, from the oldest to the
+   *  youngest.
+   *  \return the number of stolen threads, 0 if the deque was empty,
+   *  or -1 if the steal aborted because of a concurrent pop
+   */
+  int64_t pop_front_half(thread_p* dst);
   thread_p pop_back();
   size_t nb_threads();
   bool empty();
@@ -379,6 +541,10 @@ class shared_deques_shared : public scheduler::_shared {
 protected:
   data::perworker::array<chase_lev_deque*> deques;
   barrier_t creation_barrier;
+  //! if true (`-steal_half 1`), thieves take half of the victim's threads
+  bool steal_half;
+  //! maximum number of threads per steal (`-steal_half_max`)
+  int steal_half_max;
 
 public:
   shared_deques_shared();
@@ -389,17 +555,23 @@ public:
 class shared_deques_private : public scheduler::_private {
 protected:
   shared_deques_shared* _shared;
+  victim_selector* _victim_selector;
+  alarm* _heartbeat;
   chase_lev_deque my_deque;
   std::vector<thread_p> my_fresh;
+  std::vector<thread_p> my_stolen; // buffer for pop_front_half()
   bool initialized;
 
   void flush();
 
 public:
   shared_deques_private(shared_deques_shared* _shared)
-    : _shared(_shared),initialized(false) { }
+    : _shared(_shared), _victim_selector(NULL), _heartbeat(NULL), initialized(false) { }
   void init();
   void destroy();
+  bool heartbeat() {
+    return heartbeat_rang(_heartbeat);
+  }
   void run();
   void acquire();
   void check();
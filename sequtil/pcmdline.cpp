@@ -16,6 +16,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <inttypes.h>
+#include <map>
 // NEW: remove useless includes
 
 #include "pcmdline.hpp"
@@ -30,6 +31,7 @@ namespace cmdline {
 int global_argc = -1;
 char** global_argv;
 bool print_warning_on_use_of_default_value;
+static std::map<std::string, std::string> overrides;
 
 void set(int argc, char** argv)
 {
@@ -150,6 +152,12 @@ static void parse_value(type_t type, void* dest, char* arg_value)
 static bool parse(type_t type, std::string name, void* dest) 
 { 
   check_set();  
+  auto o = overrides.find(name);
+  if (o != overrides.end()) {
+    std::string value = o->second;
+    parse_value(type, dest, &value[0]);
+    return true;
+  }
   for (int a = 1; a < global_argc; a++)  
   {
     if (*(global_argv[a]) != '-') 
@@ -175,6 +183,14 @@ static bool parse(type_t type, std::string name, void* dest)
   return false;
 }
 
+void set_override(std::string name, std::string value) {
+  overrides[name] = value;
+}
+
+void clear_override(std::string name) {
+  overrides.erase(name);
+}
+
 /*---------------------------------------------------------------------*/
 /* Specific parsing functions */
 
@@ -51,6 +51,17 @@ std::string name_of_my_executable();
 //! Terminates the program with a printf style error message
 void die(const char *fmt, ...);
 
+/*! \brief Binds `name` to `value`, in place of the binding of `name`
+ *  on the command line, if any
+ *
+ * Not thread safe: meant for drivers that re-initialize the runtime
+ * with different parameters.
+ */
+void set_override(std::string name, std::string value);
+
+//! Removes the override of `name`, if any
+void clear_override(std::string name);
+
 
 /*---------------------------------------------------------------------*/
 
@@ -0,0 +1,125 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file elasticcheck.cpp
+ * \brief Checks that the number of active workers can be changed
+ * while a computation runs
+ *
+ * Arguments:
+ *   - `-n <int>` (default=2000000): number of iterations of the loop
+ *   - `-rounds <int>` (default=20): number of loops
+ *   - `-resize_period <int>` (default=200): delay between two
+ *     resizes, in microseconds
+ *
+ */
+
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+namespace threaddag = pasl::sched::threaddag;
+
+long n;
+long nb_rounds;
+long resize_period;
+long nb_failures = 0;
+
+/*---------------------------------------------------------------------*/
+
+static void check(bool b, const char* msg) {
+  if (b)
+    return;
+  nb_failures++;
+  std::cout << "failed: " << msg << std::endl;
+}
+
+/* Cycles through all the sizes between 1 and the number of workers
+ * until `stop` is set; runs on an OS thread that is not a worker. */
+static void resize_loop(std::atomic<bool>& stop) {
+  int nb_workers = threaddag::get_nb_workers();
+  int nb = nb_workers;
+  while (! stop.load()) {
+    nb = (nb == 1) ? nb_workers : nb - 1;
+    threaddag::set_nb_active_workers(nb);
+    pasl::util::ticks::microseconds_sleep((double)resize_period);
+  }
+  threaddag::set_nb_active_workers(nb_workers);
+}
+
+/* Returns true once `nb` workers are parked, false after one second.
+ * Yields to the scheduler meanwhile: with receiver-initiated work
+ * stealing, a thief can park only after its pending request to the
+ * calling worker is answered. */
+static bool wait_for_nb_parked(int nb) {
+  pasl::util::microtime::microtime_t start = pasl::util::microtime::now();
+  while (pasl::util::worker::the_group.get_nb_parked() != nb) {
+    if (pasl::util::microtime::seconds_since(start) > 1.)
+      return false;
+    par::yield();
+  }
+  return true;
+}
+
+// every iteration of the loop runs exactly once, whatever the resizes
+static void check_loop_during_resizes() {
+  std::vector<int> visits(n, 0);
+  std::atomic<bool> stop(false);
+  std::thread resizer([&] { resize_loop(stop); });
+  for (long r = 0; r < nb_rounds; r++) {
+    par::parallel_for(0l, n, [&] (long i) {
+      visits[i]++;
+    });
+  }
+  stop.store(true);
+  resizer.join();
+  long nb_wrong = 0;
+  for (long i = 0; i < n; i++)
+    if (visits[i] != nb_rounds)
+      nb_wrong++;
+  check(nb_wrong == 0, "iterations lost or repeated during resizes");
+  check(threaddag::get_nb_active_workers() == threaddag::get_nb_workers(),
+        "all the workers are active after the resizes");
+}
+
+// deactivated workers park once idle, and wake up on activation
+static void check_park_and_wake() {
+  int nb_workers = threaddag::get_nb_workers();
+  threaddag::set_nb_active_workers(0);
+  check(threaddag::get_nb_active_workers() == 1, "worker 0 stays active");
+  check(wait_for_nb_parked(nb_workers - 1), "deactivated workers park");
+  threaddag::set_nb_active_workers(nb_workers);
+  check(wait_for_nb_parked(0), "activated workers wake up");
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+
+  auto init = [&] {
+    n = (long)pasl::util::cmdline::parse_or_default_int("n", 2000000);
+    nb_rounds = (long)pasl::util::cmdline::parse_or_default_int("rounds", 20);
+    resize_period = (long)pasl::util::cmdline::parse_or_default_int("resize_period", 200);
+  };
+  auto run = [&] (bool sequential) {
+    check_loop_during_resizes();
+    check_park_and_wake();
+  };
+  auto output = [&] {
+    if (nb_failures == 0)
+      std::cout << "All tests complete" << std::endl;
+    else
+      std::cout << nb_failures << " tests failed" << std::endl;
+  };
+  auto destroy = [&] {
+    ;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return (nb_failures == 0) ? 0 : 1;
+}
+
+/***********************************************************************/
@@ -158,6 +158,136 @@ public:
   
 };
   
+template <class Container>
+class prop_reduce_correct : public quickcheck::Property<Container> {
+public:
+
+  using container_type = Container;
+  using value_type = typename container_type::value_type;
+  using size_type = typename container_type::size_type;
+
+  bool holdsFor(const container_type& cont) {
+    auto plus = [] (value_type x, value_type y) { return x + y; };
+    auto is_even = [] (value_type x) { return x % 2 == 0; };
+    value_type sum = 0;
+    size_type nb_even = 0;
+    cont.for_each([&] (value_type x) {
+      sum += x;
+      nb_even += is_even(x) ? 1 : 0;
+    });
+    return pcontainer::reduce(cont, value_type(0), plus) == sum
+        && pcontainer::count_if(cont, is_even) == nb_even;
+  }
+
+};
+
+template <class Container>
+class prop_scan_correct : public quickcheck::Property<Container> {
+public:
+
+  using container_type = Container;
+  using value_type = typename container_type::value_type;
+  using size_type = typename container_type::size_type;
+
+  bool holdsFor(const container_type& cont) {
+    auto plus = [] (value_type x, value_type y) { return x + y; };
+    container_type incl;
+    container_type excl;
+    pcontainer::inclusive_scan(cont, incl, value_type(0), plus);
+    pcontainer::exclusive_scan(cont, excl, value_type(0), plus);
+    size_type sz = cont.size();
+    if (incl.size() != sz || excl.size() != sz)
+      return false;
+    value_type acc = 0;
+    for (size_type i = 0; i < sz; i++) {
+      if (excl[i] != acc)
+        return false;
+      acc += cont[i];
+      if (incl[i] != acc)
+        return false;
+    }
+    return true;
+  }
+
+};
+
+template <class Container>
+class prop_filter_correct : public quickcheck::Property<Container> {
+public:
+
+  using container_type = Container;
+  using value_type = typename container_type::value_type;
+
+  bool holdsFor(const container_type& cont) {
+    auto is_even = [] (value_type x) { return x % 2 == 0; };
+    auto twice = [] (value_type x) { return 2 * x; };
+    container_type evens;
+    container_type doubled;
+    pcontainer::filter(cont, evens, is_even);
+    pcontainer::transform(cont, doubled, twice);
+    container_type evens_ref;
+    container_type doubled_ref;
+    cont.for_each([&] (value_type x) {
+      if (is_even(x))
+        evens_ref.push_back(x);
+      doubled_ref.push_back(twice(x));
+    });
+    return same(evens, evens_ref) && same(doubled, doubled_ref);
+  }
+
+  static bool same(const container_type& c1, const container_type& c2) {
+    if (c1.size() != c2.size())
+      return false;
+    for (size_t i = 0; i < c1.size(); i++)
+      if (c1[i] != c2[i])
+        return false;
+    return true;
+  }
+
+};
+
+template <class Container>
+class prop_tabulate_correct : public quickcheck::Property<Container> {
+public:
+
+  using container_type = Container;
+  using value_type = typename container_type::value_type;
+  using size_type = typename container_type::size_type;
+
+  // appends `nb` items around the chunk capacity to `init`, in bulk and one by one
+  static bool check_sizes(const container_type& init) {
+    size_type cap = size_type(container_type::chunk_capacity);
+    size_type sizes[] = { 0, 1, cap - 1, cap, cap + 1, 3 * cap + 2 };
+    for (size_type nb : sizes) {
+      auto body = [] (size_type i) { return value_type(3 * i + 1); };
+      std::vector<value_type> range(nb);
+      for (size_type i = 0; i < nb; i++)
+        range[i] = body(i);
+      container_type tabulated(init);
+      container_type ranged(init);
+      container_type expected(init);
+      pcontainer::tabulate(nb, tabulated, body);
+      pcontainer::from_range(range.begin(), range.end(), ranged);
+      for (size_type i = 0; i < nb; i++)
+        expected.push_back(body(i));
+      if (! prop_filter_correct<container_type>::same(tabulated, expected)
+          || ! prop_filter_correct<container_type>::same(ranged, expected)) {
+        std::cout << "nb=" << nb << "\ninit:\n" << init << std::endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool holdsFor(const container_type& _cont) {
+    container_type cont(_cont);
+    if (cont.empty())
+      cont.push_back(value_type(1));
+    return check_sizes(container_type()) && check_sizes(cont);
+  }
+
+};
+
 /*---------------------------------------------------------------------*/
   
 int nb_tests;
@@ -166,6 +296,26 @@ void check_transfer_contents_to_array() {
   prop_transfer_contents_to_array_correct<pcontainer::deque<int>> prop;
   prop.check(nb_tests);
 }
+
+void check_reduce() {
+  prop_reduce_correct<pcontainer::deque<int>> prop;
+  prop.check(nb_tests);
+}
+
+void check_scan() {
+  prop_scan_correct<pcontainer::deque<int>> prop;
+  prop.check(nb_tests);
+}
+
+void check_filter() {
+  prop_filter_correct<pcontainer::deque<int>> prop;
+  prop.check(nb_tests);
+}
+
+void check_tabulate() {
+  prop_tabulate_correct<pcontainer::deque<int>> prop;
+  prop.check(nb_tests);
+}
   
 } // end namespace
 } // end namespace
@@ -183,6 +333,10 @@ int main(int argc, char ** argv) {
   auto run = [&] (bool sequential) {
     pasl::util::cmdline::argmap_dispatch c;
     c.add("transfer_contents_to_array",  [] { check_transfer_contents_to_array(); });
+    c.add("reduce",                      [] { check_reduce(); });
+    c.add("scan",                        [] { check_scan(); });
+    c.add("filter",                      [] { check_filter(); });
+    c.add("tabulate",                    [] { check_tabulate(); });
     pasl::util::cmdline::dispatch_by_argmap_with_default_all(c, "test");
   };
   auto output = [&] {
@@ -0,0 +1,161 @@
+/* COPYRIGHT (c) 2015 Umut Acar, Arthur Chargueraud, and Michael
+ * Rainey
+ * All rights reserved.
+ *
+ * \file pipelinecheck.cpp
+ * \brief Checks the ordering, exclusion and bound on the items in
+ * flight of `native::pipeline`
+ *
+ * Arguments:
+ *   - `-items <int>` (default=2000): number of items of each run
+ *   - `-n <int>` (default=15): each item computes fib(n) in parallel
+ *
+ */
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "pipeline.hpp"
+
+/***********************************************************************/
+
+namespace par = pasl::sched::native;
+
+typedef struct {
+  long index;
+  long value;
+} item_type;
+
+typedef par::pipeline<item_type> pipeline_type;
+
+long nb_items;
+long n;
+long nb_failures = 0;
+
+/*---------------------------------------------------------------------*/
+
+static void check(bool b, const char* msg) {
+  if (b)
+    return;
+  nb_failures++;
+  std::cout << "failed: " << msg << std::endl;
+}
+
+static long seq_fib(long n) {
+  if (n < 2)
+    return n;
+  return seq_fib(n - 1) + seq_fib(n - 2);
+}
+
+static long par_fib(long n) {
+  if (n < 2)
+    return n;
+  long a, b;
+  par::fork2([n, &a] { a = par_fib(n - 1); },
+             [n, &b] { b = par_fib(n - 2); });
+  return a + b;
+}
+
+// Returns an input that numbers `nb` items, and counts those in flight
+static pipeline_type::input_type counting_input(long nb, std::atomic<long>& nb_in_flight,
+                                                std::atomic<long>& max_in_flight) {
+  std::shared_ptr<long> next(new long(0));
+  return [nb, next, &nb_in_flight, &max_in_flight] (item_type& item) {
+    if (*next == nb)
+      return false;
+    item.index = (*next)++;
+    item.value = 0;
+    long m = ++nb_in_flight;
+    long prev = max_in_flight.load();
+    while (m > prev && ! max_in_flight.compare_exchange_weak(prev, m));
+    return true;
+  };
+}
+
+/* Runs the items through a parallel stage that forks, a serial stage
+ * in order, a serial stage out of order, and a parallel stage that
+ * ends the flight of the items. */
+static void check_stages(long max_in_flight) {
+  std::atomic<long> nb_in_flight(0);
+  std::atomic<long> max_seen(0);
+  std::vector<long> in_order;
+  std::atomic<long> nb_inside(0);
+  std::atomic<long> nb_overlaps(0);
+  std::atomic<long> nb_out_of_order(0);
+  std::atomic<long> nb_wrong_values(0);
+  long expected = seq_fib(n);
+  pipeline_type p(max_in_flight);
+  p.add_stage(pipeline_type::parallel, [] (item_type& item) {
+    item.value = par_fib(n);
+  });
+  p.add_stage(pipeline_type::serial_in_order, [&] (item_type& item) {
+    in_order.push_back(item.index);
+  });
+  p.add_stage(pipeline_type::serial_out_of_order, [&] (item_type& item) {
+    if (nb_inside++ != 0)
+      nb_overlaps++;
+    // forks inside a serial stage too
+    if (par_fib(n) != item.value)
+      nb_wrong_values++;
+    nb_out_of_order++;
+    nb_inside--;
+  });
+  p.add_stage(pipeline_type::parallel, [&] (item_type& item) {
+    if (item.value != expected)
+      nb_wrong_values++;
+    nb_in_flight--;
+  });
+  p.run(counting_input(nb_items, nb_in_flight, max_seen));
+  check(p.get_nb_items() == nb_items, "all the items go through");
+  bool ordered = (long)in_order.size() == nb_items;
+  for (long i = 0; ordered && i < nb_items; i++)
+    ordered = (in_order[i] == i);
+  check(ordered, "a serial in-order stage sees the items in input order");
+  check(nb_overlaps.load() == 0, "a serial out-of-order stage runs one item at a time");
+  check(nb_out_of_order.load() == nb_items, "a serial out-of-order stage sees every item");
+  check(nb_wrong_values.load() == 0, "stages that fork compute the right values");
+  check(max_seen.load() <= max_in_flight, "no more than max_in_flight items in flight");
+  check(nb_in_flight.load() == 0, "no item left in flight");
+}
+
+// An input that returns false right away runs no stage
+static void check_no_items() {
+  std::atomic<long> nb_runs(0);
+  pipeline_type p(4);
+  p.add_stage(pipeline_type::serial_in_order, [&] (item_type&) { nb_runs++; });
+  p.add_stage(pipeline_type::parallel, [&] (item_type&) { nb_runs++; });
+  p.run([] (item_type&) { return false; });
+  check(p.get_nb_items() == 0, "a run with no items has no items");
+  check(nb_runs.load() == 0, "a run with no items runs no stage");
+}
+
+/*---------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+
+  auto init = [&] {
+    nb_items = (long)pasl::util::cmdline::parse_or_default_int("items", 2000);
+    n = (long)pasl::util::cmdline::parse_or_default_int("n", 15);
+  };
+  auto run = [&] (bool sequential) {
+    check_no_items();
+    check_stages(1);
+    check_stages(2);
+    check_stages(16);
+  };
+  auto output = [&] {
+    if (nb_failures == 0)
+      std::cout << "All tests complete" << std::endl;
+    else
+      std::cout << nb_failures << " tests failed" << std::endl;
+  };
+  auto destroy = [&] {
+    ;
+  };
+  pasl::sched::launch(argc, argv, init, run, output, destroy);
+  return (nb_failures == 0) ? 0 : 1;
+}
+
+/***********************************************************************/